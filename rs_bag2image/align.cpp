@@ -0,0 +1,107 @@
+#include "align.h"
+#include "trace.h"
+
+#include <librealsense2/rsutil.h>
+
+#include <algorithm>
+
+// Constructor
+DepthAligner::DepthAligner( const rs2::video_stream_profile& depth_profile, const rs2::video_stream_profile& color_profile, float depth_scale )
+    : depth_profile_id( depth_profile.unique_id() ), color_profile_id( color_profile.unique_id() ),
+      depth_intrinsics( depth_profile.get_intrinsics() ), color_intrinsics( color_profile.get_intrinsics() ),
+      depth_to_color( depth_profile.get_extrinsics_to( color_profile ) ), depth_scale( depth_scale ),
+      top_left_rays( depth_intrinsics, -0.5f ), center_rays( depth_intrinsics, 0.0f ), bottom_right_rays( depth_intrinsics, 0.5f )
+{
+}
+
+// Check Aligner was Created for Stream Profiles
+bool DepthAligner::isCreatedFor( const rs2::stream_profile& depth_profile, const rs2::stream_profile& color_profile ) const
+{
+    return depth_profile.unique_id() == depth_profile_id && color_profile.unique_id() == color_profile_id;
+}
+
+// Project Ray at Depth to Color Pixel
+inline void DepthAligner::project( const RayTable::Ray& ray, float z, float pixel[2] ) const
+{
+    const float depth_point[3] = { ray.x * z, ray.y * z, z };
+    float color_point[3];
+    rs2_transform_point_to_point( color_point, &depth_to_color, depth_point );
+    rs2_project_point_to_pixel( pixel, &color_intrinsics, color_point );
+}
+
+// Align Depth to Color
+void DepthAligner::alignDepth( const cv::Mat& depth, cv::Mat& aligned ) const
+{
+    TRACE_SCOPE( "align/depth" );
+
+    CV_Assert( depth.type() == CV_16UC1 && depth.cols == depth_intrinsics.width && depth.rows == depth_intrinsics.height );
+    aligned = cv::Mat::zeros( color_intrinsics.height, color_intrinsics.width, CV_16UC1 );
+
+    for( int32_t y = 0; y < depth.rows; y++ ){
+        const uint16_t* depth_row = depth.ptr<uint16_t>( y );
+        const std::size_t offset = static_cast<std::size_t>( y ) * depth.cols;
+        for( int32_t x = 0; x < depth.cols; x++ ){
+            const uint16_t value = depth_row[x];
+            if( value == 0 ){
+                continue;
+            }
+
+            // Project Corners of Depth Pixel
+            const float z = value * depth_scale;
+            float top_left[2];
+            float bottom_right[2];
+            project( top_left_rays[offset + x], z, top_left );
+            project( bottom_right_rays[offset + x], z, bottom_right );
+
+            const int32_t left = static_cast<int32_t>( top_left[0] + 0.5f );
+            const int32_t top = static_cast<int32_t>( top_left[1] + 0.5f );
+            const int32_t right = static_cast<int32_t>( bottom_right[0] + 0.5f );
+            const int32_t bottom = static_cast<int32_t>( bottom_right[1] + 0.5f );
+            if( left < 0 || top < 0 || right >= aligned.cols || bottom >= aligned.rows ){
+                continue;
+            }
+
+            // Fill Covered Color Pixels (Nearest Depth Wins)
+            for( int32_t v = top; v <= bottom; v++ ){
+                uint16_t* aligned_row = aligned.ptr<uint16_t>( v );
+                for( int32_t u = left; u <= right; u++ ){
+                    aligned_row[u] = ( aligned_row[u] != 0 ) ? std::min( aligned_row[u], value ) : value;
+                }
+            }
+        }
+    }
+}
+
+// Align Color to Depth
+void DepthAligner::alignColor( const cv::Mat& depth, const cv::Mat& color, cv::Mat& aligned ) const
+{
+    TRACE_SCOPE( "align/color" );
+
+    CV_Assert( depth.type() == CV_16UC1 && depth.cols == depth_intrinsics.width && depth.rows == depth_intrinsics.height );
+    CV_Assert( color.cols == color_intrinsics.width && color.rows == color_intrinsics.height );
+    aligned = cv::Mat::zeros( depth.rows, depth.cols, color.type() );
+
+    const std::size_t pixel_size = color.elemSize();
+    for( int32_t y = 0; y < depth.rows; y++ ){
+        const uint16_t* depth_row = depth.ptr<uint16_t>( y );
+        uint8_t* aligned_row = aligned.ptr<uint8_t>( y );
+        const std::size_t offset = static_cast<std::size_t>( y ) * depth.cols;
+        for( int32_t x = 0; x < depth.cols; x++ ){
+            const uint16_t value = depth_row[x];
+            if( value == 0 ){
+                continue;
+            }
+
+            // Project Center of Depth Pixel
+            float pixel[2];
+            project( center_rays[offset + x], value * depth_scale, pixel );
+            const int32_t u = static_cast<int32_t>( pixel[0] + 0.5f );
+            const int32_t v = static_cast<int32_t>( pixel[1] + 0.5f );
+            if( u < 0 || v < 0 || u >= color.cols || v >= color.rows ){
+                continue;
+            }
+
+            std::copy_n( color.ptr<uint8_t>( v ) + u * pixel_size, pixel_size, aligned_row + x * pixel_size );
+        }
+    }
+}
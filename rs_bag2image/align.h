@@ -0,0 +1,53 @@
+#ifndef __ALIGN__
+#define __ALIGN__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+
+#include "ray.h"
+
+// Depth Aligner
+// Aligns depth to color (depth in color image geometry), and color to depth (color in depth image geometry).
+// The rays of depth pixels (deprojection with depth intrinsics and distortion) depend only on the stream profiles,
+// so they are computed once at construction, and each frame costs one scale, one rigid transform and one projection per pixel.
+// Alignment is const and allocates its output, so one aligner is shared by encoder worker threads.
+class DepthAligner
+{
+private:
+    // Stream Profiles
+    int32_t depth_profile_id;
+    int32_t color_profile_id;
+    rs2_intrinsics depth_intrinsics;
+    rs2_intrinsics color_intrinsics;
+    rs2_extrinsics depth_to_color;
+    float depth_scale;
+
+    // Ray Tables (Top-Left Corner, Center and Bottom-Right Corner of Each Depth Pixel)
+    RayTable top_left_rays;
+    RayTable center_rays;
+    RayTable bottom_right_rays;
+
+public:
+    // Constructor
+    // Compute ray tables of depth profile.
+    DepthAligner( const rs2::video_stream_profile& depth_profile, const rs2::video_stream_profile& color_profile, float depth_scale );
+
+    // Check Aligner was Created for Stream Profiles
+    bool isCreatedFor( const rs2::stream_profile& depth_profile, const rs2::stream_profile& color_profile ) const;
+
+    // Align Depth to Color (16bit, Size of Color)
+    // Each depth pixel covers the color pixels between its projected corners, and the nearest depth wins.
+    void alignDepth( const cv::Mat& depth, cv::Mat& aligned ) const;
+
+    // Align Color to Depth (Type of Color, Size of Depth)
+    // Each depth pixel takes the color pixel that its center projects to. Pixels without depth are black.
+    void alignColor( const cv::Mat& depth, const cv::Mat& color, cv::Mat& aligned ) const;
+
+private:
+    // Project Ray at Depth to Color Pixel
+    inline void project( const RayTable::Ray& ray, float z, float pixel[2] ) const;
+};
+
+#endif // __ALIGN__
@@ -0,0 +1,422 @@
+#include "archive.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+    constexpr std::size_t tar_block_size = 512;
+    constexpr uint64_t zip_limit_32 = 0xFFFFFFFF;
+    constexpr uint64_t zip_limit_16 = 0xFFFF;
+
+    // Store Little Endian Integer
+    template<typename T>
+    uint8_t* store( uint8_t* destination, T value )
+    {
+        for( std::size_t i = 0; i < sizeof( T ); i++ ){
+            *destination++ = static_cast<uint8_t>( static_cast<uint64_t>( value ) >> ( i * 8 ) );
+        }
+        return destination;
+    }
+
+    // Write Octal Number Field of Tar Header (Zero Padded, Terminated by NUL)
+    bool octal( char* field, std::size_t length, uint64_t value )
+    {
+        field[length - 1] = '\0';
+        for( std::size_t i = length - 1; i > 0; i-- ){
+            field[i - 1] = static_cast<char>( '0' + ( value & 7 ) );
+            value >>= 3;
+        }
+        return value == 0;
+    }
+
+    // Calculate CRC-32 (Zip)
+    uint32_t crc32( const void* data, std::size_t length, uint32_t crc = 0 )
+    {
+        static const std::array<uint32_t, 256> table = []{
+            std::array<uint32_t, 256> table;
+            for( uint32_t i = 0; i < 256; i++ ){
+                uint32_t value = i;
+                for( int32_t bit = 0; bit < 8; bit++ ){
+                    value = ( value & 1 ) ? ( 0xEDB88320u ^ ( value >> 1 ) ) : ( value >> 1 );
+                }
+                table[i] = value;
+            }
+            return table;
+        }();
+
+        const uint8_t* bytes = static_cast<const uint8_t*>( data );
+        crc = ~crc;
+        for( std::size_t i = 0; i < length; i++ ){
+            crc = table[( crc ^ bytes[i] ) & 0xFF] ^ ( crc >> 8 );
+        }
+        return ~crc;
+    }
+}
+
+// Constructor
+Archive::Archive( const filesystem::path& path, Format format, const filesystem::path& root, std::size_t buffer_size )
+    : path( path ), root( root ), format( format )
+{
+    // Open File
+    file = std::fopen( path.string().c_str(), "wb" );
+    if( !file ){
+        throw std::runtime_error( "failed can't open " + path.generic_string() );
+    }
+
+    // Disable stdio Buffering (use own buffer)
+    std::setvbuf( file, nullptr, _IONBF, 0 );
+
+    // Allocate Buffer (Multiple of Tar Block Size)
+    buffer_size = std::max( buffer_size, tar_block_size );
+    buffer.resize( ( buffer_size + tar_block_size - 1 ) / tar_block_size * tar_block_size );
+
+    // Create Index (Replace Index of Previous Extraction)
+    const filesystem::path index_path = path.string() + ".index.csv";
+    std::error_code error;
+    filesystem::remove( index_path, error );
+    index = std::make_unique<CsvWriter>( index_path, "name,offset,size" );
+
+    // Retrieve Modification Time of Entries
+    const std::time_t now = std::chrono::system_clock::to_time_t( std::chrono::system_clock::now() );
+    mtime = static_cast<uint64_t>( now );
+    std::tm local = {};
+#if _WIN32
+    localtime_s( &local, &now );
+#else
+    localtime_r( &now, &local );
+#endif
+    dos_time = static_cast<uint16_t>( ( local.tm_hour << 11 ) | ( local.tm_min << 5 ) | ( local.tm_sec / 2 ) );
+    dos_date = static_cast<uint16_t>( ( std::max( local.tm_year - 80, 0 ) << 9 ) | ( ( local.tm_mon + 1 ) << 5 ) | local.tm_mday );
+}
+
+// Destructor
+Archive::~Archive()
+{
+    try{
+        close();
+    }
+    catch( ... ){
+    }
+}
+
+// Append Entry
+void Archive::append( const filesystem::path& path, const void* data, std::size_t length )
+{
+    TRACE_SCOPE( "archive" );
+
+    const std::string name = getName( path );
+    const uint32_t crc = ( format == Format::Zip ) ? crc32( data, length ) : 0;
+
+    std::lock_guard<std::mutex> lock( mutex );
+    if( !file ){
+        throw std::runtime_error( "failed " + this->path.generic_string() + " has been closed" );
+    }
+
+    // Write Header and Data (Tar Data is Padded to Block Size)
+    const uint64_t header_offset = offset;
+    if( format == Format::Tar ){
+        writeTarHeader( name, length );
+    }
+    else{
+        writeZipHeader( name, length, crc );
+        entries.push_back( { name, header_offset, length, crc } );
+    }
+    const uint64_t data_offset = offset;
+    put( data, length );
+    if( format == Format::Tar ){
+        pad( ( tar_block_size - length % tar_block_size ) % tar_block_size );
+    }
+
+    index->write( name, data_offset, static_cast<uint64_t>( length ) );
+}
+
+// Append File and Remove It
+void Archive::appendFile( const filesystem::path& path )
+{
+    std::ifstream stream( path.string(), std::ios::binary );
+    if( !stream.is_open() ){
+        throw std::runtime_error( "failed can't open " + path.generic_string() );
+    }
+    const std::vector<char> data( ( std::istreambuf_iterator<char>( stream ) ), std::istreambuf_iterator<char>() );
+    stream.close();
+
+    append( path, data.data(), data.size() );
+    filesystem::remove( path );
+}
+
+// Close (Write Remaining Entries and End of Archive)
+void Archive::close()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    if( !file ){
+        return;
+    }
+
+    std::FILE* closing = file;
+    try{
+        if( format == Format::Tar ){
+            pad( tar_block_size * 2 );
+        }
+        else{
+            writeZipDirectory();
+        }
+        flush();
+        index->flush();
+    }
+    catch( ... ){
+        std::fclose( closing );
+        file = nullptr;
+        throw;
+    }
+
+    file = nullptr;
+    index.reset();
+    if( std::fclose( closing ) != 0 ){
+        throw std::runtime_error( "failed can't write " + path.generic_string() );
+    }
+}
+
+// Retrieve Archive Path
+const filesystem::path& Archive::getPath() const
+{
+    return path;
+}
+
+// Retrieve Archive Format from Name (tar or zip)
+Archive::Format Archive::getFormat( const std::string& name )
+{
+    std::string lower = name;
+    std::transform( lower.begin(), lower.end(), lower.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+    if( lower == "tar" ){
+        return Format::Tar;
+    }
+    if( lower == "zip" ){
+        return Format::Zip;
+    }
+    throw std::runtime_error( "failed unknown archive format " + name );
+}
+
+// Retrieve Extension of Format (.tar or .zip)
+std::string Archive::getExtension( Format format )
+{
+    return ( format == Format::Tar ) ? ".tar" : ".zip";
+}
+
+// Retrieve Entry Name (Path Relative to Root)
+inline std::string Archive::getName( const filesystem::path& path ) const
+{
+    const std::string name = path.generic_string();
+    const std::string prefix = root.generic_string() + "/";
+    if( name.compare( 0, prefix.size(), prefix ) == 0 ){
+        return name.substr( prefix.size() );
+    }
+    return path.filename().generic_string();
+}
+
+// Write Tar Header (ustar)
+// Names longer than 100 characters are split into prefix and name at a slash.
+inline void Archive::writeTarHeader( const std::string& name, uint64_t length )
+{
+    std::array<char, tar_block_size> header = {};
+
+    std::string prefix;
+    std::string short_name = name;
+    if( name.size() > 100 ){
+        const std::size_t slash = name.rfind( '/', 155 );
+        if( slash == std::string::npos || name.size() - slash - 1 > 100 ){
+            throw std::runtime_error( "failed entry name is too long " + name );
+        }
+        prefix = name.substr( 0, slash );
+        short_name = name.substr( slash + 1 );
+    }
+    std::memcpy( &header[0], short_name.data(), short_name.size() );
+    octal( &header[100], 8, 0644 );
+    octal( &header[108], 8, 0 );
+    octal( &header[116], 8, 0 );
+    if( !octal( &header[124], 12, length ) ){
+        throw std::runtime_error( "failed entry is too large " + name );
+    }
+    octal( &header[136], 12, mtime );
+    header[156] = '0';
+    std::memcpy( &header[257], "ustar", 6 );
+    std::memcpy( &header[263], "00", 2 );
+    std::memcpy( &header[345], prefix.data(), prefix.size() );
+
+    // Checksum (Sum of Header Bytes with Checksum Field as Spaces)
+    std::memset( &header[148], ' ', 8 );
+    uint64_t checksum = 0;
+    for( const char c : header ){
+        checksum += static_cast<unsigned char>( c );
+    }
+    octal( &header[148], 7, checksum );
+
+    put( header.data(), header.size() );
+}
+
+// Write Zip Local Header
+// Sizes are moved to zip64 extra field if entry exceeds 4GiB.
+inline void Archive::writeZipHeader( const std::string& name, uint64_t length, uint32_t crc )
+{
+    const bool zip64 = length >= zip_limit_32;
+    std::array<uint8_t, 30 + 20> header;
+    uint8_t* p = header.data();
+    p = store<uint32_t>( p, 0x04034b50 );
+    p = store<uint16_t>( p, zip64 ? 45 : 20 );
+    p = store<uint16_t>( p, 0x0800 );                               // utf-8 name
+    p = store<uint16_t>( p, 0 );                                    // stored
+    p = store<uint16_t>( p, dos_time );
+    p = store<uint16_t>( p, dos_date );
+    p = store<uint32_t>( p, crc );
+    p = store<uint32_t>( p, zip64 ? zip_limit_32 : length );
+    p = store<uint32_t>( p, zip64 ? zip_limit_32 : length );
+    p = store<uint16_t>( p, static_cast<uint16_t>( name.size() ) );
+    p = store<uint16_t>( p, zip64 ? 20 : 0 );
+    put( header.data(), 30 );
+    put( name.data(), name.size() );
+    if( zip64 ){
+        p = store<uint16_t>( p, 0x0001 );
+        p = store<uint16_t>( p, 16 );
+        p = store<uint64_t>( p, length );
+        p = store<uint64_t>( p, length );
+        put( header.data() + 30, 20 );
+    }
+}
+
+// Write Zip Central Directory and End of Central Directory
+// Zip64 end of central directory is written if offsets or number of entries exceed zip limits.
+inline void Archive::writeZipDirectory()
+{
+    const uint64_t directory_offset = offset;
+    for( const Entry& entry : entries ){
+        // Zip64 Extra Field (Only Fields that Exceed Limits)
+        std::array<uint8_t, 4 + 24> extra;
+        uint8_t* e = extra.data() + 4;
+        if( entry.size >= zip_limit_32 ){
+            e = store<uint64_t>( e, entry.size );
+            e = store<uint64_t>( e, entry.size );
+        }
+        if( entry.offset >= zip_limit_32 ){
+            e = store<uint64_t>( e, entry.offset );
+        }
+        const uint16_t extra_size = static_cast<uint16_t>( e - extra.data() - 4 );
+        store<uint16_t>( store<uint16_t>( extra.data(), 0x0001 ), extra_size );
+
+        std::array<uint8_t, 46> header;
+        uint8_t* p = header.data();
+        p = store<uint32_t>( p, 0x02014b50 );
+        p = store<uint16_t>( p, ( 3 << 8 ) | 45 );                  // unix, 4.5
+        p = store<uint16_t>( p, ( extra_size > 0 ) ? 45 : 20 );
+        p = store<uint16_t>( p, 0x0800 );
+        p = store<uint16_t>( p, 0 );
+        p = store<uint16_t>( p, dos_time );
+        p = store<uint16_t>( p, dos_date );
+        p = store<uint32_t>( p, entry.crc );
+        p = store<uint32_t>( p, std::min( entry.size, zip_limit_32 ) );
+        p = store<uint32_t>( p, std::min( entry.size, zip_limit_32 ) );
+        p = store<uint16_t>( p, static_cast<uint16_t>( entry.name.size() ) );
+        p = store<uint16_t>( p, ( extra_size > 0 ) ? extra_size + 4 : 0 );
+        p = store<uint16_t>( p, 0 );                                // comment
+        p = store<uint16_t>( p, 0 );                                // disk
+        p = store<uint16_t>( p, 0 );                                // internal attributes
+        p = store<uint32_t>( p, 0100644u << 16 );                   // external attributes (regular file, 0644)
+        p = store<uint32_t>( p, std::min( entry.offset, zip_limit_32 ) );
+        put( header.data(), header.size() );
+        put( entry.name.data(), entry.name.size() );
+        if( extra_size > 0 ){
+            put( extra.data(), extra_size + 4 );
+        }
+    }
+    const uint64_t directory_size = offset - directory_offset;
+    const uint64_t count = entries.size();
+
+    // Zip64 End of Central Directory Record and Locator
+    if( count >= zip_limit_16 || directory_offset >= zip_limit_32 || directory_size >= zip_limit_32 ){
+        const uint64_t record_offset = offset;
+        std::array<uint8_t, 56 + 20> record;
+        uint8_t* p = record.data();
+        p = store<uint32_t>( p, 0x06064b50 );
+        p = store<uint64_t>( p, 44 );                               // size of remaining record
+        p = store<uint16_t>( p, ( 3 << 8 ) | 45 );
+        p = store<uint16_t>( p, 45 );
+        p = store<uint32_t>( p, 0 );
+        p = store<uint32_t>( p, 0 );
+        p = store<uint64_t>( p, count );
+        p = store<uint64_t>( p, count );
+        p = store<uint64_t>( p, directory_size );
+        p = store<uint64_t>( p, directory_offset );
+        p = store<uint32_t>( p, 0x07064b50 );
+        p = store<uint32_t>( p, 0 );
+        p = store<uint64_t>( p, record_offset );
+        p = store<uint32_t>( p, 1 );
+        put( record.data(), record.size() );
+    }
+
+    // End of Central Directory Record
+    std::array<uint8_t, 22> end;
+    uint8_t* p = end.data();
+    p = store<uint32_t>( p, 0x06054b50 );
+    p = store<uint16_t>( p, 0 );
+    p = store<uint16_t>( p, 0 );
+    p = store<uint16_t>( p, std::min( count, zip_limit_16 ) );
+    p = store<uint16_t>( p, std::min( count, zip_limit_16 ) );
+    p = store<uint32_t>( p, std::min( directory_size, zip_limit_32 ) );
+    p = store<uint32_t>( p, std::min( directory_offset, zip_limit_32 ) );
+    p = store<uint16_t>( p, 0 );
+    put( end.data(), end.size() );
+}
+
+// Copy Data into Buffer (Write Buffer when Full)
+inline void Archive::put( const void* data, std::size_t length )
+{
+    const uint8_t* source = static_cast<const uint8_t*>( data );
+    offset += length;
+    while( length > 0 ){
+        const std::size_t chunk = std::min( length, buffer.size() - size );
+        std::memcpy( buffer.data() + size, source, chunk );
+        size += chunk;
+        source += chunk;
+        length -= chunk;
+        if( size == buffer.size() ){
+            flush();
+        }
+    }
+}
+
+// Copy Zero Bytes into Buffer
+inline void Archive::pad( std::size_t length )
+{
+    offset += length;
+    while( length > 0 ){
+        const std::size_t chunk = std::min( length, buffer.size() - size );
+        std::memset( buffer.data() + size, 0, chunk );
+        size += chunk;
+        length -= chunk;
+        if( size == buffer.size() ){
+            flush();
+        }
+    }
+}
+
+// Write Buffer to File
+inline void Archive::flush()
+{
+    if( size == 0 ){
+        return;
+    }
+
+    const std::size_t length = size;
+    size = 0;
+    if( std::fwrite( buffer.data(), 1, length, file ) != length ){
+        throw std::runtime_error( "failed can't write " + path.generic_string() );
+    }
+    countProfile( "bytes/archive", length );
+}
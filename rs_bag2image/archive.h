@@ -0,0 +1,123 @@
+#ifndef __ARCHIVE__
+#define __ARCHIVE__
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "writer.h"
+
+// Archive Writer
+// Appends encoded images and CSV files as entries of one tar or uncompressed zip file instead of small files.
+// Entries are streamed sequentially through a large buffer, so the archive is written with large writes only.
+// append() can be called from multiple threads (e.g. encoder workers), entries are appended in arrival order.
+//
+// Index (<archive>.index.csv)
+//   name,offset,size
+//   offset is bytes from beginning of archive to data of entry, so an entry can be read with one seek
+//   (or memory-mapped) without scanning the archive.
+//
+// Tar (ustar)
+//   512 byte header and data padded to 512 bytes for each entry, two zero blocks at end.
+//
+// Zip (stored, no compression)
+//   local header and data for each entry, central directory at end.
+//   zip64 records are written if the archive exceeds 4GiB or 65535 entries.
+class Archive
+{
+public:
+    // Archive Format
+    enum class Format
+    {
+        Tar,
+        Zip
+    };
+
+private:
+    // Central Directory Entry (Zip)
+    struct Entry
+    {
+        std::string name;
+        uint64_t offset;        // bytes from beginning of archive to local header
+        uint64_t size;
+        uint32_t crc;
+    };
+
+    std::FILE* file = nullptr;
+    filesystem::path path;
+    filesystem::path root;
+    Format format;
+
+    // Buffer
+    std::vector<uint8_t> buffer;
+    std::size_t size = 0;
+    uint64_t offset = 0;        // bytes written and buffered
+
+    // Index
+    std::unique_ptr<CsvWriter> index;
+    std::vector<Entry> entries;
+
+    // Modification Time of Entries (Time of Archive Creation)
+    uint64_t mtime;
+    uint16_t dos_time;
+    uint16_t dos_date;
+
+    std::mutex mutex;
+
+public:
+    // Constructor
+    // Entry names are paths relative to root (e.g. Color/000001.jpg).
+    Archive( const filesystem::path& path, Format format, const filesystem::path& root, std::size_t buffer_size = 4 << 20 );
+
+    // Destructor
+    ~Archive();
+
+    Archive( const Archive& ) = delete;
+    Archive& operator=( const Archive& ) = delete;
+
+    // Append Entry
+    void append( const filesystem::path& path, const void* data, std::size_t length );
+
+    // Append File and Remove It (e.g. CSV Files)
+    void appendFile( const filesystem::path& path );
+
+    // Close (Write Remaining Entries and End of Archive)
+    void close();
+
+    // Retrieve Archive Path
+    const filesystem::path& getPath() const;
+
+    // Retrieve Archive Format from Name (tar or zip)
+    static Format getFormat( const std::string& name );
+
+    // Retrieve Extension of Format (.tar or .zip)
+    static std::string getExtension( Format format );
+
+private:
+    // Retrieve Entry Name (Path Relative to Root)
+    inline std::string getName( const filesystem::path& path ) const;
+
+    // Write Tar Header
+    inline void writeTarHeader( const std::string& name, uint64_t length );
+
+    // Write Zip Local Header
+    inline void writeZipHeader( const std::string& name, uint64_t length, uint32_t crc );
+
+    // Write Zip Central Directory and End of Central Directory
+    inline void writeZipDirectory();
+
+    // Copy Data into Buffer (Write Buffer when Full)
+    inline void put( const void* data, std::size_t length );
+
+    // Copy Zero Bytes into Buffer
+    inline void pad( std::size_t length );
+
+    // Write Buffer to File
+    inline void flush();
+};
+
+#endif // __ARCHIVE__
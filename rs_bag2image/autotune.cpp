@@ -0,0 +1,221 @@
+#include "autotune.h"
+#include "colorize.h"
+#include "convert.h"
+#include "reader.h"
+#include "version.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+// Constructor
+Autotune::Autotune( const Parameter& parameter )
+    : parameter( parameter )
+{
+    std::cout << "rs_bag2image " << RS_BAG2IMAGE_VERSION << " (autotune)" << std::endl;
+}
+
+// Processing
+void Autotune::run()
+{
+    // Collect Sample Frames
+    collect();
+    if( std::none_of( streams.begin(), streams.end(), []( const std::pair<const StreamKey, Samples>& stream ){ return !stream.second.images.empty(); } ) ){
+        throw std::runtime_error( "failed can't find image streams in bag file" );
+    }
+
+    // Measure and Report Candidate Profiles of Each Stream
+    for( const std::pair<const StreamKey, Samples>& stream : streams ){
+        report( stream.second );
+    }
+}
+
+// Collect Sample Frames
+// Samples are spread over the expected frames of each stream (as calibration samples of probe), and only sampled frames are converted.
+inline void Autotune::collect()
+{
+    // Open Bag File with Selected Streams in Extraction Range
+    BagReader reader( parameter );
+
+    // Initialize Depth Visualization (Scaling)
+    DepthColorizer depth_colorizer;
+    depth_colorizer.setRange( parameter.depth_near, parameter.depth_far );
+    depth_colorizer.setInverse( parameter.depth_inverse );
+    depth_colorizer.setColormap( parameter.depth_colormap );
+    depth_colorizer.setDepthScale( reader.getDepthScale() );
+
+    // Retrieve Sample Streams (Color, Depth and Infrared of Supported Format)
+    const double range_seconds = std::chrono::duration<double>( std::chrono::nanoseconds( reader.getEndPosition() - reader.getStartPosition() ) ).count();
+    for( const rs2::stream_profile& stream_profile : reader.getStreams() ){
+        const rs2_stream stream_type = stream_profile.stream_type();
+        if( stream_type != rs2_stream::RS2_STREAM_COLOR && stream_type != rs2_stream::RS2_STREAM_DEPTH && stream_type != rs2_stream::RS2_STREAM_INFRARED ){
+            continue;
+        }
+        if( !stream_profile.is<rs2::video_stream_profile>() || !getConvertKernel( stream_profile.format() ) ){
+            continue;
+        }
+
+        Samples& samples = streams[StreamKey( stream_type, stream_profile.stream_index() )];
+        const EncoderProfile& current = ( stream_type == rs2_stream::RS2_STREAM_COLOR ) ? parameter.color_profile : ( stream_type == rs2_stream::RS2_STREAM_DEPTH ) ? parameter.depth_profile : parameter.infrared_profile;
+        samples.name = getStreamName( stream_type, stream_profile.stream_index() );
+        samples.candidates = getCandidates( stream_type, current );
+        const uint64_t expected = static_cast<uint64_t>( range_seconds * stream_profile.fps() );
+        samples.stride = std::max<uint64_t>( 1, expected / parameter.autotune_samples );
+    }
+
+    // Collect Sample Frames until All Streams have Samples or End of Position
+    std::size_t completed = 0;
+    rs2::frameset frameset;
+    while( completed < streams.size() && reader.read( frameset ) ){
+        #if 29 < RS2_API_MINOR_VERSION
+        frameset.foreach_rs( [&]( const rs2::frame& frame ){
+        #else
+        frameset.foreach( [&]( const rs2::frame& frame ){
+        #endif
+            const rs2::stream_profile stream_profile = frame.get_profile();
+            const std::map<StreamKey, Samples>::iterator found = streams.find( StreamKey( stream_profile.stream_type(), stream_profile.stream_index() ) );
+            if( found == streams.end() ){
+                return;
+            }
+
+            Samples& samples = found->second;
+            if( samples.images.size() >= parameter.autotune_samples ){
+                return;
+            }
+
+            // Skip Frame Repeated by Syncer, and Frames between Samples
+            const double timestamp = frame.get_timestamp();
+            if( samples.frames > 0 && timestamp <= samples.last_timestamp ){
+                return;
+            }
+            samples.last_timestamp = timestamp;
+            if( samples.frames++ % samples.stride != 0 ){
+                return;
+            }
+
+            // Convert Sample Frame
+            const rs2::video_frame video_frame = frame.as<rs2::video_frame>();
+            cv::Mat image;
+            getConvertKernel( stream_profile.format() )( video_frame.get_data(), video_frame.get_width(), video_frame.get_height(), video_frame.get_stride_in_bytes(), image );
+
+            // Copy Image (Image may Refer to Frame Buffer)
+            if( stream_profile.stream_type() == rs2_stream::RS2_STREAM_DEPTH && parameter.scaling && image.depth() == CV_16U ){
+                cv::Mat visual;
+                depth_colorizer.colorize( image, visual );
+                image = visual;
+            }
+            else{
+                image = image.clone();
+            }
+            samples.images.push_back( image );
+
+            if( samples.images.size() == parameter.autotune_samples ){
+                completed++;
+            }
+        } );
+    }
+}
+
+// Retrieve Candidate Profiles of Stream
+inline std::vector<EncoderProfile> Autotune::getCandidates( rs2_stream stream_type, const EncoderProfile& current )
+{
+    std::vector<std::string> profiles;
+    if( stream_type == rs2_stream::RS2_STREAM_DEPTH && !parameter.scaling ){
+        // Lossless 16bit
+        for( const std::string level : { "0", "1", "3", "6", "9" } ){
+            for( const std::string strategy : { "default", "filtered", "rle", "huffman" } ){
+                profiles.push_back( "png:level=" + level + ",strategy=" + strategy );
+            }
+        }
+        profiles.push_back( "tiff:compression=none" );
+        profiles.push_back( "tiff:compression=lzw" );
+        profiles.push_back( "tiff:compression=deflate" );
+    }
+    else{
+        // JPEG (Lossy) and Lossless 8bit
+        for( const std::string quality : { "75", "85", "95" } ){
+            profiles.push_back( "jpg:quality=" + quality );
+            profiles.push_back( "jpg:optimize=1,quality=" + quality );
+            profiles.push_back( "jpg:progressive=1,quality=" + quality );
+        }
+        profiles.push_back( "webp:quality=90" );
+        profiles.push_back( "webp:quality=101" );
+        profiles.push_back( "png:level=1,strategy=default" );
+        profiles.push_back( "png:level=1,strategy=rle" );
+        profiles.push_back( "png:level=6,strategy=default" );
+    }
+
+    std::vector<EncoderProfile> candidates = { current };
+    for( const std::string& profile : profiles ){
+        const EncoderProfile candidate = EncoderProfile::parse( profile );
+        if( candidate.description != current.description ){
+            candidates.push_back( candidate );
+        }
+    }
+    return candidates;
+}
+
+// Measure and Report Candidate Profiles of Stream
+inline void Autotune::report( const Samples& samples )
+{
+    if( samples.images.empty() ){
+        return;
+    }
+
+    // Raw Size of Samples
+    double raw_bytes = 0.0;
+    for( const cv::Mat& image : samples.images ){
+        raw_bytes += static_cast<double>( image.total() * image.elemSize() );
+    }
+
+    // Measure Each Candidate
+    struct Measurement
+    {
+        std::string description;
+        double milliseconds;    // per frame
+        double bytes;           // per frame
+    };
+    std::vector<Measurement> measurements;
+    std::vector<uint8_t> buffer;
+    for( const EncoderProfile& candidate : samples.candidates ){
+        double bytes = 0.0;
+        bool supported = true;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for( const cv::Mat& image : samples.images ){
+            try{
+                if( !cv::imencode( candidate.extension(), image, buffer, candidate.params ) ){
+                    supported = false;
+                    break;
+                }
+            }
+            catch( const cv::Exception& ){
+                supported = false;
+                break;
+            }
+            bytes += static_cast<double>( buffer.size() );
+        }
+        const double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+        if( !supported ){
+            continue;
+        }
+
+        const double count = static_cast<double>( samples.images.size() );
+        measurements.push_back( { candidate.description, milliseconds / count, bytes / count } );
+    }
+
+    // Sort by Encoding Time
+    std::sort( measurements.begin(), measurements.end(), []( const Measurement& a, const Measurement& b ){ return a.milliseconds < b.milliseconds; } );
+
+    // Show Report
+    const double raw_frame_bytes = raw_bytes / samples.images.size();
+    std::cout << std::endl << samples.name << " (" << samples.images.size() << " frames, " << samples.images.front().cols << "x" << samples.images.front().rows << ", current " << samples.candidates.front().description << ")" << std::endl;
+    std::cout << "  " << std::left << std::setw( 36 ) << "profile" << std::right << std::setw( 12 ) << "ms/frame" << std::setw( 12 ) << "frames/s" << std::setw( 12 ) << "KB/frame" << std::setw( 10 ) << "ratio" << std::endl;
+    for( const Measurement& measurement : measurements ){
+        std::cout << "  " << std::left << std::setw( 36 ) << measurement.description << std::right << std::fixed
+                  << std::setprecision( 2 ) << std::setw( 12 ) << measurement.milliseconds
+                  << std::setprecision( 1 ) << std::setw( 12 ) << ( ( measurement.milliseconds > 0.0 ) ? 1000.0 / measurement.milliseconds : 0.0 )
+                  << std::setprecision( 1 ) << std::setw( 12 ) << measurement.bytes / 1024.0
+                  << std::setprecision( 2 ) << std::setw( 10 ) << ( ( measurement.bytes > 0.0 ) ? raw_frame_bytes / measurement.bytes : 0.0 ) << std::endl;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef __AUTOTUNE__
+#define __AUTOTUNE__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "parameter.h"
+#include "profile.h"
+
+// Encoder Autotune
+// Encodes sample frames of each image stream in memory under candidate encoder profiles,
+// and reports encoding time and size, so a speed/size trade-off can be chosen per deployment.
+class Autotune
+{
+private:
+    // Sample Frames of Stream
+    struct Samples
+    {
+        std::string name;
+        std::vector<cv::Mat> images;
+        std::vector<EncoderProfile> candidates;
+
+        // Sample Selection (Every Stride-th New Frame)
+        uint64_t stride = 1;
+        uint64_t frames = 0;
+        double last_timestamp = 0.0;
+    };
+
+    Parameter parameter;
+    std::map<StreamKey, Samples> streams;
+
+public:
+    // Constructor
+    explicit Autotune( const Parameter& parameter );
+
+    // Processing
+    void run();
+
+private:
+    // Collect Sample Frames
+    inline void collect();
+
+    // Retrieve Candidate Profiles of Stream
+    inline std::vector<EncoderProfile> getCandidates( rs2_stream stream_type, const EncoderProfile& current );
+
+    // Measure and Report Candidate Profiles of Stream
+    inline void report( const Samples& samples );
+};
+
+#endif // __AUTOTUNE__
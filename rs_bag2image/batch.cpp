@@ -0,0 +1,126 @@
+#include "batch.h"
+#include "realsense.h"
+#include "shard.h"
+#include "trace.h"
+#include "version.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+// Constructor
+Batch::Batch( const Parameter& parameter )
+    : parameter( parameter )
+{
+    std::cout << "rs_bag2image " << RS_BAG2IMAGE_VERSION << " (" << parameter.bag_files.size() << " bag files)" << std::endl;
+
+    // Encoder Shared by All Conversions
+    encoder = std::make_shared<Encoder>( parameter.jobs, parameter.write_behind );
+
+    // Initialize Results
+    for( const filesystem::path& bag_file : parameter.bag_files ){
+        Result result;
+        result.bag_file = bag_file;
+        results.push_back( result );
+    }
+}
+
+// Processing
+std::size_t Batch::run()
+{
+    // Run Workers
+    const std::size_t num_workers = std::min<std::size_t>( parameter.concurrency, results.size() );
+    std::vector<std::thread> workers;
+    for( std::size_t i = 0; i < num_workers; i++ ){
+        workers.emplace_back( &Batch::work, this );
+    }
+    for( std::thread& worker : workers ){
+        worker.join();
+    }
+
+    // Show Summary
+    showSummary();
+
+    return std::count_if( results.begin(), results.end(), []( const Result& result ){ return !result.succeeded; } );
+}
+
+// Worker Thread (Convert Bag Files until All have been Taken)
+void Batch::work()
+{
+    Profiler::instance().setThreadName( "batch" );
+
+    while( true ){
+        const std::size_t index = next++;
+        if( index >= results.size() ){
+            break;
+        }
+
+        // Convert Bag File
+        Result& result = results[index];
+        convert( result );
+
+        // Show Result
+        std::lock_guard<std::mutex> lock( mutex );
+        std::cout << "[" << ++completed << "/" << results.size() << "] " << result.bag_file.generic_string() << " "
+                  << ( result.succeeded ? "done" : "failed" ) << " (" << std::fixed << std::setprecision( 1 ) << result.seconds << "s)";
+        if( !result.succeeded ){
+            std::cout << " " << result.message;
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Convert Bag File
+inline void Batch::convert( Result& result )
+{
+    Parameter bag_parameter = parameter;
+    bag_parameter.bag_file = result.bag_file;
+    bag_parameter.bag_files.clear();
+    bag_parameter.display = false;
+    bag_parameter.quiet = true;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    try{
+        if( !filesystem::is_regular_file( bag_parameter.bag_file ) ){
+            throw std::runtime_error( "failed can't find input bag file" );
+        }
+
+        if( bag_parameter.shards > 1 ){
+            Sharding sharding( bag_parameter, encoder );
+            sharding.run();
+        }
+        else{
+            RealSense realsense( bag_parameter, encoder );
+            realsense.run();
+        }
+        result.succeeded = true;
+    }
+    catch( std::exception& ex ){
+        result.message = ex.what();
+    }
+    catch( ... ){
+        result.message = "failed unknown error";
+    }
+    result.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+// Show Summary
+inline void Batch::showSummary()
+{
+    std::size_t failed = 0;
+    double seconds = 0.0;
+    std::cout << std::endl << "Summary:" << std::endl;
+    for( const Result& result : results ){
+        std::cout << "  " << ( result.succeeded ? "ok    " : "failed" ) << " " << std::fixed << std::setprecision( 1 ) << std::setw( 8 ) << result.seconds << "s  " << result.bag_file.generic_string();
+        if( !result.succeeded ){
+            std::cout << " (" << result.message << ")";
+            failed++;
+        }
+        std::cout << std::endl;
+        seconds += result.seconds;
+    }
+    std::cout << results.size() - failed << " succeeded, " << failed << " failed (" << std::fixed << std::setprecision( 1 ) << seconds << "s total conversion time)" << std::endl;
+}
@@ -0,0 +1,58 @@
+#ifndef __BATCH__
+#define __BATCH__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "encoder.h"
+#include "filesystem.h"
+#include "parameter.h"
+
+// Batch Conversion
+// Converts many bag files in one process with a limited number of concurrent conversions.
+// All conversions share one encoder, so -j is the thread budget of the whole batch.
+// A failed bag file doesn't stop the batch, and is reported in the summary.
+class Batch
+{
+private:
+    // Result of Bag File
+    struct Result
+    {
+        filesystem::path bag_file;
+        bool succeeded = false;
+        std::string message;
+        double seconds = 0.0;
+    };
+
+    Parameter parameter;
+    std::shared_ptr<Encoder> encoder;
+
+    // Results (Same Order as Bag Files)
+    std::vector<Result> results;
+    std::atomic<std::size_t> next{ 0 };
+    std::atomic<std::size_t> completed{ 0 };
+    std::mutex mutex;
+
+public:
+    // Constructor
+    explicit Batch( const Parameter& parameter );
+
+    // Processing
+    // Returns number of failed bag files.
+    std::size_t run();
+
+private:
+    // Worker Thread (Convert Bag Files until All have been Taken)
+    void work();
+
+    // Convert Bag File
+    inline void convert( Result& result );
+
+    // Show Summary
+    inline void showSummary();
+};
+
+#endif // __BATCH__
@@ -0,0 +1,264 @@
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+// Synthetic Bag Generator
+// Generate bag file with software device and recorder.
+// Color (RGB8/BGR8/RGBA8/YUYV), depth (Z16) and infrared (Y8) images are moving gradients with noise,
+// so that encoders see realistic (neither constant nor random) images.
+namespace
+{
+    // Pseudo Random Noise (xorshift32)
+    inline uint32_t noise( uint32_t& state )
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Bytes per Pixel of Format
+    int32_t getBytesPerPixel( rs2_format format )
+    {
+        switch( format ){
+            case rs2_format::RS2_FORMAT_RGB8:
+            case rs2_format::RS2_FORMAT_BGR8:
+                return 3;
+            case rs2_format::RS2_FORMAT_RGBA8:
+            case rs2_format::RS2_FORMAT_BGRA8:
+                return 4;
+            case rs2_format::RS2_FORMAT_YUYV:
+            case rs2_format::RS2_FORMAT_Z16:
+                return 2;
+            case rs2_format::RS2_FORMAT_Y8:
+                return 1;
+            default:
+                throw std::runtime_error( "failed unsupported format " + std::string( rs2_format_to_string( format ) ) );
+        }
+    }
+
+    // Create Image of Frame
+    uint8_t* createImage( rs2_format format, int32_t width, int32_t height, uint64_t index, uint32_t& state )
+    {
+        const int32_t bytes_per_pixel = getBytesPerPixel( format );
+        uint8_t* pixels = new uint8_t[static_cast<std::size_t>( width ) * height * bytes_per_pixel];
+        for( int32_t y = 0; y < height; y++ ){
+            uint8_t* row = pixels + static_cast<std::size_t>( y ) * width * bytes_per_pixel;
+            for( int32_t x = 0; x < width; x++ ){
+                const uint32_t random = noise( state );
+                const uint8_t value = static_cast<uint8_t>( ( x + y + index * 4 ) / 4 + ( random & 0x07 ) );
+                switch( format ){
+                    case rs2_format::RS2_FORMAT_Z16:{
+                        // 0.5-4.5m Slope, 1% Invalid
+                        const uint16_t depth = ( ( random >> 8 ) % 100 == 0 ) ? 0 : static_cast<uint16_t>( 500 + ( x * 4000 ) / width + ( index % 100 ) * 4 + ( random & 0x0F ) );
+                        std::memcpy( row + x * 2, &depth, sizeof( depth ) );
+                        break;
+                    }
+                    case rs2_format::RS2_FORMAT_YUYV:
+                        row[x * 2 + 0] = value;
+                        row[x * 2 + 1] = static_cast<uint8_t>( 128 + ( ( x & 1 ) ? y : x ) % 32 );
+                        break;
+                    case rs2_format::RS2_FORMAT_Y8:
+                        row[x] = value;
+                        break;
+                    default:
+                        for( int32_t c = 0; c < bytes_per_pixel; c++ ){
+                            row[x * bytes_per_pixel + c] = static_cast<uint8_t>( value + c * 64 + ( ( random >> ( 3 + c ) ) & 0x03 ) );
+                        }
+                        break;
+                }
+            }
+        }
+        return pixels;
+    }
+
+    // Parse Color Format
+    rs2_format getColorFormat( std::string name )
+    {
+        std::transform( name.begin(), name.end(), name.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+        const std::map<std::string, rs2_format> formats = {
+            { "rgb8", rs2_format::RS2_FORMAT_RGB8 }, { "bgr8", rs2_format::RS2_FORMAT_BGR8 },
+            { "rgba8", rs2_format::RS2_FORMAT_RGBA8 }, { "yuyv", rs2_format::RS2_FORMAT_YUYV }
+        };
+        const std::map<std::string, rs2_format>::const_iterator format = formats.find( name );
+        if( format == formats.end() ){
+            throw std::runtime_error( "failed unknown color format " + name );
+        }
+        return format->second;
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    const std::string keys =
+        "{ help h       |               | print this message.                                     }"
+        "{ output o     | synthetic.bag | output bag file.                                        }"
+        "{ width w      | 640           | frame width.                                            }"
+        "{ height       | 480           | frame height.                                           }"
+        "{ fps          | 30            | frame rate of image streams.                            }"
+        "{ duration     | 10            | duration in seconds.                                    }"
+        "{ color        | rgb8          | color format. rgb8, bgr8, rgba8 or yuyv. none disables. }"
+        "{ depth        | true          | enable depth stream. (z16)                              }"
+        "{ infrared     | 2             | number of infrared streams. [0-2] (y8)                  }"
+        "{ gyro         | 200           | gyro sample rate. 0 disables.                           }"
+        "{ accel        | 63            | accel sample rate. 0 disables.                          }"
+        "{ realtime     | false         | pace frames with wall clock, so bag duration is real.   }";
+    cv::CommandLineParser parser( argc, argv, keys );
+    if( parser.has( "help" ) ){
+        parser.printMessage();
+        return EXIT_SUCCESS;
+    }
+
+    try{
+        const std::string output = parser.get<cv::String>( "output" );
+        const int32_t width = std::max( 2, parser.get<int32_t>( "width" ) ) / 2 * 2;
+        const int32_t height = std::max( 1, parser.get<int32_t>( "height" ) );
+        const int32_t fps = std::max( 1, parser.get<int32_t>( "fps" ) );
+        const double duration = std::max( 0.0, parser.get<double>( "duration" ) );
+        const std::string color = parser.get<cv::String>( "color" );
+        const bool depth = parser.get<bool>( "depth" );
+        const int32_t infrared = std::min( std::max( 0, parser.get<int32_t>( "infrared" ) ), 2 );
+        const int32_t gyro_rate = std::max( 0, parser.get<int32_t>( "gyro" ) );
+        const int32_t accel_rate = std::max( 0, parser.get<int32_t>( "accel" ) );
+        const bool realtime = parser.get<bool>( "realtime" );
+
+        // Create Software Device
+        rs2::software_device device;
+        rs2_intrinsics intrinsics = { width, height, width / 2.0f, height / 2.0f, static_cast<float>( width ), static_cast<float>( width ), rs2_distortion::RS2_DISTORTION_NONE, { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f } };
+        int32_t uid = 0;
+
+        // Video Streams (Sensor, Profile, Format)
+        struct VideoStream
+        {
+            rs2::software_sensor* sensor;
+            rs2::stream_profile profile;
+            rs2_format format;
+        };
+        std::vector<VideoStream> video_streams;
+
+        rs2::software_sensor color_sensor = device.add_sensor( "RGB Camera" );
+        if( color != "none" ){
+            const rs2_format format = getColorFormat( color );
+            const rs2_video_stream stream = { rs2_stream::RS2_STREAM_COLOR, 0, uid++, width, height, fps, getBytesPerPixel( format ), format, intrinsics };
+            video_streams.push_back( { &color_sensor, color_sensor.add_video_stream( stream, true ), format } );
+        }
+
+        rs2::software_sensor stereo_sensor = device.add_sensor( "Stereo Module" );
+        if( depth ){
+            const rs2_video_stream stream = { rs2_stream::RS2_STREAM_DEPTH, 0, uid++, width, height, fps, 2, rs2_format::RS2_FORMAT_Z16, intrinsics };
+            video_streams.push_back( { &stereo_sensor, stereo_sensor.add_video_stream( stream, true ), rs2_format::RS2_FORMAT_Z16 } );
+            stereo_sensor.add_read_only_option( rs2_option::RS2_OPTION_DEPTH_UNITS, 0.001f );
+        }
+        for( int32_t index = 1; index <= infrared; index++ ){
+            const rs2_video_stream stream = { rs2_stream::RS2_STREAM_INFRARED, index, uid++, width, height, fps, 1, rs2_format::RS2_FORMAT_Y8, intrinsics };
+            video_streams.push_back( { &stereo_sensor, stereo_sensor.add_video_stream( stream, true ), rs2_format::RS2_FORMAT_Y8 } );
+        }
+
+        // Motion Streams
+        rs2::software_sensor motion_sensor = device.add_sensor( "Motion Module" );
+        const rs2_motion_device_intrinsic motion_intrinsics = {};
+        rs2::stream_profile gyro_profile;
+        rs2::stream_profile accel_profile;
+        if( 0 < gyro_rate ){
+            gyro_profile = motion_sensor.add_motion_stream( { rs2_stream::RS2_STREAM_GYRO, 0, uid++, gyro_rate, rs2_format::RS2_FORMAT_MOTION_XYZ32F, motion_intrinsics }, true );
+        }
+        if( 0 < accel_rate ){
+            accel_profile = motion_sensor.add_motion_stream( { rs2_stream::RS2_STREAM_ACCEL, 0, uid++, accel_rate, rs2_format::RS2_FORMAT_MOTION_XYZ32F, motion_intrinsics }, true );
+        }
+        device.create_matcher( RS2_MATCHER_DEFAULT );
+
+        // Start Recorder and Sensors
+        rs2::recorder recorder( output, device );
+        std::map<rs2::software_sensor*, std::vector<rs2::stream_profile>> sensor_profiles;
+        for( const VideoStream& video_stream : video_streams ){
+            sensor_profiles[video_stream.sensor].push_back( video_stream.profile );
+        }
+        if( gyro_profile ){
+            sensor_profiles[&motion_sensor].push_back( gyro_profile );
+        }
+        if( accel_profile ){
+            sensor_profiles[&motion_sensor].push_back( accel_profile );
+        }
+        if( sensor_profiles.empty() ){
+            throw std::runtime_error( "failed no stream is enabled" );
+        }
+        for( const std::pair<rs2::software_sensor* const, std::vector<rs2::stream_profile>>& sensor_profile : sensor_profiles ){
+            sensor_profile.first->open( sensor_profile.second );
+            sensor_profile.first->start( []( rs2::frame ){} );
+        }
+
+        // Generate Frames
+        const auto deleter = []( void* data ){ delete[] static_cast<uint8_t*>( data ); };
+        const int64_t num_frames = static_cast<int64_t>( duration * fps );
+        uint32_t state = 2463534242u;
+        int64_t gyro_index = 0;
+        int64_t accel_index = 0;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for( int64_t index = 0; index < num_frames; index++ ){
+            const double timestamp = index * 1000.0 / fps;
+
+            // Motion Samples until Frame Timestamp
+            const auto motion = [&]( const rs2::stream_profile& profile, int32_t rate, int64_t& sample_index, float scale ){
+                while( profile && sample_index * 1000.0 / rate <= timestamp ){
+                    float* data = reinterpret_cast<float*>( new uint8_t[sizeof( float ) * 3] );
+                    data[0] = scale * static_cast<float>( sample_index % 100 ) / 100.0f;
+                    data[1] = scale;
+                    data[2] = -scale;
+
+                    rs2_software_motion_frame frame = {};
+                    frame.data = data;
+                    frame.deleter = deleter;
+                    frame.timestamp = sample_index * 1000.0 / rate;
+                    frame.domain = rs2_timestamp_domain::RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK;
+                    frame.frame_number = static_cast<int32_t>( sample_index++ );
+                    frame.profile = profile.get();
+                    motion_sensor.on_motion_frame( frame );
+                }
+            };
+            motion( gyro_profile, gyro_rate, gyro_index, 0.1f );
+            motion( accel_profile, accel_rate, accel_index, 9.8f );
+
+            // Video Frames
+            for( const VideoStream& video_stream : video_streams ){
+                const int32_t bytes_per_pixel = getBytesPerPixel( video_stream.format );
+                rs2_software_video_frame frame = {};
+                frame.pixels = createImage( video_stream.format, width, height, index, state );
+                frame.deleter = deleter;
+                frame.stride = width * bytes_per_pixel;
+                frame.bpp = bytes_per_pixel;
+                frame.timestamp = timestamp;
+                frame.domain = rs2_timestamp_domain::RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK;
+                frame.frame_number = static_cast<int32_t>( index );
+                frame.profile = video_stream.profile.get();
+                video_stream.sensor->on_video_frame( frame );
+            }
+
+            // Pace Frames with Wall Clock
+            if( realtime ){
+                std::this_thread::sleep_until( start + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double, std::milli>( timestamp + 1000.0 / fps ) ) );
+            }
+
+            std::cout << "\rGenerate: " << index + 1 << "/" << num_frames << std::flush;
+        }
+        std::cout << std::endl;
+
+        // Stop Sensors (Recorder Writes File at Destruction)
+        for( const std::pair<rs2::software_sensor* const, std::vector<rs2::stream_profile>>& sensor_profile : sensor_profiles ){
+            sensor_profile.first->stop();
+            sensor_profile.first->close();
+        }
+    }
+    catch( std::exception& ex ){
+        std::cout << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#include <iomanip>
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "../convert.h"
+
+// Convert Benchmark
+// Measure conversion time per frame for each format,
+// baseline (clone and convert in place, previous implementation) versus convert kernel.
+int main( int argc, char* argv[] )
+{
+    const std::string keys =
+        "{ help h       |      | print this message.          }"
+        "{ width w      | 1280 | frame width.                 }"
+        "{ height       | 720  | frame height.                }"
+        "{ iterations n | 300  | number of frames per format. }";
+    cv::CommandLineParser parser( argc, argv, keys );
+    if( parser.has( "help" ) ){
+        parser.printMessage();
+        return EXIT_SUCCESS;
+    }
+
+    const int32_t width = parser.get<int32_t>( "width" );
+    const int32_t height = parser.get<int32_t>( "height" );
+    const int32_t iterations = std::max( 1, parser.get<int32_t>( "iterations" ) );
+
+    // Baseline Conversion (clone and convert in place)
+    struct Case
+    {
+        rs2_format format;
+        int32_t type;
+        std::function<void( cv::Mat& )> baseline;
+    };
+    constexpr double y16_scaling = static_cast<double>( std::numeric_limits<uint8_t>::max() ) / static_cast<double>( std::numeric_limits<uint16_t>::max() );
+    const std::vector<Case> cases = {
+        { rs2_format::RS2_FORMAT_RGB8,  CV_8UC3,  []( cv::Mat& mat ){ cv::cvtColor( mat, mat, cv::COLOR_RGB2BGR ); } },
+        { rs2_format::RS2_FORMAT_RGBA8, CV_8UC4,  []( cv::Mat& mat ){ cv::cvtColor( mat, mat, cv::COLOR_RGBA2BGRA ); } },
+        { rs2_format::RS2_FORMAT_BGR8,  CV_8UC3,  []( cv::Mat& ){} },
+        { rs2_format::RS2_FORMAT_BGRA8, CV_8UC4,  []( cv::Mat& ){} },
+        { rs2_format::RS2_FORMAT_Y8,    CV_8UC1,  []( cv::Mat& ){} },
+        { rs2_format::RS2_FORMAT_Y16,   CV_16UC1, [=]( cv::Mat& mat ){ mat.convertTo( mat, CV_8U, y16_scaling ); } },
+        { rs2_format::RS2_FORMAT_Z16,   CV_16UC1, []( cv::Mat& ){} },
+        { rs2_format::RS2_FORMAT_YUYV,  CV_8UC2,  []( cv::Mat& mat ){ cv::cvtColor( mat, mat, cv::COLOR_YUV2BGR_YUYV ); } },
+        { rs2_format::RS2_FORMAT_UYVY,  CV_8UC2,  []( cv::Mat& mat ){ cv::cvtColor( mat, mat, cv::COLOR_YUV2GRAY_UYVY ); } },
+    };
+
+    std::cout << "convert benchmark " << width << "x" << height << ", " << iterations << " frames" << std::endl;
+    std::cout << std::left << std::setw( 8 ) << "format" << std::right << std::setw( 14 ) << "baseline [ms]" << std::setw( 14 ) << "kernel [ms]" << std::setw( 10 ) << "speedup" << std::setw( 10 ) << "match" << std::endl;
+
+    for( const Case& test : cases ){
+        // Create Source Frame (Random Data)
+        cv::Mat source( height, width, test.type );
+        cv::randu( source, cv::Scalar::all( 0 ), cv::Scalar::all( ( CV_MAT_DEPTH( test.type ) == CV_16U ) ? 65536 : 256 ) );
+        const int32_t stride = static_cast<int32_t>( source.step[0] );
+
+        // Baseline
+        cv::Mat baseline;
+        const std::chrono::steady_clock::time_point baseline_start = std::chrono::steady_clock::now();
+        for( int32_t i = 0; i < iterations; i++ ){
+            baseline = cv::Mat( height, width, test.type, source.data ).clone();
+            test.baseline( baseline );
+        }
+        const std::chrono::duration<double, std::milli> baseline_time = std::chrono::steady_clock::now() - baseline_start;
+
+        // Convert Kernel
+        const ConvertKernel convert = getConvertKernel( test.format );
+        cv::Mat kernel;
+        const std::chrono::steady_clock::time_point kernel_start = std::chrono::steady_clock::now();
+        for( int32_t i = 0; i < iterations; i++ ){
+            convert( source.data, width, height, stride, kernel );
+        }
+        const std::chrono::duration<double, std::milli> kernel_time = std::chrono::steady_clock::now() - kernel_start;
+
+        // Verify Output
+        const bool match = ( baseline.size() == kernel.size() ) && ( baseline.type() == kernel.type() ) && ( cv::norm( baseline, kernel, cv::NORM_INF ) == 0.0 );
+
+        std::cout << std::left << std::setw( 8 ) << rs2_format_to_string( test.format ) << std::right << std::fixed << std::setprecision( 3 );
+        std::cout << std::setw( 14 ) << baseline_time.count() / iterations;
+        std::cout << std::setw( 14 ) << kernel_time.count() / iterations;
+        std::cout << std::setw( 9 ) << std::setprecision( 1 ) << baseline_time.count() / kernel_time.count() << "x";
+        std::cout << std::setw( 10 ) << ( match ? "yes" : "NO" ) << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
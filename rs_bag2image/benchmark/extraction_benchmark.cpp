@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "../filesystem.h"
+#include "../parameter.h"
+#include "../realsense.h"
+#include "../trace.h"
+#include "../version.h"
+
+// Extraction Benchmark
+// Run full extraction of bag file (e.g. synthetic bag of bag_generator) several times,
+// and report time, frames/s and MB/s of each stage (busy time recorded by profiler) and throughput of each stream as JSON.
+// Output is extracted into a temporary directory that is deleted at exit, or into the given output directory.
+namespace
+{
+    // Statistics of Stream Output
+    struct StreamStatistics
+    {
+        uint64_t frames = 0;
+        uint64_t input_bytes = 0;  // decoded frame size
+        uint64_t output_bytes = 0; // files on disk
+    };
+
+    // Result of Run
+    struct Run
+    {
+        double open_seconds = 0.0;
+        double extract_seconds = 0.0;
+        std::map<std::string, StreamStatistics> streams;
+        std::map<std::string, Profiler::Stage> stages;
+        std::map<std::string, uint64_t> counters;
+    };
+
+    // Temporary Directory (Deleted at Exit)
+    class TemporaryDirectory
+    {
+    private:
+        filesystem::path path;
+
+    public:
+        explicit TemporaryDirectory( const filesystem::path& path ) : path( path ){}
+
+        ~TemporaryDirectory()
+        {
+            if( !path.empty() ){
+                std::error_code error;
+                filesystem::remove_all( path, error );
+            }
+        }
+
+        TemporaryDirectory( const TemporaryDirectory& ) = delete;
+        TemporaryDirectory& operator=( const TemporaryDirectory& ) = delete;
+    };
+
+    // Bytes per Pixel of Format Name
+    uint64_t getBytesPerPixel( const std::string& format )
+    {
+        const std::map<std::string, uint64_t> bytes_per_pixel = {
+            { "RGB8", 3 }, { "BGR8", 3 }, { "RGBA8", 4 }, { "BGRA8", 4 }, { "Y8", 1 }, { "Y16", 2 }, { "Z16", 2 }, { "YUYV", 2 }, { "UYVY", 2 }
+        };
+        const std::map<std::string, uint64_t>::const_iterator found = bytes_per_pixel.find( format );
+        return ( found != bytes_per_pixel.end() ) ? found->second : 0;
+    }
+
+    // Collect Statistics of Stream Directory
+    // Frames and decoded size from metadata (frame_number,timestamp,width,height,format), or rows of imu csv.
+    StreamStatistics collect( const filesystem::path& directory )
+    {
+        StreamStatistics statistics;
+        for( const filesystem::directory_entry& entry : filesystem::directory_iterator( directory ) ){
+            if( !filesystem::is_regular_file( entry.path() ) ){
+                continue;
+            }
+            statistics.output_bytes += filesystem::file_size( entry.path() );
+            if( entry.path().extension() != ".csv" || entry.path().stem().string().find( "_index" ) != std::string::npos || entry.path().stem().string().find( "_info" ) != std::string::npos ){
+                continue;
+            }
+
+            std::ifstream csv( entry.path().string() );
+            std::string line;
+            std::getline( csv, line );
+            const bool metadata = ( entry.path().stem() == "metadata" );
+            while( std::getline( csv, line ) ){
+                statistics.frames++;
+                if( !metadata ){
+                    statistics.input_bytes += 3 * sizeof( float );
+                    continue;
+                }
+
+                std::vector<std::string> fields;
+                std::istringstream iss( line );
+                std::string field;
+                while( std::getline( iss, field, ',' ) ){
+                    fields.push_back( field );
+                }
+                if( fields.size() >= 5 ){
+                    statistics.input_bytes += std::stoull( fields[2] ) * std::stoull( fields[3] ) * getBytesPerPixel( fields[4] );
+                }
+            }
+        }
+        return statistics;
+    }
+
+    // Retrieve Bytes Processed by Stage (0 is Unknown)
+    // convert/<Stream> reads decoded frames and save/<Stream> writes output of stream, and writers count bytes they write.
+    uint64_t getStageBytes( const std::string& stage, const Run& run )
+    {
+        const std::size_t slash = stage.find( '/' );
+        const std::string kind = stage.substr( 0, slash );
+        if( slash != std::string::npos && ( kind == "convert" || kind == "save" ) ){
+            const std::string stream = stage.substr( slash + 1 );
+            const std::vector<std::string> directories = ( stream == "Infrared" ) ? std::vector<std::string>{ "IR", "IR_Right" } : std::vector<std::string>{ stream };
+            uint64_t bytes = 0;
+            for( const std::string& directory : directories ){
+                const std::map<std::string, StreamStatistics>::const_iterator found = run.streams.find( directory );
+                if( found != run.streams.end() ){
+                    bytes += ( kind == "convert" ) ? found->second.input_bytes : found->second.output_bytes;
+                }
+            }
+            return bytes;
+        }
+
+        const std::map<std::string, std::string> counters = {
+            { "imencode", "bytes/images" }, { "imwrite", "bytes/images" }, { "archive", "bytes/archive" }, { "cloud/write", "bytes/point_cloud" }, { "rosbag/decompress", "bytes/decompress" }
+        };
+        const std::map<std::string, std::string>::const_iterator counter = counters.find( stage );
+        if( counter == counters.end() ){
+            return 0;
+        }
+        const std::map<std::string, uint64_t>::const_iterator found = run.counters.find( counter->second );
+        return ( found != run.counters.end() ) ? found->second : 0;
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    const std::string keys =
+        "{ help h   |                | print this message.                                 }"
+        "{ bag b    |                | input bag file. (required)                          }"
+        "{ jobs j   | 0              | number of encoder threads.                          }"
+        "{ runs r   | 3              | number of runs.                                     }"
+        "{ imu i    | false          | extract every imu sample. (bool)                    }"
+        "{ output o |                | output directory. default is temporary directory.   }"
+        "{ json     | benchmark.json | output json file.                                   }";
+    cv::CommandLineParser parser( argc, argv, keys );
+    if( parser.has( "help" ) || !parser.has( "bag" ) ){
+        parser.printMessage();
+        return parser.has( "help" ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    try{
+        Parameter parameter;
+        parameter.bag_file = parser.get<cv::String>( "bag" ).c_str();
+        parameter.jobs = static_cast<uint32_t>( std::max( 0, parser.get<int32_t>( "jobs" ) ) );
+        parameter.imu_lossless = parser.get<bool>( "imu" );
+        parameter.quiet = true;
+        const int32_t runs = std::max( 1, parser.get<int32_t>( "runs" ) );
+
+        // Output Directory (Given Directory is Kept, Temporary Directory is Deleted at Exit)
+        // Only the extraction of this benchmark is deleted between runs, so an existing extraction is never touched.
+        std::unique_ptr<TemporaryDirectory> temporary_directory;
+        if( parser.has( "output" ) ){
+            parameter.output_directory = parser.get<cv::String>( "output" ).c_str();
+        }
+        else{
+            parameter.output_directory = filesystem::temp_directory_path() / ( "extraction_benchmark_" + std::to_string( std::chrono::steady_clock::now().time_since_epoch().count() ) );
+            temporary_directory = std::make_unique<TemporaryDirectory>( parameter.output_directory );
+        }
+        const filesystem::path directory = parameter.output_directory / parameter.bag_file.stem();
+        if( filesystem::exists( directory ) ){
+            throw std::runtime_error( "failed output directory already exists " + directory.generic_string() );
+        }
+        filesystem::create_directories( parameter.output_directory );
+
+        std::vector<Run> results;
+        for( int32_t i = 0; i < runs; i++ ){
+            if( i > 0 ){
+                filesystem::remove_all( directory );
+            }
+
+            // Record Stages of Run
+            Profiler& profiler = Profiler::instance();
+            profiler.reset();
+            profiler.enable();
+
+            // Open (Initialize Sensor and Save)
+            Run run;
+            const std::chrono::steady_clock::time_point open_start = std::chrono::steady_clock::now();
+            {
+                RealSense realsense( parameter );
+                const std::chrono::steady_clock::time_point extract_start = std::chrono::steady_clock::now();
+                run.open_seconds = std::chrono::duration<double>( extract_start - open_start ).count();
+
+                // Extract (Decode, Convert, Encode and Write)
+                realsense.run();
+            }
+            run.extract_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - open_start ).count() - run.open_seconds;
+            profiler.collect( run.stages, run.counters );
+
+            // Collect Statistics of Each Stream
+            for( const filesystem::directory_entry& entry : filesystem::directory_iterator( directory ) ){
+                if( filesystem::is_directory( entry.path() ) ){
+                    run.streams[entry.path().filename().string()] = collect( entry.path() );
+                }
+            }
+
+            std::cout << "run " << i + 1 << "/" << runs << ": " << std::fixed << std::setprecision( 3 ) << run.extract_seconds << "s" << std::endl;
+            results.push_back( run );
+        }
+
+        // Best Run (Shortest Extraction)
+        const std::size_t best = std::distance( results.begin(), std::min_element( results.begin(), results.end(), []( const Run& a, const Run& b ){ return a.extract_seconds < b.extract_seconds; } ) );
+
+        // Write JSON
+        std::ofstream json( parser.get<cv::String>( "json" ) );
+        json << std::fixed << std::setprecision( 6 );
+        json << "{\n";
+        json << "  \"version\": \"" << RS_BAG2IMAGE_VERSION << "\",\n";
+        json << "  \"bag\": \"" << parameter.bag_file.generic_string() << "\",\n";
+        json << "  \"jobs\": " << parameter.jobs << ",\n";
+        json << "  \"best\": " << best << ",\n";
+        json << "  \"runs\": [\n";
+        for( std::size_t i = 0; i < results.size(); i++ ){
+            const Run& run = results[i];
+            json << "    {\n";
+            json << "      \"stages\": {\n";
+            json << "        \"open\": { \"seconds\": " << run.open_seconds << " },\n";
+            json << "        \"extract\": { \"seconds\": " << run.extract_seconds << " }" << ( run.stages.empty() ? "" : "," ) << "\n";
+            std::size_t k = 0;
+            for( const std::pair<const std::string, Profiler::Stage>& stage : run.stages ){
+                const double seconds = std::max( stage.second.total / 1e9, 1e-9 );
+                const uint64_t bytes = getStageBytes( stage.first, run );
+                json << "        \"" << stage.first << "\": { "
+                     << "\"count\": " << stage.second.count << ", "
+                     << "\"seconds\": " << stage.second.total / 1e9 << ", "
+                     << "\"frames_per_second\": " << stage.second.count / seconds;
+                if( bytes > 0 ){
+                    json << ", \"bytes\": " << bytes << ", \"mb_per_second\": " << bytes / seconds / 1e6;
+                }
+                json << " }" << ( ( ++k < run.stages.size() ) ? "," : "" ) << "\n";
+            }
+            json << "      },\n";
+            json << "      \"counters\": {";
+            std::size_t l = 0;
+            for( const std::pair<const std::string, uint64_t>& counter : run.counters ){
+                json << ( ( l++ == 0 ) ? " " : ", " ) << "\"" << counter.first << "\": " << counter.second;
+            }
+            json << " },\n";
+            json << "      \"streams\": {\n";
+            std::size_t j = 0;
+            for( const std::pair<const std::string, StreamStatistics>& stream : run.streams ){
+                const StreamStatistics& statistics = stream.second;
+                const double seconds = std::max( run.extract_seconds, 1e-9 );
+                json << "        \"" << stream.first << "\": { "
+                     << "\"frames\": " << statistics.frames << ", "
+                     << "\"frames_per_second\": " << statistics.frames / seconds << ", "
+                     << "\"input_bytes\": " << statistics.input_bytes << ", "
+                     << "\"input_mb_per_second\": " << statistics.input_bytes / seconds / 1e6 << ", "
+                     << "\"output_bytes\": " << statistics.output_bytes << ", "
+                     << "\"output_mb_per_second\": " << statistics.output_bytes / seconds / 1e6 << " }"
+                     << ( ( ++j < run.streams.size() ) ? "," : "" ) << "\n";
+            }
+            json << "      }\n";
+            json << "    }" << ( ( i + 1 < results.size() ) ? "," : "" ) << "\n";
+        }
+        json << "  ]\n";
+        json << "}\n";
+        if( !json ){
+            throw std::runtime_error( "failed can't write json" );
+        }
+
+        // Show Best Run
+        const Run& run = results[best];
+        std::cout << std::endl << "best run: open " << std::setprecision( 3 ) << run.open_seconds << "s, extract " << run.extract_seconds << "s" << std::endl;
+        for( const std::pair<const std::string, StreamStatistics>& stream : run.streams ){
+            std::cout << "  " << std::left << std::setw( 10 ) << stream.first << std::right << std::setprecision( 1 )
+                      << std::setw( 10 ) << stream.second.frames / run.extract_seconds << " frames/s"
+                      << std::setw( 10 ) << stream.second.input_bytes / run.extract_seconds / 1e6 << " MB/s in"
+                      << std::setw( 10 ) << stream.second.output_bytes / run.extract_seconds / 1e6 << " MB/s out" << std::endl;
+        }
+        std::cout << std::endl << std::left << std::setw( 24 ) << "stage" << std::right << std::setw( 10 ) << "count" << std::setw( 12 ) << "busy [s]" << std::setw( 14 ) << "frames/s" << std::setw( 12 ) << "MB/s" << std::endl;
+        for( const std::pair<const std::string, Profiler::Stage>& stage : run.stages ){
+            const double seconds = std::max( stage.second.total / 1e9, 1e-9 );
+            const uint64_t bytes = getStageBytes( stage.first, run );
+            std::cout << std::left << std::setw( 24 ) << stage.first << std::right << std::setw( 10 ) << stage.second.count
+                      << std::setprecision( 3 ) << std::setw( 12 ) << stage.second.total / 1e9
+                      << std::setprecision( 1 ) << std::setw( 14 ) << stage.second.count / seconds;
+            if( bytes > 0 ){
+                std::cout << std::setw( 12 ) << bytes / seconds / 1e6;
+            }
+            std::cout << std::endl;
+        }
+    }
+    catch( std::exception& ex ){
+        std::cout << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
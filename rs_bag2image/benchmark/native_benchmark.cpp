@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../filesystem.h"
+#include "../parameter.h"
+#include "../reader.h"
+#include "../version.h"
+
+// Native Reader Benchmark
+// Read all framesets of bag file with playback of librealsense and with native reader several times,
+// check both readers deliver same frames (frame number, timestamp and data of each stream in order),
+// and report time and throughput of each reader as JSON.
+namespace
+{
+    // Statistics of Stream
+    struct StreamStatistics
+    {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        uint64_t hash = 14695981039346656037ull; // FNV-1a of frames in order
+    };
+
+    // Result of Run
+    struct Run
+    {
+        double open_seconds = 0.0;
+        double read_seconds = 0.0;
+        std::map<std::string, StreamStatistics> streams;
+    };
+
+    // Update FNV-1a Hash
+    inline void hash( uint64_t& value, const void* data, std::size_t size )
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>( data );
+        for( std::size_t i = 0; i < size; i++ ){
+            value = ( value ^ bytes[i] ) * 1099511628211ull;
+        }
+    }
+
+    // Read All Framesets
+    Run read( const Parameter& parameter )
+    {
+        Run run;
+        const std::chrono::steady_clock::time_point open_start = std::chrono::steady_clock::now();
+        BagReader reader( parameter );
+        const std::chrono::steady_clock::time_point read_start = std::chrono::steady_clock::now();
+        run.open_seconds = std::chrono::duration<double>( read_start - open_start ).count();
+
+        rs2::frameset frameset;
+        while( reader.read( frameset ) ){
+            #if 29 < RS2_API_MINOR_VERSION
+            frameset.foreach_rs( [&]( const rs2::frame& frame ){
+            #else
+            frameset.foreach( [&]( const rs2::frame& frame ){
+            #endif
+                StreamStatistics& statistics = run.streams[frame.get_profile().stream_name()];
+                const unsigned long long frame_number = frame.get_frame_number();
+                const double timestamp = frame.get_timestamp();
+                const std::size_t size = static_cast<std::size_t>( frame.get_data_size() );
+                hash( statistics.hash, &frame_number, sizeof( frame_number ) );
+                hash( statistics.hash, &timestamp, sizeof( timestamp ) );
+                hash( statistics.hash, frame.get_data(), size );
+                statistics.frames++;
+                statistics.bytes += size;
+            } );
+        }
+        run.read_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - read_start ).count();
+        return run;
+    }
+
+    // Check Runs Delivered Same Frames
+    bool match( const Run& a, const Run& b )
+    {
+        if( a.streams.size() != b.streams.size() ){
+            return false;
+        }
+        for( const std::pair<const std::string, StreamStatistics>& stream : a.streams ){
+            const std::map<std::string, StreamStatistics>::const_iterator found = b.streams.find( stream.first );
+            if( found == b.streams.end() || found->second.frames != stream.second.frames || found->second.hash != stream.second.hash ){
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    const std::string keys =
+        "{ help h   |                       | print this message.                       }"
+        "{ bag b    |                       | input bag file. (required)                }"
+        "{ runs r   | 3                     | number of runs of each reader.            }"
+        "{ imu i    | false                 | exclude imu streams as -i does. (bool)    }"
+        "{ json o   | native_benchmark.json | output json file.                         }";
+    cv::CommandLineParser parser( argc, argv, keys );
+    if( parser.has( "help" ) || !parser.has( "bag" ) ){
+        parser.printMessage();
+        return parser.has( "help" ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    bool matched = true;
+    try{
+        Parameter parameter;
+        parameter.bag_file = parser.get<cv::String>( "bag" ).c_str();
+        parameter.imu_lossless = parser.get<bool>( "imu" );
+        parameter.quiet = true;
+        const int32_t runs = std::max( 1, parser.get<int32_t>( "runs" ) );
+
+        // Run Each Reader (Best Run is Shortest Read)
+        std::map<std::string, Run> best;
+        for( const bool native : { false, true } ){
+            const std::string name = native ? "native" : "playback";
+            parameter.native = native;
+            for( int32_t i = 0; i < runs; i++ ){
+                const Run run = read( parameter );
+                std::cout << name << " run " << i + 1 << "/" << runs << ": " << std::fixed << std::setprecision( 3 ) << run.read_seconds << "s" << std::endl;
+                if( best.count( name ) == 0 || run.read_seconds < best[name].read_seconds ){
+                    best[name] = run;
+                }
+            }
+        }
+        matched = match( best["playback"], best["native"] );
+
+        // Write JSON
+        std::ofstream json( parser.get<cv::String>( "json" ) );
+        json << std::fixed << std::setprecision( 6 );
+        json << "{\n";
+        json << "  \"version\": \"" << RS_BAG2IMAGE_VERSION << "\",\n";
+        json << "  \"bag\": \"" << parameter.bag_file.generic_string() << "\",\n";
+        json << "  \"runs\": " << runs << ",\n";
+        json << "  \"match\": " << ( matched ? "true" : "false" ) << ",\n";
+        json << "  \"readers\": {\n";
+        std::size_t i = 0;
+        for( const std::pair<const std::string, Run>& reader : best ){
+            const Run& run = reader.second;
+            const double seconds = std::max( run.read_seconds, 1e-9 );
+            json << "    \"" << reader.first << "\": {\n";
+            json << "      \"stages\": { \"open\": { \"seconds\": " << run.open_seconds << " }, \"read\": { \"seconds\": " << run.read_seconds << " } },\n";
+            json << "      \"streams\": {\n";
+            std::size_t j = 0;
+            for( const std::pair<const std::string, StreamStatistics>& stream : run.streams ){
+                const StreamStatistics& statistics = stream.second;
+                json << "        \"" << stream.first << "\": { "
+                     << "\"frames\": " << statistics.frames << ", "
+                     << "\"frames_per_second\": " << statistics.frames / seconds << ", "
+                     << "\"bytes\": " << statistics.bytes << ", "
+                     << "\"mb_per_second\": " << statistics.bytes / seconds / 1e6 << ", "
+                     << "\"hash\": \"" << std::hex << std::setw( 16 ) << std::setfill( '0' ) << statistics.hash << std::dec << std::setfill( ' ' ) << "\" }"
+                     << ( ( ++j < run.streams.size() ) ? "," : "" ) << "\n";
+            }
+            json << "      }\n";
+            json << "    }" << ( ( ++i < best.size() ) ? "," : "" ) << "\n";
+        }
+        json << "  }\n";
+        json << "}\n";
+        if( !json ){
+            throw std::runtime_error( "failed can't write json" );
+        }
+
+        // Show Best Runs
+        std::cout << std::endl;
+        for( const std::pair<const std::string, Run>& reader : best ){
+            const Run& run = reader.second;
+            std::cout << std::left << std::setw( 10 ) << reader.first << std::right << std::setprecision( 3 ) << "open " << run.open_seconds << "s, read " << run.read_seconds << "s" << std::endl;
+            for( const std::pair<const std::string, StreamStatistics>& stream : run.streams ){
+                std::cout << "  " << std::left << std::setw( 10 ) << stream.first << std::right << std::setprecision( 1 )
+                          << std::setw( 10 ) << stream.second.frames / run.read_seconds << " frames/s"
+                          << std::setw( 10 ) << stream.second.bytes / run.read_seconds / 1e6 << " MB/s" << std::endl;
+            }
+        }
+        std::cout << std::setprecision( 2 ) << "speedup " << best["playback"].read_seconds / std::max( best["native"].read_seconds, 1e-9 ) << "x, "
+                  << ( matched ? "frames match" : "frames DON'T match" ) << std::endl;
+    }
+    catch( std::exception& ex ){
+        std::cout << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,106 @@
+#include "checkpoint.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// Constructor
+Checkpoint::Checkpoint( const filesystem::path& directory )
+    : directory( directory )
+{
+}
+
+// Load Manifest
+bool Checkpoint::load()
+{
+    std::ifstream manifest( getPath().string() );
+    if( !manifest.is_open() ){
+        return false;
+    }
+
+    position = 0;
+    complete = false;
+    streams.clear();
+    files.clear();
+
+    std::string line;
+    while( std::getline( manifest, line ) ){
+        std::vector<std::string> fields;
+        std::istringstream iss( line );
+        std::string field;
+        while( std::getline( iss, field, ',' ) ){
+            fields.push_back( field );
+        }
+        if( fields.empty() ){
+            continue;
+        }
+
+        try{
+            if( fields[0] == "position" && fields.size() == 2 ){
+                position = std::stoull( fields[1] );
+            }
+            else if( fields[0] == "complete" && fields.size() == 2 ){
+                complete = ( fields[1] == "1" );
+            }
+            else if( fields[0] == "stream" && fields.size() == 5 ){
+                Stream& stream = streams[StreamKey( static_cast<rs2_stream>( std::stoi( fields[1] ) ), std::stoi( fields[2] ) )];
+                stream.timestamp = std::stod( fields[3] );
+                stream.frames = std::stoull( fields[4] );
+            }
+            else if( fields[0] == "file" && fields.size() == 3 ){
+                files[fields[1]] = std::stoull( fields[2] );
+            }
+        }
+        catch( const std::exception& ){
+            throw std::runtime_error( "failed invalid checkpoint " + getPath().generic_string() );
+        }
+    }
+
+    return true;
+}
+
+// Save Manifest (Atomic)
+void Checkpoint::save()
+{
+    // Write Temporary File
+    const filesystem::path path = getPath();
+    const filesystem::path temporary_path = path.string() + ".tmp";
+    {
+        std::ofstream manifest( temporary_path.string(), std::ios::trunc );
+        manifest << std::fixed << std::setprecision( 6 );
+        manifest << "position," << position << "\n";
+        manifest << "complete," << ( complete ? 1 : 0 ) << "\n";
+        for( const std::pair<const StreamKey, Stream>& stream : streams ){
+            manifest << "stream," << static_cast<int32_t>( stream.first.first ) << "," << stream.first.second << "," << stream.second.timestamp << "," << stream.second.frames << "\n";
+        }
+        for( const std::pair<const std::string, uint64_t>& file : files ){
+            manifest << "file," << file.first << "," << file.second << "\n";
+        }
+        manifest.flush();
+        if( !manifest ){
+            throw std::runtime_error( "failed can't write " + temporary_path.generic_string() );
+        }
+    }
+
+    // Replace Manifest
+    filesystem::rename( temporary_path, path );
+}
+
+// Restore Files to Checkpoint (Truncate Rows Written after Checkpoint)
+void Checkpoint::restore()
+{
+    for( const std::pair<const std::string, uint64_t>& file : files ){
+        const filesystem::path path = directory / file.first;
+        if( filesystem::exists( path ) && file.second < filesystem::file_size( path ) ){
+            filesystem::resize_file( path, file.second );
+        }
+    }
+}
+
+// Retrieve Manifest File Path
+filesystem::path Checkpoint::getPath() const
+{
+    return directory / "checkpoint.csv";
+}
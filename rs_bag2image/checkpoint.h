@@ -0,0 +1,55 @@
+#ifndef __CHECKPOINT__
+#define __CHECKPOINT__
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "filesystem.h"
+#include "parameter.h"
+
+// Checkpoint Manifest
+// Records progress of extraction in output directory (checkpoint.csv), so an interrupted extraction can be resumed.
+// A checkpoint is taken only after all images before it have been written and all CSV files have been flushed,
+// and it is written to a temporary file and renamed, so the manifest on disk is always complete.
+//   position : playback position of last frame [ns]
+//   complete : extraction has finished
+//   stream   : last saved timestamp and number of saved frames of each stream
+//   file     : committed size of each CSV file (rows after it are removed at resume)
+class Checkpoint
+{
+public:
+    // Progress of Stream
+    struct Stream
+    {
+        double timestamp = 0.0; // last saved frame timestamp [ms]
+        uint64_t frames = 0;
+    };
+
+    uint64_t position = 0;
+    bool complete = false;
+    std::map<StreamKey, Stream> streams;
+    std::map<std::string, uint64_t> files; // relative path from output directory, committed size [bytes]
+
+private:
+    filesystem::path directory;
+
+public:
+    // Constructor
+    explicit Checkpoint( const filesystem::path& directory );
+
+    // Load Manifest
+    // Return false if there is no manifest.
+    bool load();
+
+    // Save Manifest (Atomic)
+    void save();
+
+    // Restore Files to Checkpoint (Truncate Rows Written after Checkpoint)
+    void restore();
+
+    // Retrieve Manifest File Path
+    filesystem::path getPath() const;
+};
+
+#endif // __CHECKPOINT__
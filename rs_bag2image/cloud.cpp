@@ -0,0 +1,384 @@
+#include "cloud.h"
+#include "trace.h"
+
+#include <librealsense2/rsutil.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+// Constructor
+CloudStream::CloudStream( const filesystem::path& directory, Format format, const rs2::video_stream_profile& depth_profile, float depth_scale, uint32_t stride, double voxel_size, const rs2::stream_profile& color_profile, std::chrono::steady_clock::duration flush_interval, std::size_t queue_capacity )
+    : directory( directory ), format( format ), rays( depth_profile.get_intrinsics() ), depth_scale( depth_scale ), stride( std::max<uint32_t>( stride, 1 ) ), voxel_size( static_cast<float>( voxel_size ) ), tasks( queue_capacity )
+{
+    if( depth_scale <= 0.0f ){
+        throw std::runtime_error( "failed point cloud needs depth scale" );
+    }
+
+    // Retrieve Color Intrinsics and Depth to Color Extrinsics for Texture
+    if( color_profile ){
+        textured = true;
+        color_intrinsics = color_profile.as<rs2::video_stream_profile>().get_intrinsics();
+        depth_to_color = depth_profile.get_extrinsics_to( color_profile );
+    }
+
+    // Open Packed Stream (Header and Index)
+    if( format == Format::Packed ){
+        const filesystem::path path = directory / "cloud.bin";
+        file = std::fopen( path.string().c_str(), "wb" );
+        if( !file ){
+            throw std::runtime_error( "failed can't open point cloud " + path.generic_string() );
+        }
+
+        char header[16] = "RSCLOUD";
+        const uint32_t version = 1;
+        const uint32_t flags = ( textured ) ? 1 : 0;
+        std::memcpy( header + 8, &version, sizeof( version ) );
+        std::memcpy( header + 12, &flags, sizeof( flags ) );
+        if( std::fwrite( header, 1, sizeof( header ), file ) != sizeof( header ) ){
+            throw std::runtime_error( "failed can't write point cloud " + path.generic_string() );
+        }
+        offset = sizeof( header );
+
+        index = std::make_unique<CsvWriter>( directory / "cloud_index.csv", "frame_number,timestamp,offset,points", flush_interval );
+    }
+
+    // Create Writer Thread
+    thread = std::thread( &CloudStream::work, this );
+}
+
+// Destructor
+CloudStream::~CloudStream()
+{
+    try{
+        close();
+    }
+    catch( ... ){
+    }
+}
+
+// Write Point Cloud of Depth Frame
+void CloudStream::write( const cv::Mat& depth, const rs2::frame& depth_frame, const cv::Mat& color, const rs2::frame& color_frame )
+{
+    rethrow();
+
+    // Color Properties are Declared for All Frames of Textured Stream
+    if( textured && color.empty() ){
+        throw std::runtime_error( "failed textured point cloud needs color image" );
+    }
+
+    // Keep Source Frames if Images Refer to Frame Buffers (External Data)
+    rs2::frame depth_source;
+    if( !depth.u && depth_frame ){
+        depth_source = depth_frame;
+        depth_source.keep();
+    }
+    rs2::frame color_source;
+    if( !color.empty() && !color.u && color_frame ){
+        color_source = color_frame;
+        color_source.keep();
+    }
+
+    // Block while Queue is Full
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        pending++;
+    }
+    if( !tasks.push( { depth, ( textured ) ? color : cv::Mat(), depth_source, color_source, depth_frame.get_frame_number(), depth_frame.get_timestamp() } ) ){
+        std::lock_guard<std::mutex> lock( mutex );
+        pending--;
+        throw std::runtime_error( "failed point cloud " + directory.generic_string() + " has been closed" );
+    }
+}
+
+// Wait for Pending Point Clouds and Rethrow Writer Error
+void CloudStream::wait()
+{
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        idle.wait( lock, [this]{ return pending == 0; } );
+    }
+
+    if( index ){
+        index->flush();
+    }
+    if( file ){
+        std::fflush( file );
+    }
+
+    rethrow();
+}
+
+// Close (Write Remaining Point Clouds and Rethrow Writer Error)
+void CloudStream::close()
+{
+    tasks.close();
+    if( thread.joinable() ){
+        thread.join();
+    }
+
+    if( file ){
+        const bool error = std::fclose( file ) != 0;
+        file = nullptr;
+        if( error ){
+            throw std::runtime_error( "failed can't write point cloud " + ( directory / "cloud.bin" ).generic_string() );
+        }
+    }
+    if( index ){
+        index->flush();
+    }
+
+    rethrow();
+}
+
+// Retrieve Format from Name (ply, pcd, packed)
+CloudStream::Format CloudStream::getFormat( const std::string& name )
+{
+    if( name == "ply" ){
+        return Format::Ply;
+    }
+    if( name == "pcd" ){
+        return Format::Pcd;
+    }
+    if( name == "packed" ){
+        return Format::Packed;
+    }
+    throw std::runtime_error( "failed unknown point cloud format " + name );
+}
+
+// Writer Thread
+void CloudStream::work()
+{
+    Profiler::instance().setThreadName( "cloud" );
+
+    Task task;
+    while( tasks.pop( task ) ){
+        // Skip Remaining Tasks after Error
+        try{
+            if( !failed ){
+                deproject( task );
+
+                std::ostringstream oss;
+                oss << std::setfill( '0' ) << std::setw( 6 ) << task.frame_number;
+                switch( format ){
+                    case Format::Ply:
+                        writePly( directory / ( oss.str() + ".ply" ) );
+                        break;
+                    case Format::Pcd:
+                        writePcd( directory / ( oss.str() + ".pcd" ) );
+                        break;
+                    case Format::Packed:
+                        writePacked( task );
+                        break;
+                }
+            }
+        }
+        catch( ... ){
+            std::lock_guard<std::mutex> lock( mutex );
+            if( !exception ){
+                exception = std::current_exception();
+            }
+            failed = true;
+        }
+
+        // Release Image Buffers before Waiting Next Task
+        task = Task();
+
+        // Notify Idle
+        std::lock_guard<std::mutex> lock( mutex );
+        if( --pending == 0 ){
+            idle.notify_all();
+        }
+    }
+}
+
+// Deproject Depth to Points
+// Each row is deprojected in a branchless loop (vectorized by the compiler), and then valid points are compacted.
+inline void CloudStream::deproject( const Task& task )
+{
+    TRACE_SCOPE( "cloud/deproject" );
+
+    const cv::Mat& depth = task.depth;
+    CV_Assert( depth.type() == CV_16UC1 && depth.cols == rays.getWidth() && depth.rows == rays.getHeight() );
+
+    points.clear();
+    voxels.clear();
+    row_x.resize( depth.cols );
+    row_y.resize( depth.cols );
+    row_z.resize( depth.cols );
+
+    const float inverse_voxel_size = ( voxel_size > 0.0f ) ? 1.0f / voxel_size : 0.0f;
+    for( int32_t y = 0; y < depth.rows; y += stride ){
+        // Multiply Rays by Depth
+        const uint16_t* depth_row = depth.ptr<uint16_t>( y );
+        const RayTable::Ray* ray_row = rays.row( y );
+        for( int32_t x = 0; x < depth.cols; x++ ){
+            const float z = depth_row[x] * depth_scale;
+            row_x[x] = ray_row[x].x * z;
+            row_y[x] = ray_row[x].y * z;
+            row_z[x] = z;
+        }
+
+        // Compact Valid Points
+        for( int32_t x = 0; x < depth.cols; x += stride ){
+            if( depth_row[x] == 0 ){
+                continue;
+            }
+
+            Point point = { row_x[x], row_y[x], row_z[x], 0, 0, 0, 0 };
+
+            // Voxel Grid (Keep First Point of Each Voxel, 21 bits per Axis)
+            if( voxel_size > 0.0f ){
+                const uint64_t vx = static_cast<uint64_t>( static_cast<int64_t>( std::floor( point.x * inverse_voxel_size ) ) + ( 1 << 20 ) ) & 0x1FFFFF;
+                const uint64_t vy = static_cast<uint64_t>( static_cast<int64_t>( std::floor( point.y * inverse_voxel_size ) ) + ( 1 << 20 ) ) & 0x1FFFFF;
+                const uint64_t vz = static_cast<uint64_t>( static_cast<int64_t>( std::floor( point.z * inverse_voxel_size ) ) + ( 1 << 20 ) ) & 0x1FFFFF;
+                if( !voxels.insert( ( vx << 42 ) | ( vy << 21 ) | vz ).second ){
+                    continue;
+                }
+            }
+
+            // Sample Color Texture (Project Point to Color Pixel)
+            if( !task.color.empty() ){
+                const float depth_point[3] = { point.x, point.y, point.z };
+                float color_point[3];
+                float pixel[2];
+                rs2_transform_point_to_point( color_point, &depth_to_color, depth_point );
+                rs2_project_point_to_pixel( pixel, &color_intrinsics, color_point );
+                const int32_t u = static_cast<int32_t>( pixel[0] + 0.5f );
+                const int32_t v = static_cast<int32_t>( pixel[1] + 0.5f );
+                if( 0 <= u && u < task.color.cols && 0 <= v && v < task.color.rows ){
+                    const uint8_t* color = task.color.ptr<uint8_t>( v ) + u * task.color.channels();
+                    point.b = color[0];
+                    point.g = ( task.color.channels() >= 3 ) ? color[1] : color[0];
+                    point.r = ( task.color.channels() >= 3 ) ? color[2] : color[0];
+                }
+            }
+
+            points.push_back( point );
+        }
+    }
+}
+
+// Write Points to PLY File
+inline void CloudStream::writePly( const filesystem::path& path )
+{
+    std::ostringstream header;
+    header << "ply\n";
+    header << "format binary_little_endian 1.0\n";
+    header << "element vertex " << points.size() << "\n";
+    header << "property float x\nproperty float y\nproperty float z\n";
+    if( textured ){
+        header << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    }
+    header << "end_header\n";
+
+    // Serialize Points (x y z r g b)
+    const std::size_t point_size = ( textured ) ? 15 : 12;
+    buffer.resize( points.size() * point_size );
+    char* data = buffer.data();
+    for( const Point& point : points ){
+        std::memcpy( data, &point.x, 12 );
+        if( textured ){
+            data[12] = static_cast<char>( point.r );
+            data[13] = static_cast<char>( point.g );
+            data[14] = static_cast<char>( point.b );
+        }
+        data += point_size;
+    }
+
+    writeFile( path, header.str() );
+}
+
+// Write Points to PCD File
+// Color is packed rgb (0x00RRGGBB) in a float field as PCL expects.
+inline void CloudStream::writePcd( const filesystem::path& path )
+{
+    std::ostringstream header;
+    header << "# .PCD v0.7 - Point Cloud Data file format\n";
+    header << "VERSION 0.7\n";
+    header << ( ( textured ) ? "FIELDS x y z rgb\nSIZE 4 4 4 4\nTYPE F F F F\nCOUNT 1 1 1 1\n" : "FIELDS x y z\nSIZE 4 4 4\nTYPE F F F\nCOUNT 1 1 1\n" );
+    header << "WIDTH " << points.size() << "\n";
+    header << "HEIGHT 1\n";
+    header << "VIEWPOINT 0 0 0 1 0 0 0\n";
+    header << "POINTS " << points.size() << "\n";
+    header << "DATA binary\n";
+
+    // Serialize Points (x y z rgb)
+    const std::size_t point_size = ( textured ) ? 16 : 12;
+    buffer.resize( points.size() * point_size );
+    char* data = buffer.data();
+    for( const Point& point : points ){
+        std::memcpy( data, &point.x, 12 );
+        if( textured ){
+            const uint32_t rgb = ( static_cast<uint32_t>( point.r ) << 16 ) | ( static_cast<uint32_t>( point.g ) << 8 ) | point.b;
+            std::memcpy( data + 12, &rgb, 4 );
+        }
+        data += point_size;
+    }
+
+    writeFile( path, header.str() );
+}
+
+// Write Header and Serialized Points to File
+inline void CloudStream::writeFile( const filesystem::path& path, const std::string& header )
+{
+    TRACE_SCOPE( "cloud/write" );
+
+    std::FILE* out = std::fopen( path.string().c_str(), "wb" );
+    if( !out ){
+        throw std::runtime_error( "failed can't open point cloud " + path.generic_string() );
+    }
+
+    const bool written = std::fwrite( header.data(), 1, header.size(), out ) == header.size() && std::fwrite( buffer.data(), 1, buffer.size(), out ) == buffer.size();
+    const bool closed = std::fclose( out ) == 0;
+    if( !written || !closed ){
+        throw std::runtime_error( "failed can't write point cloud " + path.generic_string() );
+    }
+
+    countProfile( "bytes/point_cloud", header.size() + buffer.size() );
+}
+
+// Append Points to Packed Stream
+// Points are written as they are in memory (x y z b g r padding), or only x y z without color.
+inline void CloudStream::writePacked( const Task& task )
+{
+    TRACE_SCOPE( "cloud/write" );
+
+    std::size_t size = 0;
+    if( textured ){
+        size = points.size() * sizeof( Point );
+        if( std::fwrite( points.data(), 1, size, file ) != size ){
+            throw std::runtime_error( "failed can't write point cloud " + ( directory / "cloud.bin" ).generic_string() );
+        }
+    }
+    else{
+        buffer.resize( points.size() * 12 );
+        char* data = buffer.data();
+        for( const Point& point : points ){
+            std::memcpy( data, &point.x, 12 );
+            data += 12;
+        }
+        size = buffer.size();
+        if( std::fwrite( buffer.data(), 1, size, file ) != size ){
+            throw std::runtime_error( "failed can't write point cloud " + ( directory / "cloud.bin" ).generic_string() );
+        }
+    }
+
+    index->write( task.frame_number, task.timestamp, offset, points.size() );
+    offset += size;
+    countProfile( "bytes/point_cloud", size );
+}
+
+// Rethrow Writer Error
+inline void CloudStream::rethrow()
+{
+    if( !failed ){
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( mutex );
+    std::rethrow_exception( exception );
+}
@@ -0,0 +1,158 @@
+#ifndef __CLOUD__
+#define __CLOUD__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "filesystem.h"
+#include "queue.h"
+#include "ray.h"
+#include "writer.h"
+
+// Point Cloud Stream Writer
+// Deprojects depth frames to point clouds and writes them on its own thread fed through a bounded queue.
+// Rays of depth pixels are computed once (RayTable), so each point costs a multiply of the ray by depth.
+// Points can be decimated by pixel stride and voxel grid (first point of each voxel), and textured with color.
+//
+// Formats
+//   ply    : binary little endian PLY per frame (<frame number>.ply), float x y z (+ uchar red green blue)
+//   pcd    : binary PCD per frame (<frame number>.pcd), float x y z (+ packed rgb)
+//   packed : all frames in cloud.bin, and cloud_index.csv (frame number, timestamp, offset, points)
+//            cloud.bin has 16 byte header (magic "RSCLOUD\0", version, flags (1 is color)),
+//            and points of each frame (float x y z (+ uchar b g r and one padding byte)) at offset.
+class CloudStream
+{
+public:
+    // Output Format
+    enum class Format
+    {
+        Ply,
+        Pcd,
+        Packed
+    };
+
+private:
+    // Point (Color is Valid if Textured)
+    struct Point
+    {
+        float x;
+        float y;
+        float z;
+        uint8_t b;
+        uint8_t g;
+        uint8_t r;
+        uint8_t padding;
+    };
+
+    // Deprojection Task
+    struct Task
+    {
+        cv::Mat depth;
+        cv::Mat color;
+        rs2::frame depth_frame; // source frames that images refer to
+        rs2::frame color_frame;
+        uint64_t frame_number;
+        double timestamp;
+    };
+
+    filesystem::path directory;
+    Format format;
+
+    // Deprojection (Depth Intrinsics and Depth Scale)
+    RayTable rays;
+    float depth_scale;
+    uint32_t stride;
+    float voxel_size;   // meters, 0 is no voxel grid
+
+    // Texture (Color Intrinsics and Depth to Color Extrinsics)
+    bool textured = false;
+    rs2_intrinsics color_intrinsics;
+    rs2_extrinsics depth_to_color;
+
+    // Packed Stream
+    std::FILE* file = nullptr;
+    uint64_t offset = 0;
+    std::unique_ptr<CsvWriter> index;
+
+    // Point Buffers (Reused across Frames)
+    std::vector<Point> points;
+    std::vector<float> row_x;
+    std::vector<float> row_y;
+    std::vector<float> row_z;
+    std::unordered_set<uint64_t> voxels;
+    std::vector<char> buffer;
+
+    BoundedQueue<Task> tasks;
+    std::thread thread;
+
+    // Pending Tasks and Error Handling
+    std::mutex mutex;
+    std::condition_variable idle;
+    std::size_t pending = 0;
+    std::exception_ptr exception;
+    std::atomic<bool> failed{ false };
+
+public:
+    // Constructor
+    // Compute rays of depth profile, open packed stream, and start the writer thread.
+    // Points are textured if the color profile is specified.
+    CloudStream( const filesystem::path& directory, Format format, const rs2::video_stream_profile& depth_profile, float depth_scale, uint32_t stride, double voxel_size, const rs2::stream_profile& color_profile, std::chrono::steady_clock::duration flush_interval, std::size_t queue_capacity = 8 );
+
+    // Destructor
+    ~CloudStream();
+
+    CloudStream( const CloudStream& ) = delete;
+    CloudStream& operator=( const CloudStream& ) = delete;
+
+    // Write Point Cloud of Depth Frame
+    // The images must not be modified by the caller after they have been passed (share or clone them).
+    // If an image refers to the buffer of its frame, the frame is kept alive until the point cloud has been written.
+    // Textured stream needs color image of every frame, so points are never written without color.
+    void write( const cv::Mat& depth, const rs2::frame& depth_frame, const cv::Mat& color = cv::Mat(), const rs2::frame& color_frame = rs2::frame() );
+
+    // Wait for Pending Point Clouds and Rethrow Writer Error
+    void wait();
+
+    // Close (Write Remaining Point Clouds and Rethrow Writer Error)
+    void close();
+
+    // Retrieve Format from Name (ply, pcd, packed)
+    static Format getFormat( const std::string& name );
+
+private:
+    // Writer Thread
+    void work();
+
+    // Deproject Depth to Points (Decimated and Textured)
+    inline void deproject( const Task& task );
+
+    // Write Points to PLY File
+    inline void writePly( const filesystem::path& path );
+
+    // Write Points to PCD File
+    inline void writePcd( const filesystem::path& path );
+
+    // Write Header and Serialized Points to File
+    inline void writeFile( const filesystem::path& path, const std::string& header );
+
+    // Append Points to Packed Stream
+    inline void writePacked( const Task& task );
+
+    // Rethrow Writer Error
+    inline void rethrow();
+};
+
+#endif // __CLOUD__
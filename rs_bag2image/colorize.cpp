@@ -0,0 +1,163 @@
+#include "colorize.h"
+#include "convert.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <stdexcept>
+
+// Set Range [meters]
+void DepthColorizer::setRange( double near_distance, double far_distance )
+{
+    if( !( near_distance < far_distance ) ){
+        throw std::runtime_error( "failed depth range must be near < far" );
+    }
+
+    dirty = dirty || near_distance != this->near_distance || far_distance != this->far_distance;
+    this->near_distance = near_distance;
+    this->far_distance = far_distance;
+}
+
+// Set Depth Scale [meters per unit]
+void DepthColorizer::setDepthScale( double depth_scale )
+{
+    if( depth_scale <= 0.0 ){
+        return;
+    }
+
+    dirty = dirty || depth_scale != this->depth_scale;
+    this->depth_scale = depth_scale;
+}
+
+// Set Inverse Depth Mapping
+void DepthColorizer::setInverse( bool inverse )
+{
+    dirty = dirty || inverse != this->inverse;
+    this->inverse = inverse;
+}
+
+// Set Colormap (cv::ColormapTypes, -1 is Gray)
+void DepthColorizer::setColormap( int32_t colormap )
+{
+    dirty = dirty || colormap != this->colormap;
+    this->colormap = colormap;
+}
+
+// Colorize Depth (16bit) to Gray (8bit) or BGR (8bit x 3) Image
+void DepthColorizer::colorize( const cv::Mat& depth, cv::Mat& image )
+{
+    CV_Assert( depth.type() == CV_16UC1 );
+
+    if( dirty ){
+        build();
+    }
+
+    // Gather from Lookup Table
+    // SSE/NEON have no gather, and AVX2 gather isn't faster than scalar loads from a table in L2,
+    // so the loop is unrolled to overlap independent loads instead.
+    if( colormap < 0 ){
+        prepareBuffer( image, depth.rows, depth.cols, CV_8UC1 );
+        const uint8_t* table = gray_table.data();
+        for( int32_t y = 0; y < depth.rows; y++ ){
+            const uint16_t* src = depth.ptr<uint16_t>( y );
+            uint8_t* dst = image.ptr<uint8_t>( y );
+            int32_t x = 0;
+            for( ; x <= depth.cols - 4; x += 4 ){
+                const uint8_t v0 = table[src[x + 0]];
+                const uint8_t v1 = table[src[x + 1]];
+                const uint8_t v2 = table[src[x + 2]];
+                const uint8_t v3 = table[src[x + 3]];
+                dst[x + 0] = v0;
+                dst[x + 1] = v1;
+                dst[x + 2] = v2;
+                dst[x + 3] = v3;
+            }
+            for( ; x < depth.cols; x++ ){
+                dst[x] = table[src[x]];
+            }
+        }
+    }
+    else{
+        prepareBuffer( image, depth.rows, depth.cols, CV_8UC3 );
+        const uint8_t* table = color_table.data();
+        for( int32_t y = 0; y < depth.rows; y++ ){
+            const uint16_t* src = depth.ptr<uint16_t>( y );
+            uint8_t* dst = image.ptr<uint8_t>( y );
+            int32_t x = 0;
+            for( ; x <= depth.cols - 2; x += 2 ){
+                const uint8_t* c0 = table + src[x + 0] * 3;
+                const uint8_t* c1 = table + src[x + 1] * 3;
+                dst[x * 3 + 0] = c0[0];
+                dst[x * 3 + 1] = c0[1];
+                dst[x * 3 + 2] = c0[2];
+                dst[x * 3 + 3] = c1[0];
+                dst[x * 3 + 4] = c1[1];
+                dst[x * 3 + 5] = c1[2];
+            }
+            for( ; x < depth.cols; x++ ){
+                const uint8_t* c = table + src[x] * 3;
+                dst[x * 3 + 0] = c[0];
+                dst[x * 3 + 1] = c[1];
+                dst[x * 3 + 2] = c[2];
+            }
+        }
+    }
+}
+
+// Retrieve Colormap from Name (none, jet, turbo, bone, hot, inferno, viridis)
+int32_t DepthColorizer::getColormap( const std::string& name )
+{
+    std::string lower = name;
+    std::transform( lower.begin(), lower.end(), lower.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+
+    const std::map<std::string, int32_t> colormaps = {
+        { "none", -1 }, { "gray", -1 }, { "jet", cv::COLORMAP_JET }, { "turbo", cv::COLORMAP_TURBO },
+        { "bone", cv::COLORMAP_BONE }, { "hot", cv::COLORMAP_HOT }, { "inferno", cv::COLORMAP_INFERNO }, { "viridis", cv::COLORMAP_VIRIDIS }
+    };
+    const std::map<std::string, int32_t>::const_iterator colormap = colormaps.find( lower );
+    if( colormap == colormaps.end() ){
+        throw std::runtime_error( "failed unknown colormap " + name );
+    }
+    return colormap->second;
+}
+
+// Build Lookup Table
+inline void DepthColorizer::build()
+{
+    // Normalized Position in Range [0.0-1.0] (Near is 0.0, Far is 1.0)
+    // Inverse mapping needs positive near distance, it is clamped to one depth unit.
+    const double near_inverse = 1.0 / std::max( near_distance, depth_scale );
+    const double far_inverse = 1.0 / far_distance;
+    const auto position = [&]( uint32_t value ){
+        const double distance = value * depth_scale;
+        const double t = ( inverse ) ? ( near_inverse - 1.0 / std::max( distance, depth_scale ) ) / ( near_inverse - far_inverse ) : ( distance - near_distance ) / ( far_distance - near_distance );
+        return std::min( std::max( t, 0.0 ), 1.0 );
+    };
+
+    // Gray (Near is White, Far is Black)
+    gray_table.resize( 65536 );
+    for( uint32_t value = 0; value < gray_table.size(); value++ ){
+        gray_table[value] = cv::saturate_cast<uint8_t>( 255.0 - 255.0 * position( value ) );
+    }
+
+    // Colormap (Palette of 256 Colors from OpenCV Colormap)
+    if( 0 <= colormap ){
+        cv::Mat gradient( 1, 256, CV_8UC1 );
+        for( int32_t i = 0; i < 256; i++ ){
+            gradient.ptr<uint8_t>( 0 )[i] = static_cast<uint8_t>( i );
+        }
+        cv::Mat palette;
+        cv::applyColorMap( gradient, palette, colormap );
+
+        color_table.resize( 65536 * 3 );
+        for( uint32_t value = 0; value < gray_table.size(); value++ ){
+            const uint8_t* color = palette.ptr<uint8_t>( 0 ) + cvRound( 255.0 * position( value ) ) * 3;
+            std::copy( color, color + 3, color_table.begin() + value * 3 );
+        }
+
+        // Invalid Depth is Black
+        std::fill( color_table.begin(), color_table.begin() + 3, 0 );
+    }
+
+    dirty = false;
+}
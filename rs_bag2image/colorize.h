@@ -0,0 +1,59 @@
+#ifndef __COLORIZE__
+#define __COLORIZE__
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Depth Colorizer
+// Maps 16bit depth to 8bit gray or colormapped BGR image through a 65536 entry lookup table,
+// so each pixel costs one table load regardless of range, inverse mapping or colormap.
+// The table is rebuilt only when a parameter has changed.
+//   Gray     : near is white, far is black. (0-10m with depth scale 0.001 is same as previous linear scaling)
+//   Colormap : near is low end of colormap, far is high end, invalid depth (0) is black.
+class DepthColorizer
+{
+private:
+    // Parameters
+    double near_distance = 0.0;     // meters
+    double far_distance = 10.0;     // meters
+    double depth_scale = 0.001;     // meters per unit
+    bool inverse = false;           // map inverse depth linearly
+    int32_t colormap = -1;          // cv::ColormapTypes, -1 is gray
+
+    // Lookup Table (Gray or BGR)
+    std::vector<uint8_t> gray_table;
+    std::vector<uint8_t> color_table;
+    bool dirty = true;
+
+public:
+    // Constructor
+    DepthColorizer() = default;
+
+    // Set Range [meters]
+    void setRange( double near_distance, double far_distance );
+
+    // Set Depth Scale [meters per unit]
+    void setDepthScale( double depth_scale );
+
+    // Set Inverse Depth Mapping
+    void setInverse( bool inverse );
+
+    // Set Colormap (cv::ColormapTypes, -1 is Gray)
+    void setColormap( int32_t colormap );
+
+    // Colorize Depth (16bit) to Gray (8bit) or BGR (8bit x 3) Image
+    // The destination buffer is reused across frames if nobody else refers to it.
+    void colorize( const cv::Mat& depth, cv::Mat& image );
+
+    // Retrieve Colormap from Name (none, jet, turbo, bone, hot, inferno, viridis)
+    static int32_t getColormap( const std::string& name );
+
+private:
+    // Build Lookup Table
+    inline void build();
+};
+
+#endif // __COLORIZE__
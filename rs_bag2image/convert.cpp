@@ -0,0 +1,272 @@
+#include "convert.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+// RGB8 -> BGR (Swizzle)
+template<>
+struct Converter<rs2_format::RS2_FORMAT_RGB8>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        prepareBuffer( image, height, width, CV_8UC3 );
+        for( int32_t y = 0; y < height; y++ ){
+            const uint8_t* src = static_cast<const uint8_t*>( data ) + static_cast<size_t>( y ) * stride;
+            uint8_t* dst = image.ptr<uint8_t>( y );
+            int32_t x = 0;
+            #if CV_SIMD128
+            for( ; x <= width - cv::v_uint8x16::nlanes; x += cv::v_uint8x16::nlanes ){
+                cv::v_uint8x16 r, g, b;
+                cv::v_load_deinterleave( src + x * 3, r, g, b );
+                cv::v_store_interleave( dst + x * 3, b, g, r );
+            }
+            #endif
+            for( ; x < width; x++ ){
+                dst[x * 3 + 0] = src[x * 3 + 2];
+                dst[x * 3 + 1] = src[x * 3 + 1];
+                dst[x * 3 + 2] = src[x * 3 + 0];
+            }
+        }
+    }
+};
+
+// RGBA8 -> BGRA (Swizzle)
+template<>
+struct Converter<rs2_format::RS2_FORMAT_RGBA8>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        prepareBuffer( image, height, width, CV_8UC4 );
+        for( int32_t y = 0; y < height; y++ ){
+            const uint8_t* src = static_cast<const uint8_t*>( data ) + static_cast<size_t>( y ) * stride;
+            uint8_t* dst = image.ptr<uint8_t>( y );
+            int32_t x = 0;
+            #if CV_SIMD128
+            for( ; x <= width - cv::v_uint8x16::nlanes; x += cv::v_uint8x16::nlanes ){
+                cv::v_uint8x16 r, g, b, a;
+                cv::v_load_deinterleave( src + x * 4, r, g, b, a );
+                cv::v_store_interleave( dst + x * 4, b, g, r, a );
+            }
+            #endif
+            for( ; x < width; x++ ){
+                dst[x * 4 + 0] = src[x * 4 + 2];
+                dst[x * 4 + 1] = src[x * 4 + 1];
+                dst[x * 4 + 2] = src[x * 4 + 0];
+                dst[x * 4 + 3] = src[x * 4 + 3];
+            }
+        }
+    }
+};
+
+// BGR8 (No Conversion)
+template<>
+struct Converter<rs2_format::RS2_FORMAT_BGR8>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        image = cv::Mat( height, width, CV_8UC3, const_cast<void*>( data ), stride );
+    }
+};
+
+// BGRA8 (No Conversion)
+template<>
+struct Converter<rs2_format::RS2_FORMAT_BGRA8>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        image = cv::Mat( height, width, CV_8UC4, const_cast<void*>( data ), stride );
+    }
+};
+
+// Y8 (No Conversion)
+template<>
+struct Converter<rs2_format::RS2_FORMAT_Y8>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        image = cv::Mat( height, width, CV_8UC1, const_cast<void*>( data ), stride );
+    }
+};
+
+// Z16 (No Conversion)
+template<>
+struct Converter<rs2_format::RS2_FORMAT_Z16>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        image = cv::Mat( height, width, CV_16UC1, const_cast<void*>( data ), stride );
+    }
+};
+
+// Y16 -> GRAY 8bit (Scaling 0-65535 -> 0-255)
+// round( v * 255 / 65535 ) = round( v / 257 ) = ( ( v + 128 ) * 65281 ) >> 24 for all 16bit v.
+template<>
+struct Converter<rs2_format::RS2_FORMAT_Y16>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        prepareBuffer( image, height, width, CV_8UC1 );
+        for( int32_t y = 0; y < height; y++ ){
+            const uint16_t* src = reinterpret_cast<const uint16_t*>( static_cast<const uint8_t*>( data ) + static_cast<size_t>( y ) * stride );
+            uint8_t* dst = image.ptr<uint8_t>( y );
+            int32_t x = 0;
+            #if CV_SIMD128
+            const cv::v_uint32x4 bias = cv::v_setall_u32( 128 );
+            const cv::v_uint32x4 multiplier = cv::v_setall_u32( 65281 );
+            for( ; x <= width - cv::v_uint8x16::nlanes; x += cv::v_uint8x16::nlanes ){
+                cv::v_uint32x4 v0, v1, v2, v3;
+                cv::v_expand( cv::v_load( src + x ), v0, v1 );
+                cv::v_expand( cv::v_load( src + x + cv::v_uint16x8::nlanes ), v2, v3 );
+                v0 = ( ( v0 + bias ) * multiplier ) >> 24;
+                v1 = ( ( v1 + bias ) * multiplier ) >> 24;
+                v2 = ( ( v2 + bias ) * multiplier ) >> 24;
+                v3 = ( ( v3 + bias ) * multiplier ) >> 24;
+                cv::v_store( dst + x, cv::v_pack( cv::v_pack( v0, v1 ), cv::v_pack( v2, v3 ) ) );
+            }
+            #endif
+            for( ; x < width; x++ ){
+                dst[x] = static_cast<uint8_t>( ( ( static_cast<uint32_t>( src[x] ) + 128 ) * 65281 ) >> 24 );
+            }
+        }
+    }
+};
+
+// YUYV -> BGR
+// Color conversion is done by OpenCV (vectorized) directly from frame buffer into destination buffer.
+template<>
+struct Converter<rs2_format::RS2_FORMAT_YUYV>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        prepareBuffer( image, height, width, CV_8UC3 );
+        cv::cvtColor( cv::Mat( height, width, CV_8UC2, const_cast<void*>( data ), stride ), image, cv::COLOR_YUV2BGR_YUYV );
+    }
+};
+
+// UYVY -> GRAY 8bit (Unpack Y)
+template<>
+struct Converter<rs2_format::RS2_FORMAT_UYVY>
+{
+    static void convert( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image )
+    {
+        prepareBuffer( image, height, width, CV_8UC1 );
+        for( int32_t y = 0; y < height; y++ ){
+            const uint8_t* src = static_cast<const uint8_t*>( data ) + static_cast<size_t>( y ) * stride;
+            uint8_t* dst = image.ptr<uint8_t>( y );
+            int32_t x = 0;
+            #if CV_SIMD128
+            for( ; x <= width - cv::v_uint8x16::nlanes; x += cv::v_uint8x16::nlanes ){
+                cv::v_uint8x16 uv, luma;
+                cv::v_load_deinterleave( src + x * 2, uv, luma );
+                cv::v_store( dst + x, luma );
+            }
+            #endif
+            for( ; x < width; x++ ){
+                dst[x] = src[x * 2 + 1];
+            }
+        }
+    }
+};
+
+// Retrieve Convert Kernel
+ConvertKernel getConvertKernel( rs2_format format )
+{
+    // Convert Kernel Table (Indexed by Format)
+    static const std::array<ConvertKernel, rs2_format::RS2_FORMAT_COUNT> kernels = [](){
+        std::array<ConvertKernel, rs2_format::RS2_FORMAT_COUNT> table = {};
+        table[rs2_format::RS2_FORMAT_RGB8]  = &Converter<rs2_format::RS2_FORMAT_RGB8>::convert;
+        table[rs2_format::RS2_FORMAT_RGBA8] = &Converter<rs2_format::RS2_FORMAT_RGBA8>::convert;
+        table[rs2_format::RS2_FORMAT_BGR8]  = &Converter<rs2_format::RS2_FORMAT_BGR8>::convert;
+        table[rs2_format::RS2_FORMAT_BGRA8] = &Converter<rs2_format::RS2_FORMAT_BGRA8>::convert;
+        table[rs2_format::RS2_FORMAT_Y8]    = &Converter<rs2_format::RS2_FORMAT_Y8>::convert;
+        table[rs2_format::RS2_FORMAT_Y16]   = &Converter<rs2_format::RS2_FORMAT_Y16>::convert;
+        table[rs2_format::RS2_FORMAT_Z16]   = &Converter<rs2_format::RS2_FORMAT_Z16>::convert;
+        table[rs2_format::RS2_FORMAT_YUYV]  = &Converter<rs2_format::RS2_FORMAT_YUYV>::convert;
+        table[rs2_format::RS2_FORMAT_UYVY]  = &Converter<rs2_format::RS2_FORMAT_UYVY>::convert;
+        return table;
+    }();
+
+    if( format < 0 || rs2_format::RS2_FORMAT_COUNT <= format ){
+        return nullptr;
+    }
+
+    return kernels[format];
+}
+
+// Convert Frame with Transform
+void convertFrame( ConvertKernel convert, const void* data, int32_t width, int32_t height, int32_t stride, int32_t bytes_per_pixel, const FrameTransform& transform, bool pooling, cv::Mat& image )
+{
+    if( transform.isIdentity() ){
+        convert( data, width, height, stride, image );
+        return;
+    }
+
+    // Clip Region of Interest to Frame (Even X and Width for Packed YUV)
+    cv::Rect roi = ( transform.roi.empty() ) ? cv::Rect( 0, 0, width, height ) : transform.roi & cv::Rect( 0, 0, width, height );
+    roi.x &= ~1;
+    roi.width &= ~1;
+    if( roi.empty() ){
+        throw std::runtime_error( "failed crop is out of frame" );
+    }
+    const uint8_t* source = static_cast<const uint8_t*>( data ) + static_cast<size_t>( roi.y ) * stride + static_cast<size_t>( roi.x ) * bytes_per_pixel;
+
+    // Crop (Convert Region of Frame Buffer)
+    if( transform.scale == 1.0 ){
+        convert( source, roi.width, roi.height, stride, image );
+        return;
+    }
+
+    // Scale (Each Output Row is Band of Source Rows [y0, y1) that Covers It)
+    const int32_t output_width = std::max( 1, cvRound( roi.width * transform.scale ) );
+    const int32_t output_height = std::max( 1, cvRound( roi.height * transform.scale ) );
+
+    // Min-Pooling of Depth
+    // Minimum of v - 1 in 16bit wraps invalid 0 to 65535, so that min + 1 is the nearest valid depth or 0.
+    if( pooling ){
+        std::vector<int32_t> columns( output_width + 1 );
+        for( int32_t x = 0; x <= output_width; x++ ){
+            columns[x] = static_cast<int32_t>( static_cast<int64_t>( x ) * roi.width / output_width );
+        }
+
+        prepareBuffer( image, output_height, output_width, CV_16UC1 );
+        for( int32_t y = 0; y < output_height; y++ ){
+            const int32_t y0 = static_cast<int32_t>( static_cast<int64_t>( y ) * roi.height / output_height );
+            const int32_t y1 = static_cast<int32_t>( static_cast<int64_t>( y + 1 ) * roi.height / output_height );
+            uint16_t* dst = image.ptr<uint16_t>( y );
+            std::fill( dst, dst + output_width, static_cast<uint16_t>( 0xFFFF ) );
+            for( int32_t row = y0; row < y1; row++ ){
+                const uint16_t* src = reinterpret_cast<const uint16_t*>( source + static_cast<size_t>( row ) * stride );
+                for( int32_t x = 0; x < output_width; x++ ){
+                    uint16_t value = dst[x];
+                    for( int32_t column = columns[x]; column < columns[x + 1]; column++ ){
+                        value = std::min( value, static_cast<uint16_t>( src[column] - 1 ) );
+                    }
+                    dst[x] = value;
+                }
+            }
+            for( int32_t x = 0; x < output_width; x++ ){
+                dst[x] = static_cast<uint16_t>( dst[x] + 1 );
+            }
+        }
+        return;
+    }
+
+    // Area Averaging of Color and Infrared
+    // The band is converted into a scratch buffer that stays in cache, and resized into the output row.
+    thread_local cv::Mat band;
+    for( int32_t y = 0; y < output_height; y++ ){
+        const int32_t y0 = static_cast<int32_t>( static_cast<int64_t>( y ) * roi.height / output_height );
+        const int32_t y1 = static_cast<int32_t>( static_cast<int64_t>( y + 1 ) * roi.height / output_height );
+        convert( source + static_cast<size_t>( y0 ) * stride, roi.width, y1 - y0, stride, band );
+        if( y == 0 ){
+            prepareBuffer( image, output_height, output_width, band.type() );
+        }
+
+        cv::Mat row = image.row( y );
+        cv::resize( band, row, row.size(), 0.0, 0.0, cv::INTER_AREA );
+    }
+}
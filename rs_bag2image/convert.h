@@ -0,0 +1,90 @@
+#ifndef __CONVERT__
+#define __CONVERT__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Convert Kernel
+// Convert frame buffer (data, width, height, stride in bytes) to OpenCV image (BGR/BGRA/GRAY 8bit, or 16bit depth).
+// The image either refers to the frame buffer directly when no conversion is needed,
+// or is written in a single pass into a buffer that is reused across frames.
+using ConvertKernel = void (*)( const void* data, int32_t width, int32_t height, int32_t stride, cv::Mat& image );
+
+// Converter (Specialized for Each Format)
+template<rs2_format Format>
+struct Converter;
+
+// Frame Transform
+// Region of interest and scale of image that are applied while converting frame.
+struct FrameTransform
+{
+    cv::Rect roi;           // region of frame in pixels, empty is whole frame
+    double scale = 1.0;     // (0.0-1.0]
+
+    // Check Transform Changes Nothing
+    bool isIdentity() const
+    {
+        return roi.empty() && scale == 1.0;
+    }
+};
+
+// Retrieve Convert Kernel
+// Return nullptr if the format is not supported.
+ConvertKernel getConvertKernel( rs2_format format );
+
+// Convert Frame with Transform
+// The region of interest is cropped by offsetting the frame buffer (x and width are rounded to even for packed yuv),
+// and the scaled image is produced in the same pass by converting a band of source rows for each output row.
+// Color and infrared are area averaged, and 16bit depth is min-pooled over valid (non-zero) pixels if pooling,
+// so that depth values are never interpolated between surfaces.
+void convertFrame( ConvertKernel convert, const void* data, int32_t width, int32_t height, int32_t stride, int32_t bytes_per_pixel, const FrameTransform& transform, bool pooling, cv::Mat& image );
+
+// Prepare Destination Buffer
+// Reuse the buffer if nobody else refers to it, otherwise allocate new one.
+// The buffer that refers to frame buffer (external data) is never written.
+inline void prepareBuffer( cv::Mat& image, int32_t rows, int32_t cols, int32_t type )
+{
+    if( !image.u || image.u->refcount > 1 ){
+        image.release();
+    }
+    image.create( rows, cols, type );
+}
+
+// Buffer Ring
+// Destination buffers of a stream that are used in turn for each frame.
+// The encoder still refers to images of previous frames while they are queued, so a single buffer would be reallocated
+// on every frame. With as many buffers as images held by the encoder, the buffer has been released by the time it comes round.
+class BufferRing
+{
+private:
+    std::vector<cv::Mat> buffers;
+    std::size_t index = 0;
+
+public:
+    // Constructor
+    explicit BufferRing( std::size_t size = 1 )
+        : buffers( std::max<std::size_t>( size, 1 ) )
+    {
+    }
+
+    // Resize Ring (Buffers are Released)
+    void resize( std::size_t size )
+    {
+        buffers.assign( std::max<std::size_t>( size, 1 ), cv::Mat() );
+        index = 0;
+    }
+
+    // Retrieve Next Buffer
+    cv::Mat& next()
+    {
+        cv::Mat& buffer = buffers[index];
+        index = ( index + 1 ) % buffers.size();
+        return buffer;
+    }
+};
+
+#endif // __CONVERT__
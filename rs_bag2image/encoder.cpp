@@ -0,0 +1,224 @@
+#include "encoder.h"
+#include "filesystem.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Constructor
+Encoder::Encoder( uint32_t num_threads, std::size_t max_inflight_bytes )
+    : tasks( static_cast<std::size_t>( num_threads ) * 2 ), default_group( std::make_shared<Group>() )
+{
+    // Create Write-Behind File Sink (Writes are Latency Bound, so Fallback Pool has at least 4 Threads)
+    if( max_inflight_bytes > 0 ){
+        sink = std::make_unique<FileSink>( std::max<uint32_t>( num_threads, 4 ), max_inflight_bytes );
+    }
+
+    // Create Worker Threads
+    for( uint32_t i = 0; i < num_threads; i++ ){
+        workers.emplace_back( &Encoder::work, this );
+    }
+}
+
+// Destructor
+Encoder::~Encoder()
+{
+    // Stop Worker Threads (Drain Remaining Tasks)
+    tasks.close();
+    for( std::thread& worker : workers ){
+        if( worker.joinable() ){
+            worker.join();
+        }
+    }
+
+    // Stop File Sink (Write Remaining Files)
+    sink.reset();
+}
+
+// Write Image
+void Encoder::write( const std::string& path, const cv::Mat& image, const std::vector<int32_t>& params, const rs2::frame& frame, const std::shared_ptr<Group>& group, const Process& process )
+{
+    // Serial (Rethrow Error Immediately unless Written Behind)
+    if( workers.empty() ){
+        const std::shared_ptr<Group> task_group = ( group ) ? group : default_group;
+        rethrow( task_group );
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            task_group->pending++;
+        }
+        try{
+            encode( { path, image, params, rs2::frame(), task_group, process } );
+        }
+        catch( ... ){
+            complete( task_group, std::current_exception() );
+        }
+        rethrow( task_group );
+        return;
+    }
+
+    // Keep Source Frame if Image Refers to Frame Buffer (External Data)
+    // keep() detaches the frame from the frame pool, so holding it doesn't starve the playback.
+    rs2::frame source;
+    if( !image.u && frame ){
+        source = frame;
+        source.keep();
+    }
+
+    // Pipelined (Block while Queue is Full)
+    const std::shared_ptr<Group> task_group = ( group ) ? group : default_group;
+    rethrow( task_group );
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        task_group->pending++;
+    }
+    if( !tasks.push( { path, image, params, source, task_group, process } ) ){
+        std::lock_guard<std::mutex> lock( mutex );
+        task_group->pending--;
+        throw std::runtime_error( "failed encoder has been stopped" );
+    }
+}
+
+// Wait for Pending Tasks of Group and Rethrow Worker Error of Group
+void Encoder::wait( const std::shared_ptr<Group>& group )
+{
+    const std::shared_ptr<Group> task_group = ( group ) ? group : default_group;
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        idle.wait( lock, [&task_group]{ return task_group->pending == 0; } );
+    }
+
+    rethrow( task_group );
+}
+
+// Stop Workers after All Tasks and Rethrow Worker Error of Default Group
+void Encoder::join()
+{
+    tasks.close();
+    for( std::thread& worker : workers ){
+        if( worker.joinable() ){
+            worker.join();
+        }
+    }
+    if( sink ){
+        sink->flush();
+    }
+
+    rethrow( default_group );
+}
+
+// Retrieve Number of Images that Encoder Holds at Most (Queued and Being Encoded)
+std::size_t Encoder::getDepth() const
+{
+    return workers.empty() ? 0 : tasks.getCapacity() + workers.size();
+}
+
+// Worker Thread
+void Encoder::work()
+{
+    Profiler::instance().setThreadName( "encoder" );
+
+    Task task;
+    while( tasks.pop( task ) ){
+        // Skip Remaining Tasks of Group after Error
+        const std::shared_ptr<Group> group = task.group;
+        try{
+            if( !group->failed ){
+                encode( task );
+            }
+            else{
+                complete( group, nullptr );
+            }
+        }
+        catch( ... ){
+            complete( group, std::current_exception() );
+        }
+
+        // Release Image Buffer before Waiting Next Task
+        task = Task();
+    }
+}
+
+// Complete Task of Group (Record Error and Notify Idle)
+inline void Encoder::complete( const std::shared_ptr<Group>& group, std::exception_ptr exception )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    if( exception ){
+        if( !group->exception ){
+            group->exception = exception;
+        }
+        group->failed = true;
+    }
+    if( --group->pending == 0 ){
+        idle.notify_all();
+    }
+}
+
+// Encode and Write Image
+// The task is completed here, or by the file sink after the file has been written.
+// If this throws, the task has not been completed.
+void Encoder::encode( const Task& task )
+{
+    // Process Image (e.g. Alignment)
+    const cv::Mat image = ( task.process ) ? task.process( task.image ) : task.image;
+
+    // Encode to Memory and Append to Archive (Buffer is Reused by Each Worker)
+    if( task.group->archive ){
+        thread_local std::vector<unsigned char> buffer;
+        {
+            TRACE_SCOPE( "imencode" );
+            if( !cv::imencode( filesystem::path( task.path ).extension().string(), image, buffer, task.params ) ){
+                throw std::runtime_error( "failed can't encode image " + task.path );
+            }
+        }
+        countProfile( "bytes/images", buffer.size() );
+
+        task.group->archive->append( task.path, buffer.data(), buffer.size() );
+        complete( task.group, nullptr );
+        return;
+    }
+
+    // Encode to Memory and Write Behind
+    if( sink ){
+        FileSink::Buffer buffer = sink->acquire();
+        {
+            TRACE_SCOPE( "imencode" );
+            if( !cv::imencode( filesystem::path( task.path ).extension().string(), image, buffer, task.params ) ){
+                throw std::runtime_error( "failed can't encode image " + task.path );
+            }
+        }
+        countProfile( "bytes/images", buffer.size() );
+
+        const std::shared_ptr<Group> group = task.group;
+        sink->write( task.path, std::move( buffer ), [this, group]( std::exception_ptr exception ){
+            complete( group, exception );
+        } );
+        return;
+    }
+
+    {
+        TRACE_SCOPE( "imwrite" );
+        if( !cv::imwrite( task.path, image, task.params ) ){
+            throw std::runtime_error( "failed can't write image " + task.path );
+        }
+    }
+
+    // Count Bytes Written (Only if Profiling, Costs a File System Call)
+    if( Profiler::instance().isEnabled() ){
+        std::error_code error;
+        const uint64_t size = filesystem::file_size( task.path, error );
+        countProfile( "bytes/images", error ? 0 : size );
+    }
+
+    complete( task.group, nullptr );
+}
+
+// Rethrow Worker Error of Group
+inline void Encoder::rethrow( const std::shared_ptr<Group>& group )
+{
+    if( !group->failed ){
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( mutex );
+    std::rethrow_exception( group->exception );
+}
@@ -0,0 +1,117 @@
+#ifndef __ENCODER__
+#define __ENCODER__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "archive.h"
+#include "queue.h"
+#include "sink.h"
+
+// Image Encoder
+// Encodes and writes images on a pool of worker threads fed through a bounded queue.
+// With zero threads every image is written synchronously on the calling thread.
+// write() can be called from multiple threads, so one encoder can be shared by several extractions.
+// Each extraction passes its own task group, so an error fails only the extraction that caused it.
+// With write-behind, images are encoded to memory and written by a file sink (io_uring or thread pool),
+// and a task is pending until its file has been closed.
+// If the task group has an archive, images are encoded to memory and appended to the archive instead of files.
+class Encoder
+{
+public:
+    // Image Process
+    // Runs on the worker thread before encoding, and returns the image to write (e.g. alignment).
+    using Process = std::function<cv::Mat( const cv::Mat& image )>;
+
+    // Task Group
+    // Pending tasks and first error of one extraction, and archive that images of extraction are appended to.
+    class Group
+    {
+    public:
+        // Constructor
+        Group() = default;
+
+        // Constructor (Append Images to Archive)
+        explicit Group( const std::shared_ptr<Archive>& archive ) : archive( archive ){}
+
+    private:
+        friend class Encoder;
+        std::shared_ptr<Archive> archive;
+        std::size_t pending = 0;
+        std::exception_ptr exception;
+        std::atomic<bool> failed{ false };
+    };
+
+private:
+    // Encode Task
+    struct Task
+    {
+        std::string path;
+        cv::Mat image;
+        std::vector<int32_t> params;
+        rs2::frame frame; // source frame that image refers to
+        std::shared_ptr<Group> group;
+        Process process;
+    };
+
+    BoundedQueue<Task> tasks;
+    std::vector<std::thread> workers;
+
+    // Write-Behind File Sink (nullptr is cv::imwrite on Encoder Thread)
+    std::unique_ptr<FileSink> sink;
+
+    // Default Task Group (Used if Group is not Specified)
+    std::shared_ptr<Group> default_group;
+    std::condition_variable idle;
+    std::mutex mutex;
+
+public:
+    // Constructor
+    // Enable write-behind with the cap of in-flight bytes, if it is not zero.
+    explicit Encoder( uint32_t num_threads, std::size_t max_inflight_bytes = 0 );
+
+    // Destructor
+    ~Encoder();
+
+    // Write Image
+    // The image must not be modified by the caller after it has been passed (share or clone it).
+    // If the image refers to the buffer of frame, the frame is kept alive until the image has been written.
+    // If the process is specified, the image is processed on the worker thread and the result is written.
+    void write( const std::string& path, const cv::Mat& image, const std::vector<int32_t>& params = std::vector<int32_t>(), const rs2::frame& frame = rs2::frame(), const std::shared_ptr<Group>& group = nullptr, const Process& process = nullptr );
+
+    // Wait for Pending Tasks of Group and Rethrow Worker Error of Group
+    // The encoder can be used after wait (e.g. shared by other extractions).
+    void wait( const std::shared_ptr<Group>& group = nullptr );
+
+    // Stop Workers after All Tasks and Rethrow Worker Error of Default Group
+    void join();
+
+    // Retrieve Number of Images that Encoder Holds at Most (Queued and Being Encoded)
+    // Return 0 if images are written synchronously.
+    std::size_t getDepth() const;
+
+private:
+    // Worker Thread
+    void work();
+
+    // Encode and Write Image (Complete Task when Written)
+    void encode( const Task& task );
+
+    // Complete Task of Group (Record Error and Notify Idle)
+    inline void complete( const std::shared_ptr<Group>& group, std::exception_ptr exception );
+
+    // Rethrow Worker Error of Group
+    inline void rethrow( const std::shared_ptr<Group>& group );
+};
+
+#endif // __ENCODER__
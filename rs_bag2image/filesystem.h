@@ -0,0 +1,16 @@
+#ifndef __FILESYSTEM__
+#define __FILESYSTEM__
+
+#if __has_include(<filesystem>)
+#include <filesystem>
+namespace filesystem = std::filesystem;
+#else
+#include <experimental/filesystem>
+#if _WIN32
+namespace filesystem = std::experimental::filesystem::v1;
+#else
+namespace filesystem = std::experimental::filesystem;
+#endif
+#endif
+
+#endif // __FILESYSTEM__
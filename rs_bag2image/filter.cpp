@@ -0,0 +1,205 @@
+#include "filter.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+// Constructor
+DepthFilter::DepthFilter( const std::string& chain, std::size_t queue_capacity )
+    : input( queue_capacity ), output( queue_capacity + 2 )
+{
+    // Options of Filters (Name, librealsense Option)
+    const std::map<std::string, rs2_option> options = {
+        { "magnitude", rs2_option::RS2_OPTION_FILTER_MAGNITUDE },
+        { "alpha", rs2_option::RS2_OPTION_FILTER_SMOOTH_ALPHA },
+        { "delta", rs2_option::RS2_OPTION_FILTER_SMOOTH_DELTA },
+        { "holes", rs2_option::RS2_OPTION_HOLES_FILL },
+        { "persistence", rs2_option::RS2_OPTION_HOLES_FILL },
+        { "mode", rs2_option::RS2_OPTION_HOLES_FILL },
+        { "min", rs2_option::RS2_OPTION_MIN_DISTANCE },
+        { "max", rs2_option::RS2_OPTION_MAX_DISTANCE }
+    };
+
+    // Create Filters of Chain
+    bool disparity = false;
+    std::istringstream iss( chain );
+    std::string item;
+    while( std::getline( iss, item, ',' ) ){
+        std::transform( item.begin(), item.end(), item.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+        std::istringstream tokens( item );
+        std::string name;
+        std::getline( tokens, name, ':' );
+
+        Filter filter;
+        if( name == "decimation" ){
+            filter = { "filter/decimation", std::make_shared<rs2::decimation_filter>() };
+        }
+        else if( name == "threshold" ){
+            filter = { "filter/threshold", std::make_shared<rs2::threshold_filter>() };
+        }
+        else if( name == "disparity" && !disparity ){
+            filter = { "filter/disparity", std::make_shared<rs2::disparity_transform>( true ) };
+            disparity = true;
+        }
+        else if( name == "spatial" ){
+            filter = { "filter/spatial", std::make_shared<rs2::spatial_filter>() };
+        }
+        else if( name == "temporal" ){
+            filter = { "filter/temporal", std::make_shared<rs2::temporal_filter>() };
+        }
+        else if( name == "depth" && disparity ){
+            filter = { "filter/depth", std::make_shared<rs2::disparity_transform>( false ) };
+            disparity = false;
+        }
+        else if( name == "hole_filling" ){
+            filter = { "filter/hole_filling", std::make_shared<rs2::hole_filling_filter>() };
+        }
+        else{
+            throw std::runtime_error( "failed unknown depth filter " + item );
+        }
+
+        // Set Options of Filter
+        std::string option;
+        while( std::getline( tokens, option, ':' ) ){
+            const std::size_t equal = option.find( '=' );
+            const std::map<std::string, rs2_option>::const_iterator key = options.find( option.substr( 0, equal ) );
+            if( equal == std::string::npos || key == options.end() || !filter.filter->supports( key->second ) ){
+                throw std::runtime_error( "failed unknown option of depth filter " + item );
+            }
+            filter.filter->set_option( key->second, static_cast<float>( std::atof( option.substr( equal + 1 ).c_str() ) ) );
+        }
+
+        filters.push_back( filter );
+        description += ( description.empty() ? "" : "," ) + item;
+    }
+
+    // Return to Depth (Filtered Depth is Written as 16bit Depth)
+    if( disparity ){
+        filters.push_back( { "filter/depth", std::make_shared<rs2::disparity_transform>( false ) } );
+        description += ",depth";
+    }
+
+    if( filters.empty() ){
+        throw std::runtime_error( "failed depth filter chain is empty" );
+    }
+
+    thread = std::thread( &DepthFilter::work, this );
+}
+
+// Destructor
+DepthFilter::~DepthFilter()
+{
+    // Stop Filter Thread (Discard Remaining Framesets)
+    input.close();
+    output.close();
+    if( thread.joinable() ){
+        thread.join();
+    }
+}
+
+// Push Frameset
+// keep() detaches frames from the frame pool, so framesets read ahead don't starve the playback.
+void DepthFilter::push( rs2::frameset frameset )
+{
+    rethrow();
+
+    frameset.keep();
+    if( !input.push( std::move( frameset ) ) ){
+        rethrow();
+        throw std::runtime_error( "failed depth filter has been stopped" );
+    }
+}
+
+// Pop Filtered Frameset if Ready
+bool DepthFilter::tryPop( Result& result )
+{
+    if( output.tryPop( result ) ){
+        return true;
+    }
+
+    rethrow();
+    return false;
+}
+
+// Pop Filtered Frameset
+bool DepthFilter::pop( Result& result )
+{
+    if( output.pop( result ) ){
+        return true;
+    }
+
+    rethrow();
+    return false;
+}
+
+// Close (No More Framesets)
+void DepthFilter::close()
+{
+    input.close();
+}
+
+// Retrieve Normalized Chain
+const std::string& DepthFilter::getDescription() const
+{
+    return description;
+}
+
+// Filter Thread
+void DepthFilter::work()
+{
+    Profiler::instance().setThreadName( "filter" );
+
+    rs2::frameset frameset;
+    while( input.pop( frameset ) ){
+        try{
+            const rs2::frame depth = frameset.get_depth_frame();
+            Result result = { frameset, ( depth ) ? process( depth ) : rs2::frame() };
+            if( !output.push( std::move( result ) ) ){
+                break;
+            }
+        }
+        catch( ... ){
+            std::lock_guard<std::mutex> lock( mutex );
+            exception = std::current_exception();
+            break;
+        }
+        frameset = rs2::frameset();
+    }
+
+    // Wake up Consumer (Remaining Results are Still Delivered)
+    input.close();
+    output.close();
+}
+
+// Apply Filters to Depth Frame
+inline rs2::frame DepthFilter::process( const rs2::frame& depth )
+{
+    // Repeated Frame (Filter Each Frame Once)
+    if( depth.get_frame_number() == last_frame_number && depth.get_timestamp() == last_timestamp ){
+        return last_filtered;
+    }
+
+    rs2::frame frame = depth;
+    for( const Filter& filter : filters ){
+        TRACE_SCOPE( filter.name );
+        frame = filter.filter->process( frame );
+    }
+
+    last_frame_number = depth.get_frame_number();
+    last_timestamp = depth.get_timestamp();
+    last_filtered = frame;
+    return frame;
+}
+
+// Rethrow Filter Error
+inline void DepthFilter::rethrow()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    if( exception ){
+        std::rethrow_exception( exception );
+    }
+}
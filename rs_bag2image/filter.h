@@ -0,0 +1,102 @@
+#ifndef __FILTER__
+#define __FILTER__
+
+#include <librealsense2/rs.hpp>
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "queue.h"
+
+// Depth Filter Stage
+// Applies a chain of librealsense post-processing filters to depth of each frameset on its own thread,
+// so filtering overlaps with playback (framesets are read ahead) and with encoding.
+// Framesets are returned in order with their filtered depth, so depth stays paired with color of same frameset.
+// A depth frame that is repeated by the syncer is not filtered again (temporal filter sees each frame once).
+//
+// Chain ("filter[:key=value...],...", applied in order)
+//   decimation   : magnitude=[2-8]
+//   threshold    : min=meters, max=meters
+//   disparity    : depth to disparity (spatial and temporal filters work best in disparity)
+//   spatial      : magnitude=[1-5], alpha=[0.25-1], delta=[1-50], holes=[0-5]
+//   temporal     : alpha=[0-1], delta=[1-100], persistence=[0-8]
+//   depth        : disparity to depth (appended if chain ends in disparity)
+//   hole_filling : mode=[0-2] (0 is fill from left, 1 is farest from around, 2 is nearest from around)
+class DepthFilter
+{
+public:
+    // Filtered Frameset (Depth is Filtered Depth Frame of Frameset, or Empty)
+    struct Result
+    {
+        rs2::frameset frameset;
+        rs2::frame depth;
+    };
+
+private:
+    // Filter of Chain (Name is Stage of Profiler)
+    struct Filter
+    {
+        const char* name;
+        std::shared_ptr<rs2::filter> filter;
+    };
+
+    std::vector<Filter> filters;
+    std::string description;
+
+    BoundedQueue<rs2::frameset> input;
+    BoundedQueue<Result> output;
+    std::thread thread;
+
+    // Last Depth Frame (Repeated Frame Reuses Filtered Frame)
+    unsigned long long last_frame_number = 0;
+    double last_timestamp = -1.0;
+    rs2::frame last_filtered;
+
+    // Error Handling
+    std::mutex mutex;
+    std::exception_ptr exception;
+
+public:
+    // Constructor
+    // Create filters of chain and start the filter thread.
+    // At most queue_capacity framesets are read ahead and kept out of the frame pool of playback.
+    DepthFilter( const std::string& chain, std::size_t queue_capacity = 4 );
+
+    // Destructor
+    ~DepthFilter();
+
+    DepthFilter( const DepthFilter& ) = delete;
+    DepthFilter& operator=( const DepthFilter& ) = delete;
+
+    // Push Frameset (Block while Queue is Full)
+    void push( rs2::frameset frameset );
+
+    // Pop Filtered Frameset if Ready (Never Block, Rethrow Filter Error)
+    bool tryPop( Result& result );
+
+    // Pop Filtered Frameset (Block until Ready, Rethrow Filter Error)
+    // Return false if closed and all framesets have been returned.
+    bool pop( Result& result );
+
+    // Close (No More Framesets)
+    void close();
+
+    // Retrieve Normalized Chain (e.g. decimation:magnitude=2,spatial,temporal)
+    const std::string& getDescription() const;
+
+private:
+    // Filter Thread
+    void work();
+
+    // Apply Filters to Depth Frame
+    inline rs2::frame process( const rs2::frame& depth );
+
+    // Rethrow Filter Error
+    inline void rethrow();
+};
+
+#endif // __FILTER__
@@ -0,0 +1,245 @@
+#include "imu.h"
+#include "trace.h"
+
+#include <algorithm>
+
+// Constructor
+ImuReader::ImuReader( const filesystem::path& bag_file, const filesystem::path& directory, std::chrono::steady_clock::duration flush_interval, const std::vector<rs2_stream>& motion_streams )
+    : playback( context.load_device( bag_file.string() ) )
+{
+    // Set Non Real Time Playback
+    playback.set_real_time( false );
+
+    // Retrieve Motion Sensors and Streams that contain in File
+    for( const rs2::sensor& sensor : playback.query_sensors() ){
+        std::vector<rs2::stream_profile> motion_profiles;
+        for( const rs2::stream_profile& stream_profile : sensor.get_stream_profiles() ){
+            const rs2_stream stream_type = stream_profile.stream_type();
+            if( stream_type != rs2_stream::RS2_STREAM_GYRO && stream_type != rs2_stream::RS2_STREAM_ACCEL ){
+                continue;
+            }
+
+            if( std::find( motion_streams.begin(), motion_streams.end(), stream_type ) == motion_streams.end() ){
+                continue;
+            }
+
+            // Create Ring and CSV Writer
+            Stream& stream = streams[( stream_type == rs2_stream::RS2_STREAM_GYRO ) ? 0 : 1];
+            if( !stream.ring ){
+                stream.ring = std::make_unique<SpscRing<Sample>>( 1 << 16 );
+                if( !directory.empty() ){
+                    filesystem::create_directories( directory );
+                    const filesystem::path file = directory / ( ( stream_type == rs2_stream::RS2_STREAM_GYRO ) ? "gyro_data.csv" : "accel_data.csv" );
+                    stream.writer = std::make_unique<CsvWriter>( file, "frame_number,timestamp,x,y,z", flush_interval );
+                }
+            }
+
+            motion_profiles.push_back( stream_profile );
+        }
+
+        if( motion_profiles.empty() ){
+            continue;
+        }
+
+        sensor.open( motion_profiles );
+        sensors.push_back( sensor );
+    }
+
+    // Watch End of Playback
+    playback.set_status_changed_callback( [this]( rs2_playback_status status ){
+        if( status != rs2_playback_status::RS2_PLAYBACK_STATUS_STOPPED || !started ){
+            return;
+        }
+
+        finish();
+    } );
+}
+
+// Destructor
+ImuReader::~ImuReader()
+{
+    // Cancel Callbacks that are Waiting for Ring Space
+    cancelled = true;
+    stop();
+
+    stopped = true;
+    if( thread.joinable() ){
+        thread.join();
+    }
+
+    for( const rs2::sensor& sensor : sensors ){
+        sensor.close();
+    }
+}
+
+// Start Playback
+void ImuReader::start( uint64_t start_position, uint64_t end_position )
+{
+    if( empty() ){
+        return;
+    }
+
+    // Seek to Start Position
+    this->end_position = end_position;
+    if( start_position != 0 ){
+        playback.seek( std::chrono::nanoseconds( start_position ) );
+    }
+
+    // Start Writer Thread
+    thread = std::thread( &ImuReader::work, this );
+
+    // Start Sensors
+    started = true;
+    for( const rs2::sensor& sensor : sensors ){
+        sensor.start( [this]( rs2::frame frame ){
+            enqueue( frame );
+        } );
+    }
+}
+
+// Wait for End of Playback and Flush All Samples
+void ImuReader::join()
+{
+    if( !thread.joinable() ){
+        return;
+    }
+
+    // Wait for End of Playback
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        condition.wait( lock, [this]{ return finished; } );
+    }
+
+    // Stop Sensors (Wait for Pending Callbacks)
+    stop();
+
+    // Stop Writer Thread after Draining Remaining Samples
+    stopped = true;
+    thread.join();
+
+    if( exception ){
+        std::rethrow_exception( exception );
+    }
+
+    // Flush CSV Files
+    for( Stream& stream : streams ){
+        if( stream.writer ){
+            stream.writer->flush();
+        }
+    }
+}
+
+// Check Motion Streams
+bool ImuReader::empty() const
+{
+    return sensors.empty();
+}
+
+// Retrieve Number of Samples of Motion Stream
+uint64_t ImuReader::getSamples( rs2_stream stream_type ) const
+{
+    return streams[( stream_type == rs2_stream::RS2_STREAM_GYRO ) ? 0 : 1].samples;
+}
+
+// Frame Callback (Playback Thread)
+void ImuReader::enqueue( const rs2::frame& frame )
+{
+    const rs2_stream stream_type = frame.get_profile().stream_type();
+    if( stream_type != rs2_stream::RS2_STREAM_GYRO && stream_type != rs2_stream::RS2_STREAM_ACCEL ){
+        return;
+    }
+
+    // Stop at End Position
+    if( end_position != 0 && playback.get_position() > end_position ){
+        finish();
+        return;
+    }
+
+    // Retrieve Motion Sample
+    const rs2::motion_frame motion = frame.as<rs2::motion_frame>();
+    const Sample sample = { frame.get_frame_number(), frame.get_timestamp(), motion.get_motion_data() };
+
+    // Push to Ring (Wait while Full, never Drop)
+    SpscRing<Sample>& ring = *streams[( stream_type == rs2_stream::RS2_STREAM_GYRO ) ? 0 : 1].ring;
+    while( !ring.push( sample ) ){
+        if( cancelled ){
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+// Writer Thread
+void ImuReader::work()
+{
+    Profiler::instance().setThreadName( "imu" );
+
+    while( true ){
+        // Check Stop before Draining, so that Samples Pushed before Stop are Written
+        const bool stopping = stopped;
+        try{
+            if( drain() ){
+                continue;
+            }
+        }
+        catch( ... ){
+            // Keep Draining (Discard Samples) to Release Waiting Callbacks
+            if( !exception ){
+                exception = std::current_exception();
+            }
+            continue;
+        }
+
+        if( stopping ){
+            break;
+        }
+
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+}
+
+// Drain Rings to Writers
+inline bool ImuReader::drain()
+{
+    bool drained = false;
+    for( Stream& stream : streams ){
+        if( !stream.ring ){
+            continue;
+        }
+
+        Sample sample;
+        while( stream.ring->pop( sample ) ){
+            drained = true;
+            if( exception ){
+                continue;
+            }
+            if( stream.writer ){
+                stream.writer->write( sample.frame_number, sample.timestamp, sample.data.x, sample.data.y, sample.data.z );
+                countProfile( "imu/samples", 1 );
+            }
+            stream.samples++;
+        }
+    }
+
+    return drained;
+}
+
+// Stop Sensors
+inline void ImuReader::stop()
+{
+    if( !started.exchange( false ) ){
+        return;
+    }
+
+    for( const rs2::sensor& sensor : sensors ){
+        sensor.stop();
+    }
+}
+
+// Notify End of Playback
+inline void ImuReader::finish()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    finished = true;
+    condition.notify_all();
+}
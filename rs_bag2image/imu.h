@@ -0,0 +1,106 @@
+#ifndef __IMU__
+#define __IMU__
+
+#include <librealsense2/rs.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ring.h"
+#include "writer.h"
+
+// IMU Reader
+// Extracts every gyro and accel sample by opening the motion sensors of a dedicated playback device
+// with frame callbacks, instead of picking one sample per frameset from the pipeline syncer.
+// Samples are passed from the callbacks to a writer thread through lock-free SPSC rings,
+// so the IMU path runs independently of the video path.
+// Without output directory, samples are only counted (e.g. for the estimate of probe).
+class ImuReader
+{
+private:
+    // Motion Sample
+    struct Sample
+    {
+        unsigned long long frame_number;
+        double timestamp;
+        rs2_vector data;
+    };
+
+    // Motion Stream (Gyro or Accel)
+    struct Stream
+    {
+        std::unique_ptr<SpscRing<Sample>> ring;
+        std::unique_ptr<CsvWriter> writer;     // null if samples are only counted
+        uint64_t samples = 0;                  // samples written (or counted)
+    };
+
+    // RealSense
+    rs2::context context;
+    rs2::playback playback;
+    std::vector<rs2::sensor> sensors;
+
+    // Streams (Gyro, Accel)
+    std::array<Stream, 2> streams;
+
+    // Writer Thread
+    std::thread thread;
+    std::atomic<bool> started{ false };
+    std::atomic<bool> stopped{ false };
+    std::atomic<bool> cancelled{ false };
+    std::exception_ptr exception;
+
+    // Playback Status
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool finished = false;
+
+    // Extraction Range (Playback Position in Nanoseconds, Zero is End of File)
+    uint64_t end_position = 0;
+
+public:
+    // Constructor
+    // Open selected motion streams (gyro, accel) of bag file, and create csv files in directory (empty is only counting).
+    ImuReader( const filesystem::path& bag_file, const filesystem::path& directory, std::chrono::steady_clock::duration flush_interval, const std::vector<rs2_stream>& motion_streams = { rs2_stream::RS2_STREAM_GYRO, rs2_stream::RS2_STREAM_ACCEL } );
+
+    // Destructor
+    ~ImuReader();
+
+    // Start Playback
+    // Seek to start position, and stop at end position (zero is end of file).
+    void start( uint64_t start_position = 0, uint64_t end_position = 0 );
+
+    // Wait for End of Playback and Flush All Samples
+    // Rethrow the error of writer thread.
+    void join();
+
+    // Check Motion Streams
+    bool empty() const;
+
+    // Retrieve Number of Samples of Motion Stream (Valid after Join)
+    uint64_t getSamples( rs2_stream stream_type ) const;
+
+private:
+    // Frame Callback (Playback Thread)
+    void enqueue( const rs2::frame& frame );
+
+    // Writer Thread
+    void work();
+
+    // Drain Rings to Writers
+    inline bool drain();
+
+    // Stop Sensors
+    inline void stop();
+
+    // Notify End of Playback
+    inline void finish();
+};
+
+#endif // __IMU__
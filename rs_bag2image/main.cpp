@@ -1,16 +1,52 @@
 #include <iostream>
 #include <sstream>
 
+#include "autotune.h"
+#include "batch.h"
+#include "probe.h"
 #include "realsense.h"
+#include "shard.h"
+#include "trace.h"
 
 int main( int argc, char* argv[] )
 {
+    int32_t result = EXIT_SUCCESS;
     try{
-        RealSense realsense( argc, argv );
-        realsense.run();
+        const Parameter parameter( argc, argv );
+        Profiler::instance().enable( parameter.timing, parameter.trace_file );
+
+        if( parameter.probe ){
+            Probe probe( parameter );
+            probe.run();
+        }
+        else if( parameter.autotune ){
+            if( !parameter.bag_files.empty() ){
+                throw std::runtime_error( "failed autotune needs one bag file" );
+            }
+            Autotune autotune( parameter );
+            autotune.run();
+        }
+        else if( !parameter.bag_files.empty() ){
+            Batch batch( parameter );
+            if( batch.run() > 0 ){
+                result = EXIT_FAILURE;
+            }
+        }
+        else if( parameter.shards > 1 ){
+            Sharding sharding( parameter );
+            sharding.run();
+        }
+        else{
+            RealSense realsense( parameter );
+            realsense.run();
+        }
+
+        // Show Timing Summary and Write Trace (All Threads have been Joined)
+        Profiler::instance().finish( std::cout );
     } catch( std::exception& ex ){
         std::cout << ex.what() << std::endl;
+        return EXIT_FAILURE;
     }
 
-    return 0;
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,406 @@
+#include "native.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    // Capacity of Frameset Queue of Syncer (Framesets are Taken after Each Message)
+    constexpr int32_t syncer_queue_size = 16;
+
+    // Bytes per Pixel of Format (0 is Unknown)
+    int32_t getBytesPerPixel( rs2_format format )
+    {
+        switch( format ){
+            case rs2_format::RS2_FORMAT_RGB8:
+            case rs2_format::RS2_FORMAT_BGR8:
+                return 3;
+            case rs2_format::RS2_FORMAT_RGBA8:
+            case rs2_format::RS2_FORMAT_BGRA8:
+                return 4;
+            case rs2_format::RS2_FORMAT_Z16:
+            case rs2_format::RS2_FORMAT_Y16:
+            case rs2_format::RS2_FORMAT_YUYV:
+            case rs2_format::RS2_FORMAT_UYVY:
+            case rs2_format::RS2_FORMAT_RAW16:
+                return 2;
+            case rs2_format::RS2_FORMAT_Y8:
+            case rs2_format::RS2_FORMAT_RAW8:
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    // Reader of Serialized Message (Little Endian)
+    class MessageReader
+    {
+    private:
+        const uint8_t* data;
+        std::size_t size;
+        std::size_t position = 0;
+
+    public:
+        explicit MessageReader( const RosBag::Message& message )
+            : data( message.data ), size( message.size )
+        {
+        }
+
+        // Retrieve Pointer to Bytes and Advance
+        const uint8_t* take( std::size_t length )
+        {
+            if( size < position || size - position < length ){
+                throw std::runtime_error( "failed corrupted message of bag file" );
+            }
+            const uint8_t* bytes = data + position;
+            position += length;
+            return bytes;
+        }
+
+        uint32_t readUint32()
+        {
+            uint32_t value;
+            std::memcpy( &value, take( sizeof( value ) ), sizeof( value ) );
+            return value;
+        }
+
+        double readFloat64()
+        {
+            double value;
+            std::memcpy( &value, take( sizeof( value ) ), sizeof( value ) );
+            return value;
+        }
+
+        // Skip std_msgs/Header (uint32 seq, time stamp, string frame_id)
+        // Return sequence and stamp [ns].
+        void readHeader( uint32_t& sequence, uint64_t& stamp )
+        {
+            sequence = readUint32();
+            const uint64_t seconds = readUint32();
+            const uint64_t nanoseconds = readUint32();
+            stamp = seconds * 1000000000 + nanoseconds;
+            take( readUint32() );
+        }
+    };
+
+    // Convert Stamp to Timestamp of Frame [ms] (as Playback of librealsense)
+    inline double getTimestamp( uint64_t stamp )
+    {
+        return std::chrono::duration<double, std::milli>( std::chrono::nanoseconds( stamp ) ).count();
+    }
+
+    // Release Buffer of Software Frame
+    void release( void* data )
+    {
+        delete[] static_cast<uint8_t*>( data );
+    }
+}
+
+// Constructor
+NativeReader::NativeReader( const filesystem::path& bag_file, const rs2::device& playback, const std::vector<rs2::stream_profile>& stream_profiles, uint32_t threads )
+    : bag( std::make_unique<RosBag>( bag_file, threads ) ), syncer( syncer_queue_size )
+{
+    // Create Software Sensor for Each Sensor of Playback Device that has Enabled Streams
+    // Unique ID of software profile is same as playback profile, so streams are identical.
+    std::vector<std::pair<rs2::stream_profile, rs2::stream_profile>> profile_pairs;
+    const std::vector<rs2::sensor> playback_sensors = playback.query_sensors();
+    for( std::size_t sensor_index = 0; sensor_index < playback_sensors.size(); sensor_index++ ){
+        const rs2::sensor& playback_sensor = playback_sensors[sensor_index];
+
+        std::vector<rs2::stream_profile> enabled_profiles;
+        for( const rs2::stream_profile& stream_profile : playback_sensor.get_stream_profiles() ){
+            for( const rs2::stream_profile& enabled_profile : stream_profiles ){
+                if( stream_profile.unique_id() == enabled_profile.unique_id() ){
+                    enabled_profiles.push_back( stream_profile );
+                }
+            }
+        }
+        if( enabled_profiles.empty() ){
+            continue;
+        }
+
+        rs2::software_sensor sensor = device.add_sensor( playback_sensor.get_info( rs2_camera_info::RS2_CAMERA_INFO_NAME ) );
+        std::vector<rs2::stream_profile> software_profiles;
+        for( const rs2::stream_profile& stream_profile : enabled_profiles ){
+            const rs2_stream stream_type = stream_profile.stream_type();
+            const int32_t stream_index = stream_profile.stream_index();
+            std::string topic = "/device_0/sensor_" + std::to_string( sensor_index ) + "/" + rs2_stream_to_string( stream_type ) + "_" + std::to_string( stream_index );
+
+            Stream stream = { sensors.size(), rs2::stream_profile(), false };
+            if( stream_profile.is<rs2::video_stream_profile>() ){
+                const rs2::video_stream_profile video_profile = stream_profile.as<rs2::video_stream_profile>();
+                const rs2_video_stream video_stream = { stream_type, stream_index, stream_profile.unique_id(), video_profile.width(), video_profile.height(), stream_profile.fps(), getBytesPerPixel( stream_profile.format() ), stream_profile.format(), video_profile.get_intrinsics() };
+                stream.profile = sensor.add_video_stream( video_stream, true );
+                topic += "/image/data";
+            }
+            else if( stream_type == rs2_stream::RS2_STREAM_GYRO || stream_type == rs2_stream::RS2_STREAM_ACCEL ){
+                const rs2_motion_stream motion_stream = { stream_type, stream_index, stream_profile.unique_id(), stream_profile.fps(), stream_profile.format(), {} };
+                stream.profile = sensor.add_motion_stream( motion_stream, true );
+                stream.motion = true;
+                topic += "/imu/data";
+            }
+            else{
+                throw std::runtime_error( "failed native reader doesn't support stream " + stream_profile.stream_name() );
+            }
+
+            const RosBag::Connection* connection = bag->findConnection( topic );
+            if( connection == nullptr ){
+                throw std::runtime_error( "failed can't find topic " + topic + " in bag file" );
+            }
+            streams[connection->id] = stream;
+            connections.push_back( connection->id );
+            software_profiles.push_back( stream.profile );
+            profiles.push_back( stream.profile );
+            profile_pairs.emplace_back( stream_profile, stream.profile );
+        }
+
+        // Depth Units of Depth Sensor
+        if( playback_sensor.is<rs2::depth_sensor>() ){
+            depth_scale = playback_sensor.as<rs2::depth_sensor>().get_depth_scale();
+            sensor.add_read_only_option( rs2_option::RS2_OPTION_DEPTH_UNITS, depth_scale );
+        }
+
+        sensors.push_back( sensor );
+        sensor_profiles.push_back( software_profiles );
+    }
+
+    // Register Extrinsics between Streams (Alignment and Point Cloud)
+    for( const std::pair<rs2::stream_profile, rs2::stream_profile>& from : profile_pairs ){
+        for( const std::pair<rs2::stream_profile, rs2::stream_profile>& to : profile_pairs ){
+            try{
+                rs2::stream_profile profile = from.second;
+                profile.register_extrinsics_to( to.second, from.first.get_extrinsics_to( to.first ) );
+            }
+            catch( const rs2::error& ){
+                // Streams without Calibration
+            }
+        }
+    }
+
+    // Start Sensors
+    device.create_matcher( RS2_MATCHER_DEFAULT );
+    for( std::size_t i = 0; i < sensors.size(); i++ ){
+        sensors[i].open( sensor_profiles[i] );
+    }
+    start();
+
+    // Read Messages from Beginning
+    bag->select( connections );
+}
+
+// Destructor
+NativeReader::~NativeReader()
+{
+    // Stop and Close Sensors
+    stop();
+    for( rs2::software_sensor& sensor : sensors ){
+        sensor.close();
+    }
+}
+
+// Read Next Frameset
+// Messages are injected in time order until the syncer releases a frameset.
+bool NativeReader::read( rs2::frameset& frameset )
+{
+    while( !poll( frameset ) ){
+        RosBag::Message message;
+        if( !bag->next( message ) ){
+            // End of File (Release Frames Held by Syncer Once)
+            if( flushed ){
+                return false;
+            }
+            flush();
+            flushed = true;
+            continue;
+        }
+        position = message.time;
+
+        const Stream& stream = streams.at( message.connection );
+        if( stream.motion ){
+            injectImu( stream, message );
+        }
+        else{
+            injectImage( stream, message );
+        }
+    }
+
+    return true;
+}
+
+// Seek to Position [ns]
+void NativeReader::seek( uint64_t position )
+{
+    // Restart Sensors to Discard Frames Pending in Syncer
+    stop();
+    start();
+
+    bag->select( connections, position );
+    this->position = position;
+    flushed = false;
+    last_timestamp = 0.0;
+    sentinel_timestamp = 0.0;
+}
+
+// Retrieve Position [ns]
+uint64_t NativeReader::getPosition() const
+{
+    return position;
+}
+
+// Retrieve Enabled Streams
+const std::vector<rs2::stream_profile>& NativeReader::getStreams() const
+{
+    return profiles;
+}
+
+// Retrieve Depth Scale [meters per unit]
+float NativeReader::getDepthScale() const
+{
+    return depth_scale;
+}
+
+// Start Sensors with New Syncer
+inline void NativeReader::start()
+{
+    syncer = rs2::syncer( syncer_queue_size );
+    for( rs2::software_sensor& sensor : sensors ){
+        sensor.start( syncer );
+    }
+}
+
+// Stop Sensors
+inline void NativeReader::stop()
+{
+    for( rs2::software_sensor& sensor : sensors ){
+        sensor.stop();
+    }
+}
+
+// Poll Frameset from Syncer
+inline bool NativeReader::poll( rs2::frameset& frameset )
+{
+    while( syncer.poll_for_frames( &frameset ) ){
+        bool sentinel = false;
+        for( std::size_t i = 0; i < frameset.size(); i++ ){
+            sentinel = sentinel || ( sentinel_timestamp != 0.0 && frameset[i].get_timestamp() >= sentinel_timestamp );
+        }
+        if( !sentinel ){
+            return true;
+        }
+    }
+    return false;
+}
+
+// Release Frames Held by Syncer at End of File
+inline void NativeReader::flush()
+{
+    // Sentinel is Far beyond Matching Threshold of Any Stream
+    constexpr double sentinel_offset = 1000000.0; // ms
+    sentinel_timestamp = last_timestamp + sentinel_offset;
+
+    for( const std::pair<const uint32_t, Stream>& element : streams ){
+        const Stream& stream = element.second;
+        if( stream.motion ){
+            float* data = reinterpret_cast<float*>( new uint8_t[sizeof( float ) * 3]() );
+
+            rs2_software_motion_frame frame = {};
+            frame.data = data;
+            frame.deleter = release;
+            frame.timestamp = sentinel_timestamp;
+            frame.domain = rs2_timestamp_domain::RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK;
+            frame.frame_number = 0;
+            frame.profile = stream.profile.get();
+            sensors[stream.sensor].on_motion_frame( frame );
+        }
+        else{
+            const rs2::video_stream_profile video_profile = stream.profile.as<rs2::video_stream_profile>();
+            const int32_t bytes_per_pixel = std::max( 1, getBytesPerPixel( stream.profile.format() ) );
+            const std::size_t size = static_cast<std::size_t>( video_profile.width() ) * video_profile.height() * bytes_per_pixel;
+
+            rs2_software_video_frame frame = {};
+            frame.pixels = new uint8_t[size]();
+            frame.deleter = release;
+            frame.stride = video_profile.width() * bytes_per_pixel;
+            frame.bpp = bytes_per_pixel;
+            frame.timestamp = sentinel_timestamp;
+            frame.domain = rs2_timestamp_domain::RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK;
+            frame.frame_number = 0;
+            frame.profile = stream.profile.get();
+            sensors[stream.sensor].on_video_frame( frame );
+        }
+    }
+}
+
+// Inject Image Message into Software Sensor
+// sensor_msgs/Image (header, uint32 height, uint32 width, string encoding, uint8 is_bigendian, uint32 step, uint8[] data)
+inline void NativeReader::injectImage( const Stream& stream, const RosBag::Message& message )
+{
+    TRACE_SCOPE( "native/image" );
+    MessageReader reader( message );
+    uint32_t sequence;
+    uint64_t stamp;
+    reader.readHeader( sequence, stamp );
+    const uint32_t height = reader.readUint32();
+    const uint32_t width = reader.readUint32();
+    reader.take( reader.readUint32() );
+    reader.take( 1 );
+    const uint32_t step = reader.readUint32();
+    const uint32_t size = reader.readUint32();
+    const uint8_t* data = reader.take( size );
+    if( width == 0 || static_cast<uint64_t>( step ) * height > size ){
+        throw std::runtime_error( "failed corrupted image message of bag file" );
+    }
+
+    // Copy Pixels (Frame Outlives Chunk)
+    uint8_t* pixels = new uint8_t[size];
+    std::memcpy( pixels, data, size );
+
+    rs2_software_video_frame frame = {};
+    frame.pixels = pixels;
+    frame.deleter = release;
+    frame.stride = static_cast<int32_t>( step );
+    frame.bpp = static_cast<int32_t>( step / width );
+    frame.timestamp = getTimestamp( stamp );
+    last_timestamp = std::max( last_timestamp, frame.timestamp );
+    frame.domain = rs2_timestamp_domain::RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK;
+    frame.frame_number = static_cast<decltype( frame.frame_number )>( sequence );
+    frame.profile = stream.profile.get();
+    sensors[stream.sensor].on_video_frame( frame );
+}
+
+// Inject Imu Message into Software Sensor
+// sensor_msgs/Imu (header, orientation, float64[9] covariance, angular_velocity, float64[9] covariance, linear_acceleration, float64[9] covariance)
+inline void NativeReader::injectImu( const Stream& stream, const RosBag::Message& message )
+{
+    MessageReader reader( message );
+    uint32_t sequence;
+    uint64_t stamp;
+    reader.readHeader( sequence, stamp );
+    reader.take( sizeof( double ) * ( 4 + 9 ) );
+    if( stream.profile.stream_type() == rs2_stream::RS2_STREAM_ACCEL ){
+        reader.take( sizeof( double ) * ( 3 + 9 ) );
+    }
+
+    const double x = reader.readFloat64();
+    const double y = reader.readFloat64();
+    const double z = reader.readFloat64();
+
+    float* data = reinterpret_cast<float*>( new uint8_t[sizeof( float ) * 3] );
+    data[0] = static_cast<float>( x );
+    data[1] = static_cast<float>( y );
+    data[2] = static_cast<float>( z );
+
+    rs2_software_motion_frame frame = {};
+    frame.data = data;
+    frame.deleter = release;
+    frame.timestamp = getTimestamp( stamp );
+    last_timestamp = std::max( last_timestamp, frame.timestamp );
+    frame.domain = rs2_timestamp_domain::RS2_TIMESTAMP_DOMAIN_HARDWARE_CLOCK;
+    frame.frame_number = static_cast<decltype( frame.frame_number )>( sequence );
+    frame.profile = stream.profile.get();
+    sensors[stream.sensor].on_motion_frame( frame );
+}
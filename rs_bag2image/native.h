@@ -0,0 +1,105 @@
+#ifndef __NATIVE__
+#define __NATIVE__
+
+#include <librealsense2/rs.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "filesystem.h"
+#include "rosbag.h"
+
+// Native Bag Reader
+// Reads image and imu messages of RealSense bag file (ROS bag v2 layout of librealsense recorder) with RosBag,
+// and delivers them as framesets in time order, instead of playback device of librealsense.
+// Chunks are decompressed in parallel ahead of reading, and no frame is dropped or paced by the playback thread.
+//
+// Device description (sensors, stream profiles, intrinsics, extrinsics and depth units) is taken from playback device,
+// so streams are identical to playback. Frames are injected into a software device with the same stream profiles
+// and synchronized by a syncer with default matcher, so framesets are paired as in pipeline of playback.
+//
+// Topics (s is sensor index, <Stream>_<i> is stream type and index)
+//   /device_0/sensor_s/<Stream>_<i>/image/data : sensor_msgs/Image (header.seq is frame number, header.stamp is timestamp)
+//   /device_0/sensor_s/<Stream>_<i>/imu/data   : sensor_msgs/Imu (angular_velocity of gyro, linear_acceleration of accel)
+class NativeReader
+{
+private:
+    // Stream of Connection
+    struct Stream
+    {
+        std::size_t sensor;                 // index of software sensor
+        rs2::stream_profile profile;        // profile of software sensor
+        bool motion;
+    };
+
+    // Bag File
+    std::unique_ptr<RosBag> bag;
+    std::vector<uint32_t> connections;
+    std::map<uint32_t, Stream> streams;
+    uint64_t position = 0;
+    bool flushed = false;               // frames held by syncer have been released at end of file
+    double last_timestamp = 0.0;        // latest timestamp of injected frames [ms]
+    double sentinel_timestamp = 0.0;    // timestamp of frames that flush syncer [ms], 0 is not flushed
+
+    // Software Device
+    rs2::software_device device;
+    std::vector<rs2::software_sensor> sensors;
+    std::vector<std::vector<rs2::stream_profile>> sensor_profiles;
+    std::vector<rs2::stream_profile> profiles;
+    rs2::syncer syncer;
+    float depth_scale = 0.0f;
+
+public:
+    // Constructor
+    // Open bag file with streams of playback device. threads is number of decompression threads, 0 is number of cores.
+    NativeReader( const filesystem::path& bag_file, const rs2::device& playback, const std::vector<rs2::stream_profile>& stream_profiles, uint32_t threads = 0 );
+
+    // Destructor
+    ~NativeReader();
+
+    NativeReader( const NativeReader& ) = delete;
+    NativeReader& operator=( const NativeReader& ) = delete;
+
+    // Read Next Frameset
+    // Frames that the syncer still holds at end of file are released as the last framesets.
+    // Return false at end of file.
+    bool read( rs2::frameset& frameset );
+
+    // Seek to Position [ns] (Receive Time of Messages, as Playback Position)
+    void seek( uint64_t position );
+
+    // Retrieve Position [ns] (Receive Time of Last Message)
+    uint64_t getPosition() const;
+
+    // Retrieve Enabled Streams
+    const std::vector<rs2::stream_profile>& getStreams() const;
+
+    // Retrieve Depth Scale [meters per unit]
+    // Return 0.0 if the device has no depth sensor.
+    float getDepthScale() const;
+
+private:
+    // Start Sensors with New Syncer (Frames Pending in Previous Syncer are Discarded)
+    inline void start();
+
+    // Stop Sensors
+    inline void stop();
+
+    // Poll Frameset from Syncer (Framesets that Contain Sentinel Frames are Discarded)
+    inline bool poll( rs2::frameset& frameset );
+
+    // Release Frames Held by Syncer at End of File
+    // A sentinel frame far after the last frame is injected into every stream, so the matcher stops waiting for
+    // partners of the pending frames and releases them. Sentinel frames are discarded by poll().
+    inline void flush();
+
+    // Inject Image Message into Software Sensor
+    inline void injectImage( const Stream& stream, const RosBag::Message& message );
+
+    // Inject Imu Message into Software Sensor
+    inline void injectImu( const Stream& stream, const RosBag::Message& message );
+};
+
+#endif // __NATIVE__
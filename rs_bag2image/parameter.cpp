@@ -0,0 +1,468 @@
+#include "parameter.h"
+#include "colorize.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+// Constructor (Parse Command Line Arguments)
+Parameter::Parameter( int argc, char* argv[] )
+{
+    // Create Command Line Parser
+    const std::string keys =
+        "{ help h        |       | print this message.                                                      }"
+        "{ bag b         |       | path to input bag file, or directory, glob or list file of bag files.    }"
+        "{ native        | false | read bag file with native reader and parallel decompression. (bool)      }"
+        "{ scaling s     | false | enable depth scaling for visualization. false is raw 16bit image. (bool) }"
+        "{ near          | 0     | near distance of depth visualization in meters.                          }"
+        "{ far           | 10    | far distance of depth visualization in meters.                           }"
+        "{ inverse       | false | map inverse depth for depth visualization. (bool)                        }"
+        "{ colormap      | none  | colormap of depth visualization. none,jet,turbo,bone,hot,inferno,viridis }"
+        "{ quality q     | 95    | jpeg encoding quality for color and infrared. [0-100]                    }"
+        "{ display d     | false | display each stream images on window. false is not display. (bool)       }"
+        "{ jobs j        | 0     | number of encoder threads for pipelined extraction. 0 is serial.         }"
+        "{ flush f       | 0     | flush interval of csv files in seconds. 0 is flush at the end.           }"
+        "{ async         | false | write images behind encoding with io_uring or thread pool. (bool)        }"
+        "{ inflight      | 256   | cap of in-flight bytes of asynchronous image writes in MiB.              }"
+        "{ imu i         | false | extract every imu sample with sensor callbacks. false is per frameset.   }"
+        "{ streams       |       | streams to extract. color,depth,infrared(ir,ir_right),imu(gyro,accel)    }"
+        "{ start         |       | start time of extraction range in seconds.                               }"
+        "{ end           |       | end time of extraction range in seconds.                                 }"
+        "{ first         |       | first frame index of extraction range. (frame rate of color stream)      }"
+        "{ last          |       | last frame index of extraction range. (frame rate of color stream)       }"
+        "{ step          | 1     | keep every n-th frame of each image stream. 1 is all frames.             }"
+        "{ fps           | 0     | keep frames of each image stream at fps by timestamp. 0 is all frames.   }"
+        "{ scale         | 1     | scale of images (0-1]. scale for all, or stream:scale,... (see README)   }"
+        "{ crop          |       | region of images WxH+X+Y for all, or stream:WxH+X+Y,... (see README)     }"
+        "{ shards k      | 1     | number of time segments of bag file that are converted in parallel.      }"
+        "{ batch n       | 1     | number of bag files that are converted concurrently in batch mode.       }"
+        "{ stack         |       | write raw depth of all frames to one memory-mappable file. raw or npy.   }"
+        "{ video v       |       | write color and infrared to video file with fourcc (e.g. mp4v).          }"
+        "{ archive       |       | append images and csv files to one archive with index. tar or zip.       }"
+        "{ filter        |       | depth filter chain on own thread. e.g. decimation,spatial,temporal       }"
+        "{ align         |       | write aligned images. depth (to color), color (to depth) or both.        }"
+        "{ cloud         |       | write point cloud of depth. ply, pcd (file per frame) or packed.         }"
+        "{ stride        | 1     | pixel stride of point cloud decimation.                                  }"
+        "{ voxel         | 0     | voxel size of point cloud decimation in meters. 0 is not decimated.      }"
+        "{ texture       | false | sample color of points from color stream. (bool)                         }"
+        "{ color_profile |       | encoder profile of color. codec[:key=value,...] (see README)             }"
+        "{ depth_profile | png   | encoder profile of depth. png or tiff for raw 16bit image.               }"
+        "{ ir_profile    |       | encoder profile of infrared. default is jpg with quality.                }"
+        "{ autotune      | false | encode sample frames under candidate profiles, and report. (bool)        }"
+        "{ probe info    | false | report streams, frame statistics and output estimate as json. (bool)     }"
+        "{ samples       | 30    | number of sample frames per stream for autotune and probe.               }"
+        "{ resume r      | false | resume extraction from checkpoint in output directory. (bool)            }"
+        "{ checkpoint    |       | checkpoint interval in seconds for resumable extraction. default is off. }"
+        "{ timing        | false | show count, total and p50/p95/p99 time of each stage at exit. (bool)     }"
+        "{ trace         |       | write chrome trace_event json file of stages. (open with perfetto)       }";
+    cv::CommandLineParser parser( argc, argv, keys );
+
+    if( parser.has( "help" ) ){
+        parser.printMessage();
+        std::exit( EXIT_SUCCESS );
+    }
+
+    // Check Parsing Error
+    if( !parser.check() ){
+        parser.printErrors();
+        throw std::runtime_error( "failed command arguments" );
+    }
+
+    // Retrieve Bag File Path (Required)
+    // Directory, glob pattern or list file of bag files enables batch mode.
+    if( !parser.has( "bag" ) ){
+        throw std::runtime_error( "failed can't find input bag file" );
+    }
+    else{
+        const filesystem::path input = parser.get<cv::String>( "bag" ).c_str();
+        if( filesystem::is_regular_file( input ) && input.extension() == ".bag" ){
+            bag_file = input;
+        }
+        else{
+            bag_files = findBagFiles( input );
+            if( bag_files.empty() ){
+                throw std::runtime_error( "failed can't find input bag file" );
+            }
+        }
+    }
+
+    // Retrieve Native Reader Flag (Option)
+    if( parser.has( "native" ) ){
+        native = parser.get<bool>( "native" );
+    }
+
+    // Retrieve Scaling Flag (Option)
+    if( parser.has( "scaling" ) ){
+        scaling = parser.get<bool>( "scaling" );
+    }
+
+    // Retrieve Depth Visualization (Option)
+    if( parser.has( "near" ) ){
+        depth_near = std::max( 0.0, parser.get<double>( "near" ) );
+    }
+    if( parser.has( "far" ) ){
+        depth_far = parser.get<double>( "far" );
+    }
+    if( !( depth_near < depth_far ) ){
+        throw std::runtime_error( "failed depth range must be near < far" );
+    }
+    if( parser.has( "inverse" ) ){
+        depth_inverse = parser.get<bool>( "inverse" );
+    }
+    if( parser.has( "colormap" ) ){
+        depth_colormap = DepthColorizer::getColormap( parser.get<cv::String>( "colormap" ) );
+    }
+
+    // Retrieve JPEG Quality (Option)
+    if( parser.has( "quality" ) ){
+        quality = std::min( std::max( 0, parser.get<int32_t>( "quality" ) ), 100 );
+    }
+
+    // Retrieve Display Flag (Option)
+    if( parser.has( "display" ) ){
+        display = parser.get<bool>( "display" );
+    }
+
+    // Retrieve Encoder Threads (Option)
+    if( parser.has( "jobs" ) ){
+        jobs = static_cast<uint32_t>( std::max( 0, parser.get<int32_t>( "jobs" ) ) );
+    }
+
+    // Retrieve CSV Flush Interval (Option)
+    if( parser.has( "flush" ) ){
+        const double flush = std::max( 0.0, parser.get<double>( "flush" ) );
+        flush_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( flush ) );
+    }
+
+    // Retrieve Asynchronous Image Writes (Option)
+    if( parser.has( "async" ) && parser.get<bool>( "async" ) ){
+        const int32_t inflight = std::max( 1, parser.get<int32_t>( "inflight" ) );
+        write_behind = static_cast<std::size_t>( inflight ) << 20;
+    }
+
+    // Retrieve Lossless IMU Flag (Option)
+    if( parser.has( "imu" ) ){
+        imu_lossless = parser.get<bool>( "imu" );
+    }
+
+    // Retrieve Stream Selection (Option)
+    if( parser.has( "streams" ) ){
+        const std::map<std::string, std::vector<std::string>> aliases = {
+            { "color", { "color" } }, { "depth", { "depth" } },
+            { "infrared", { "ir", "ir_right" } }, { "ir", { "ir" } }, { "ir_right", { "ir_right" } },
+            { "imu", { "gyro", "accel" } }, { "gyro", { "gyro" } }, { "accel", { "accel" } }
+        };
+
+        std::istringstream iss( parser.get<cv::String>( "streams" ) );
+        std::string name;
+        while( std::getline( iss, name, ',' ) ){
+            std::transform( name.begin(), name.end(), name.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+            const std::map<std::string, std::vector<std::string>>::const_iterator alias = aliases.find( name );
+            if( alias == aliases.end() ){
+                throw std::runtime_error( "failed unknown stream name " + name );
+            }
+            selected_streams.insert( alias->second.begin(), alias->second.end() );
+        }
+    }
+
+    // Retrieve Extraction Range (Option)
+    if( parser.has( "start" ) ){
+        start_time = std::max( 0.0, parser.get<double>( "start" ) );
+    }
+    if( parser.has( "end" ) ){
+        end_time = std::max( 0.0, parser.get<double>( "end" ) );
+    }
+    if( parser.has( "first" ) ){
+        first_frame = std::max( 0, parser.get<int32_t>( "first" ) );
+    }
+    if( parser.has( "last" ) ){
+        last_frame = std::max( 0, parser.get<int32_t>( "last" ) );
+    }
+    if( ( parser.has( "start" ) || parser.has( "end" ) ) && ( parser.has( "first" ) || parser.has( "last" ) ) ){
+        throw std::runtime_error( "failed can't specify both time range and frame range" );
+    }
+
+    // Retrieve Temporal Subsampling (Option)
+    if( parser.has( "step" ) ){
+        frame_step = static_cast<uint32_t>( std::max( 1, parser.get<int32_t>( "step" ) ) );
+    }
+    if( parser.has( "fps" ) ){
+        target_fps = std::max( 0.0, parser.get<double>( "fps" ) );
+    }
+
+    // Retrieve Scale and Crop of Images (Option)
+    std::map<std::string, FrameTransform*> transforms = { { "color", &color_transform }, { "depth", &depth_transform }, { "infrared", &infrared_transform } };
+    if( parser.has( "scale" ) ){
+        for( const std::pair<const std::string, std::string>& value : parseStreamValues( parser.get<cv::String>( "scale" ) ) ){
+            const double scale = std::atof( value.second.c_str() );
+            if( !( 0.0 < scale && scale <= 1.0 ) ){
+                throw std::runtime_error( "failed scale must be in (0-1] " + value.second );
+            }
+            transforms[value.first]->scale = scale;
+        }
+    }
+    if( parser.has( "crop" ) ){
+        const std::regex geometry( R"(^(\d+)x(\d+)\+(\d+)\+(\d+)$)" );
+        for( const std::pair<const std::string, std::string>& value : parseStreamValues( parser.get<cv::String>( "crop" ) ) ){
+            std::smatch match;
+            if( !std::regex_match( value.second, match, geometry ) ){
+                throw std::runtime_error( "failed crop must be WxH+X+Y " + value.second );
+            }
+            transforms[value.first]->roi = cv::Rect( std::stoi( match[3] ), std::stoi( match[4] ), std::stoi( match[1] ), std::stoi( match[2] ) );
+        }
+    }
+
+    // Retrieve Number of Shards (Option)
+    if( parser.has( "shards" ) ){
+        shards = static_cast<uint32_t>( std::max( 1, parser.get<int32_t>( "shards" ) ) );
+    }
+
+    // Retrieve Depth Stack Layout (Option)
+    if( parser.has( "stack" ) ){
+        depth_stack = parser.get<cv::String>( "stack" );
+        std::transform( depth_stack.begin(), depth_stack.end(), depth_stack.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+        if( depth_stack != "raw" && depth_stack != "npy" ){
+            throw std::runtime_error( "failed unknown depth stack layout " + depth_stack );
+        }
+        if( shards > 1 ){
+            throw std::runtime_error( "failed depth stack can't be written by sharded extraction" );
+        }
+    }
+
+    // Retrieve Video FourCC (Option)
+    if( parser.has( "video" ) ){
+        video_fourcc = parser.get<cv::String>( "video" );
+        if( video_fourcc.size() != 4 ){
+            throw std::runtime_error( "failed fourcc must be four characters " + video_fourcc );
+        }
+        if( shards > 1 ){
+            throw std::runtime_error( "failed video can't be written by sharded extraction" );
+        }
+    }
+
+    // Retrieve Archive Format (Option)
+    if( parser.has( "archive" ) ){
+        archive = parser.get<cv::String>( "archive" );
+        std::transform( archive.begin(), archive.end(), archive.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+        if( archive != "tar" && archive != "zip" ){
+            throw std::runtime_error( "failed unknown archive format " + archive );
+        }
+        if( shards > 1 ){
+            throw std::runtime_error( "failed archive can't be written by sharded extraction" );
+        }
+    }
+
+    // Retrieve Depth Filter Chain (Option)
+    if( parser.has( "filter" ) ){
+        depth_filter = parser.get<cv::String>( "filter" );
+    }
+
+    // Retrieve Alignment (Option)
+    if( parser.has( "align" ) ){
+        align = parser.get<cv::String>( "align" );
+        std::transform( align.begin(), align.end(), align.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+        if( align != "depth" && align != "color" && align != "both" ){
+            throw std::runtime_error( "failed unknown alignment " + align );
+        }
+    }
+
+    // Retrieve Point Cloud (Option)
+    if( parser.has( "cloud" ) ){
+        cloud = parser.get<cv::String>( "cloud" );
+        std::transform( cloud.begin(), cloud.end(), cloud.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+        if( cloud != "ply" && cloud != "pcd" && cloud != "packed" ){
+            throw std::runtime_error( "failed unknown point cloud format " + cloud );
+        }
+        if( cloud == "packed" && shards > 1 ){
+            throw std::runtime_error( "failed packed point cloud can't be written by sharded extraction" );
+        }
+    }
+    if( parser.has( "stride" ) ){
+        cloud_stride = static_cast<uint32_t>( std::max( 1, parser.get<int32_t>( "stride" ) ) );
+    }
+    if( parser.has( "voxel" ) ){
+        cloud_voxel = std::max( 0.0, parser.get<double>( "voxel" ) );
+    }
+    if( parser.has( "texture" ) ){
+        cloud_texture = parser.get<bool>( "texture" );
+    }
+
+    // Retrieve Resume Flag and Checkpoint Interval (Option)
+    // Depth stack, video, packed point cloud, lossless imu and archive are written as continuous streams that can't be truncated at checkpoint.
+    // Depth filter reads framesets ahead, and temporal filter can't be restored at checkpoint.
+    if( parser.has( "resume" ) ){
+        resume = parser.get<bool>( "resume" );
+    }
+    // Checkpoint is off by default, because each checkpoint waits for pending images of encoder.
+    // Resumed extraction keeps taking checkpoints at 10 seconds unless the interval is given.
+    // The key has no default value, because CommandLineParser::has() is true for any non-empty default.
+    if( parser.has( "checkpoint" ) ){
+        checkpoint_interval = std::max( 0.0, parser.get<double>( "checkpoint" ) );
+    }
+    else if( resume ){
+        checkpoint_interval = 10.0;
+    }
+    if( resume ){
+        if( shards > 1 ){
+            throw std::runtime_error( "failed sharded extraction can't be resumed" );
+        }
+        if( !depth_stack.empty() || !video_fourcc.empty() || imu_lossless || cloud == "packed" || !archive.empty() || !depth_filter.empty() ){
+            throw std::runtime_error( "failed depth stack, video, packed point cloud, lossless imu, archive and depth filter can't be resumed" );
+        }
+        if( checkpoint_interval == 0.0 ){
+            throw std::runtime_error( "failed resume requires checkpoint" );
+        }
+    }
+
+    // Check Transformed Images Keep Intrinsics of Stream (Alignment, Point Cloud and Depth Stack Need Full Frame)
+    if( !depth_transform.isIdentity() && ( !align.empty() || !cloud.empty() || !depth_stack.empty() ) ){
+        throw std::runtime_error( "failed depth scale and crop can't be used with alignment, point cloud and depth stack" );
+    }
+    if( !color_transform.isIdentity() && ( align == "color" || align == "both" || cloud_texture ) ){
+        throw std::runtime_error( "failed color scale and crop can't be used with color alignment and point cloud texture" );
+    }
+
+    // Retrieve Encoder Profiles (Option)
+    // Color and infrared use jpeg with quality by default.
+    const std::string jpeg_profile = "jpg:quality=" + std::to_string( quality );
+    color_profile = EncoderProfile::parse( parser.has( "color_profile" ) ? std::string( parser.get<cv::String>( "color_profile" ) ) : jpeg_profile );
+    depth_profile = EncoderProfile::parse( parser.has( "depth_profile" ) ? std::string( parser.get<cv::String>( "depth_profile" ) ) : "png" );
+    infrared_profile = EncoderProfile::parse( parser.has( "ir_profile" ) ? std::string( parser.get<cv::String>( "ir_profile" ) ) : jpeg_profile );
+    if( !scaling && !depth_profile.supports16bit() ){
+        throw std::runtime_error( "failed " + depth_profile.codec + " can't encode raw 16bit depth" );
+    }
+
+    // Retrieve Probe Flag (Option)
+    if( parser.has( "probe" ) ){
+        probe = parser.get<bool>( "probe" );
+    }
+    if( probe && ( !video_fourcc.empty() || !depth_stack.empty() || !archive.empty() || !align.empty() || !cloud.empty() ) ){
+        throw std::runtime_error( "failed probe estimates only image files, so video, depth stack, archive, alignment and point cloud can't be probed" );
+    }
+
+    // Retrieve Autotune Flag and Number of Samples (Option)
+    if( parser.has( "autotune" ) ){
+        autotune = parser.get<bool>( "autotune" );
+    }
+    if( parser.has( "samples" ) ){
+        autotune_samples = static_cast<uint32_t>( std::max( 1, parser.get<int32_t>( "samples" ) ) );
+    }
+
+    // Retrieve Instrumentation (Option)
+    if( parser.has( "timing" ) ){
+        timing = parser.get<bool>( "timing" );
+    }
+    if( parser.has( "trace" ) ){
+        trace_file = parser.get<cv::String>( "trace" ).c_str();
+    }
+
+    // Retrieve Number of Concurrent Conversions in Batch Mode (Option)
+    if( parser.has( "batch" ) ){
+        concurrency = static_cast<uint32_t>( std::max( 1, parser.get<int32_t>( "batch" ) ) );
+    }
+}
+
+// Parse Value of Each Image Stream ("value" for all streams, or "stream:value,...")
+std::map<std::string, std::string> Parameter::parseStreamValues( const std::string& value )
+{
+    std::map<std::string, std::string> values;
+    if( value.find( ':' ) == std::string::npos ){
+        for( const char* name : { "color", "depth", "infrared" } ){
+            values[name] = value;
+        }
+        return values;
+    }
+
+    std::istringstream iss( value );
+    std::string item;
+    while( std::getline( iss, item, ',' ) ){
+        const std::size_t colon = item.find( ':' );
+        std::string name = item.substr( 0, colon );
+        std::transform( name.begin(), name.end(), name.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+        if( name == "ir" ){
+            name = "infrared";
+        }
+        if( colon == std::string::npos || ( name != "color" && name != "depth" && name != "infrared" ) ){
+            throw std::runtime_error( "failed unknown image stream " + item );
+        }
+        values[name] = item.substr( colon + 1 );
+    }
+    return values;
+}
+
+// Find Bag Files (Directory, Glob Pattern or List File)
+std::vector<filesystem::path> Parameter::findBagFiles( const filesystem::path& input )
+{
+    std::vector<filesystem::path> files;
+
+    // Directory (All Bag Files in Directory and Sub Directories)
+    if( filesystem::is_directory( input ) ){
+        for( const filesystem::directory_entry& entry : filesystem::recursive_directory_iterator( input ) ){
+            if( filesystem::is_regular_file( entry.path() ) && entry.path().extension() == ".bag" ){
+                files.push_back( entry.path() );
+            }
+        }
+        std::sort( files.begin(), files.end() );
+    }
+    // List File (One Bag File per Line, Relative to List File, # is Comment)
+    // Missing files are kept in the list so that they are reported as failed conversions.
+    else if( filesystem::is_regular_file( input ) ){
+        std::ifstream list( input.string() );
+        std::string line;
+        while( std::getline( list, line ) ){
+            line.erase( 0, line.find_first_not_of( " \t" ) );
+            line.erase( line.find_last_not_of( " \t\r" ) + 1 );
+            if( line.empty() || line.front() == '#' ){
+                continue;
+            }
+            const filesystem::path file = line;
+            files.push_back( file.is_absolute() ? file : input.parent_path() / file );
+        }
+    }
+    // Glob Pattern (Wildcards * and ? in File Name)
+    else{
+        const std::string pattern = input.filename().string();
+        if( pattern.find_first_of( "*?" ) == std::string::npos ){
+            return files;
+        }
+
+        std::string expression;
+        for( const char c : pattern ){
+            switch( c ){
+                case '*':
+                    expression += ".*";
+                    break;
+                case '?':
+                    expression += ".";
+                    break;
+                default:
+                    if( std::string( ".^$|()[]{}+\\" ).find( c ) != std::string::npos ){
+                        expression += '\\';
+                    }
+                    expression += c;
+                    break;
+            }
+        }
+
+        const filesystem::path parent_directory = input.has_parent_path() ? input.parent_path() : filesystem::path( "." );
+        if( !filesystem::is_directory( parent_directory ) ){
+            return files;
+        }
+
+        const std::regex regex( expression );
+        for( const filesystem::directory_entry& entry : filesystem::directory_iterator( parent_directory ) ){
+            if( filesystem::is_regular_file( entry.path() ) && std::regex_match( entry.path().filename().string(), regex ) ){
+                files.push_back( entry.path() );
+            }
+        }
+        std::sort( files.begin(), files.end() );
+    }
+
+    return files;
+}
@@ -0,0 +1,118 @@
+#ifndef __PARAMETER__
+#define __PARAMETER__
+
+#include <librealsense2/rs.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "convert.h"
+#include "filesystem.h"
+#include "profile.h"
+
+// Stream Key (Stream Type, Stream Index)
+using StreamKey = std::pair<rs2_stream, int32_t>;
+
+// Parameter
+// Describes one extraction. Created from command line arguments,
+// and derived for each segment of sharded extraction.
+struct Parameter
+{
+    // Input Bag File
+    filesystem::path bag_file;
+    bool native = false;                                        // read messages of bag file with native reader (see native.h) instead of playback
+
+    // Batch Mode (Bag Files Found from Directory, Glob Pattern or List File)
+    std::vector<filesystem::path> bag_files;
+    uint32_t concurrency = 1;
+
+    // Output
+    filesystem::path output_directory;                          // parent of root directory (bag name) of output, empty is directory of bag file
+    bool scaling = false;
+    int32_t quality = 95;
+    bool display = false;
+    uint32_t jobs = 0;
+    std::chrono::steady_clock::duration flush_interval = std::chrono::steady_clock::duration::zero();
+    bool imu_lossless = false;
+    std::size_t write_behind = 0;                               // cap of in-flight bytes of asynchronous image writes, 0 is cv::imwrite
+    std::string depth_stack;                                    // raw depth stack layout (raw or npy), empty is png files
+    std::string video_fourcc;                                   // fourcc of color and infrared video, empty is jpeg files
+    std::string archive;                                        // archive format of images and csv files (tar or zip), empty is files
+    std::string depth_filter;                                   // post-processing filter chain of depth (see filter.h), empty is not filtered
+    std::string align;                                          // aligned images (depth, color or both), empty is not aligned
+    std::string cloud;                                          // point cloud format (ply, pcd or packed), empty is not written
+    uint32_t cloud_stride = 1;                                  // pixel stride of point cloud decimation
+    double cloud_voxel = 0.0;                                   // meters, 0 is no voxel grid decimation
+    bool cloud_texture = false;                                 // color of points sampled from color stream
+
+    // Depth Visualization (Scaling and Display)
+    double depth_near = 0.0;                                    // meters
+    double depth_far = 10.0;                                    // meters
+    bool depth_inverse = false;
+    int32_t depth_colormap = -1;                                // cv::ColormapTypes, -1 is gray
+
+    // Temporal Subsampling of Image Streams (Skipped Frames are not Converted)
+    uint32_t frame_step = 1;                                    // keep every n-th frame of each image stream
+    double target_fps = 0.0;                                    // keep frames of each image stream at fps by timestamp, 0 is all frames
+
+    // Spatial Transform of Images (Cropped and Scaled while Converting)
+    FrameTransform color_transform;
+    FrameTransform depth_transform;
+    FrameTransform infrared_transform;
+
+    // Encoder Profiles
+    EncoderProfile color_profile = EncoderProfile::parse( "jpg:quality=95" );
+    EncoderProfile depth_profile = EncoderProfile::parse( "png" );
+    EncoderProfile infrared_profile = EncoderProfile::parse( "jpg:quality=95" );
+
+    // Autotune (Report Encoder Profiles instead of Extraction)
+    bool autotune = false;
+    uint32_t autotune_samples = 30;                             // sample frames per stream of autotune and probe calibration
+
+    // Probe (Report Summary and Output Estimate of Bag Files as JSON instead of Extraction)
+    bool probe = false;
+
+    // Stream Selection (Empty is All Streams)
+    std::set<std::string> selected_streams;
+
+    // Extraction Range
+    double start_time = 0.0;
+    double end_time = 0.0;
+    int32_t first_frame = -1;
+    int32_t last_frame = -1;
+
+    // Resumable Extraction (Checkpoint Manifest in Output Directory)
+    bool resume = false;                                        // continue from last checkpoint of previous extraction
+    double checkpoint_interval = 0.0;                           // seconds, 0 is no checkpoint (10 if resumed without interval)
+
+    // Instrumentation
+    bool timing = false;                                        // show summary table of stages at exit
+    filesystem::path trace_file;                                // chrome trace_event json, empty is not written
+
+    // Sharded Extraction
+    uint32_t shards = 1;
+    int32_t shard = -1;                                         // segment index, -1 is not sharded
+    std::map<StreamKey, std::pair<double, double>> timestamp_ranges; // write only frames of stream with timestamp in [first, second)
+    bool quiet = false;                                         // don't print stream list and progress bar
+
+    // Constructor
+    Parameter() = default;
+
+    // Constructor (Parse Command Line Arguments)
+    Parameter( int argc, char* argv[] );
+
+private:
+    // Parse Value of Each Image Stream ("value" for all streams, or "stream:value,...")
+    // Return values of color, depth and infrared.
+    static std::map<std::string, std::string> parseStreamValues( const std::string& value );
+
+    // Find Bag Files (Directory, Glob Pattern or List File)
+    static std::vector<filesystem::path> findBagFiles( const filesystem::path& input );
+};
+
+#endif // __PARAMETER__
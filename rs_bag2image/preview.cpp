@@ -0,0 +1,106 @@
+#include "preview.h"
+#include "trace.h"
+
+#include <chrono>
+
+// Constructor
+Preview::Preview()
+{
+    #ifndef __APPLE__
+    thread = std::thread( &Preview::work, this );
+    #endif
+}
+
+// Destructor
+Preview::~Preview()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        stopped = true;
+    }
+    condition.notify_all();
+
+    if( thread.joinable() ){
+        thread.join();
+    }
+    else{
+        cv::destroyAllWindows();
+    }
+}
+
+// Update Image of Window (Replace Pending Image)
+void Preview::update( const std::string& name, const cv::Mat& mat, const rs2::frame& frame )
+{
+    // Show Synchronously (Main Thread)
+    if( !thread.joinable() ){
+        std::map<std::string, Image> pending = { { name, { mat, frame } } };
+        render( pending );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        images[name] = { mat, frame };
+    }
+    condition.notify_one();
+}
+
+// Check Quit Key ('q') was Pressed
+bool Preview::isQuit() const
+{
+    return quit;
+}
+
+// Preview Thread
+void Preview::work()
+{
+    Profiler::instance().setThreadName( "preview" );
+
+    while( true ){
+        // Wait for Latest Images (Timeout to Keep Windows Responsive)
+        std::map<std::string, Image> pending;
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            condition.wait_for( lock, std::chrono::milliseconds( 30 ), [this]{ return stopped || !images.empty(); } );
+            if( stopped ){
+                break;
+            }
+            pending.swap( images );
+        }
+
+        // Show Images
+        render( pending );
+    }
+
+    // Close Windows
+    cv::destroyAllWindows();
+}
+
+// Show Images and Check Key
+inline void Preview::render( std::map<std::string, Image>& pending )
+{
+    TRACE_SCOPE( "preview/render" );
+
+    for( std::pair<const std::string, Image>& image : pending ){
+        if( image.second.mat.empty() ){
+            continue;
+        }
+
+        // Scaling
+        cv::Mat mat = image.second.mat;
+        if( mat.depth() == CV_16U ){
+            cv::Mat scale_mat;
+            mat.convertTo( scale_mat, CV_8U, -255.0 / 10000.0, 255.0 ); // 0-10000 -> 255(white)-0(black)
+            mat = scale_mat;
+        }
+
+        // Show Image
+        cv::imshow( image.first, mat );
+    }
+
+    // Key Check
+    const int32_t key = cv::waitKey( 1 );
+    if( key == 'q' ){
+        quit = true;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef __PREVIEW__
+#define __PREVIEW__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Preview Window
+// Shows images on its own thread. Only the latest image of each window is shown and older ones are dropped,
+// so previewing never blocks extraction. 16bit images are scaled for visualization (0-10000 -> 255-0).
+// HighGUI must run on the main thread on macOS, so images are shown synchronously there.
+class Preview
+{
+private:
+    // Latest Image
+    struct Image
+    {
+        cv::Mat mat;
+        rs2::frame frame; // source frame that mat refers to
+    };
+
+    std::map<std::string, Image> images;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    std::thread thread;
+    bool stopped = false;
+    std::atomic<bool> quit{ false };
+
+public:
+    // Constructor
+    Preview();
+
+    // Destructor
+    ~Preview();
+
+    // Update Image of Window (Replace Pending Image)
+    void update( const std::string& name, const cv::Mat& mat, const rs2::frame& frame = rs2::frame() );
+
+    // Check Quit Key ('q') was Pressed
+    bool isQuit() const;
+
+private:
+    // Preview Thread
+    void work();
+
+    // Show Images and Check Key
+    inline void render( std::map<std::string, Image>& pending );
+};
+
+#endif // __PREVIEW__
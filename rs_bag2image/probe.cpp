@@ -0,0 +1,385 @@
+#include "probe.h"
+#include "colorize.h"
+#include "convert.h"
+#include "imu.h"
+#include "reader.h"
+#include "version.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    // Escape String of JSON
+    std::string escape( const std::string& value )
+    {
+        std::string escaped;
+        for( const char c : value ){
+            switch( c ){
+                case '"':  escaped += "\\\""; break;
+                case '\\': escaped += "\\\\"; break;
+                case '\n': escaped += "\\n";  break;
+                case '\t': escaped += "\\t";  break;
+                default:   escaped += c;      break;
+            }
+        }
+        return escaped;
+    }
+
+    // Retrieve Percentile of Sorted Values (Nearest Rank)
+    double percentile( const std::vector<double>& sorted, double p )
+    {
+        if( sorted.empty() ){
+            return 0.0;
+        }
+        const std::size_t rank = static_cast<std::size_t>( std::ceil( p / 100.0 * sorted.size() ) );
+        return sorted[std::min( sorted.size(), std::max<std::size_t>( rank, 1 ) ) - 1];
+    }
+}
+
+// Constructor
+Probe::Probe( const Parameter& parameter )
+    : parameter( parameter )
+{
+}
+
+// Processing
+void Probe::run()
+{
+    std::ostringstream json;
+    json << std::fixed << std::setprecision( 6 );
+
+    // Single Bag File
+    if( parameter.bag_files.empty() ){
+        probe( parameter.bag_file, json );
+        std::cout << json.str() << std::endl;
+        return;
+    }
+
+    // Each Bag File of Batch Mode (Failed Bag File is Reported with Error, and Others Continue)
+    json << "[\n";
+    for( std::size_t i = 0; i < parameter.bag_files.size(); i++ ){
+        std::ostringstream report;
+        report << std::fixed << std::setprecision( 6 );
+        try{
+            probe( parameter.bag_files[i], report );
+        }
+        catch( const std::exception& ex ){
+            report.str( "" );
+            report << "{ \"bag\": \"" << escape( parameter.bag_files[i].generic_string() ) << "\", \"error\": \"" << escape( ex.what() ) << "\" }";
+        }
+        json << report.str() << ( ( i + 1 < parameter.bag_files.size() ) ? ",\n" : "\n" );
+    }
+    json << "]";
+    std::cout << json.str() << std::endl;
+}
+
+// Probe Bag File and Write Report
+inline void Probe::probe( const filesystem::path& bag_file, std::ostream& json )
+{
+    // Scan Frame Headers
+    // Imu streams are read in framesets even if imu is lossless, so that their statistics are reported as well.
+    // Output of lossless imu is counted separately, because the syncer of framesets drops motion samples.
+    Parameter parameter = this->parameter;
+    parameter.bag_file = bag_file;
+    parameter.bag_files.clear();
+    parameter.imu_lossless = false;
+    parameter.quiet = true;
+
+    std::map<StreamKey, Stream> streams;
+    uint64_t start_position = 0;
+    uint64_t end_position = 0;
+    uint64_t duration = 0;
+    float depth_scale = 0.0f;
+    const double read_seconds = scan( parameter, streams, start_position, end_position, duration, depth_scale );
+
+    // Count Motion Samples that Lossless IMU Extraction Writes (Read by ImuReader as Extraction does)
+    if( this->parameter.imu_lossless ){
+        std::vector<rs2_stream> motion_streams;
+        for( const std::pair<const StreamKey, Stream>& stream : streams ){
+            if( stream.first.first == rs2_stream::RS2_STREAM_GYRO || stream.first.first == rs2_stream::RS2_STREAM_ACCEL ){
+                motion_streams.push_back( stream.first.first );
+            }
+        }
+        if( !motion_streams.empty() ){
+            ImuReader imu( bag_file, filesystem::path(), std::chrono::steady_clock::duration::zero(), motion_streams );
+            imu.start( start_position, ( end_position < duration ) ? end_position : 0 );
+            imu.join();
+            for( std::pair<const StreamKey, Stream>& stream : streams ){
+                if( stream.first.first == rs2_stream::RS2_STREAM_GYRO || stream.first.first == rs2_stream::RS2_STREAM_ACCEL ){
+                    stream.second.kept = imu.getSamples( stream.first.first );
+                }
+            }
+        }
+    }
+
+    // Measure Encoding Cost of Each Stream
+    for( std::pair<const StreamKey, Stream>& stream : streams ){
+        calibrate( stream.first, stream.second );
+    }
+
+    // Write Report
+    const double range_seconds = std::chrono::duration<double>( std::chrono::nanoseconds( end_position - start_position ) ).count();
+    json << "{\n";
+    json << "  \"version\": \"" << RS_BAG2IMAGE_VERSION << "\",\n";
+    json << "  \"bag\": \"" << escape( bag_file.generic_string() ) << "\",\n";
+    json << "  \"file_bytes\": " << filesystem::file_size( bag_file ) << ",\n";
+    json << "  \"duration\": " << std::chrono::duration<double>( std::chrono::nanoseconds( duration ) ).count() << ",\n";
+    json << "  \"range\": { \"start\": " << std::chrono::duration<double>( std::chrono::nanoseconds( start_position ) ).count() << ", \"end\": " << std::chrono::duration<double>( std::chrono::nanoseconds( end_position ) ).count() << " },\n";
+    json << "  \"depth_scale\": " << depth_scale << ",\n";
+    json << "  \"streams\": [\n";
+
+    double output_bytes = 0.0;
+    double convert_seconds = 0.0;
+    double encode_seconds = 0.0;
+    std::size_t i = 0;
+    for( const std::pair<const StreamKey, Stream>& element : streams ){
+        const Stream& stream = element.second;
+        const double fps = static_cast<double>( stream.profile.fps() );
+        const bool video = stream.profile.is<rs2::video_stream_profile>();
+
+        // Interval Statistics
+        std::vector<double> sorted = stream.intervals;
+        std::sort( sorted.begin(), sorted.end() );
+        double sum = 0.0;
+        for( const double interval : sorted ){
+            sum += interval;
+        }
+        const double mean = sorted.empty() ? 0.0 : sum / sorted.size();
+        double variance = 0.0;
+        for( const double interval : sorted ){
+            variance += ( interval - mean ) * ( interval - mean );
+        }
+        const double stddev = sorted.empty() ? 0.0 : std::sqrt( variance / sorted.size() );
+
+        // Output Estimate
+        const double bytes = stream.kept * ( stream.image_bytes + stream.csv_bytes );
+        output_bytes += bytes;
+        convert_seconds += stream.kept * stream.convert_milliseconds / 1000.0;
+        encode_seconds += stream.kept * stream.encode_milliseconds / 1000.0;
+
+        json << "    {\n";
+        json << "      \"name\": \"" << stream.name << "\",\n";
+        json << "      \"stream\": \"" << rs2_stream_to_string( element.first.first ) << "\",\n";
+        json << "      \"index\": " << element.first.second << ",\n";
+        json << "      \"format\": \"" << rs2_format_to_string( stream.profile.format() ) << "\",\n";
+        if( video ){
+            const rs2::video_stream_profile video_profile = stream.profile.as<rs2::video_stream_profile>();
+            json << "      \"width\": " << video_profile.width() << ",\n";
+            json << "      \"height\": " << video_profile.height() << ",\n";
+        }
+        json << "      \"fps\": " << stream.profile.fps() << ",\n";
+        json << "      \"frames\": " << stream.frames << ",\n";
+        json << "      \"expected_frames\": " << static_cast<uint64_t>( std::llround( range_seconds * fps ) ) << ",\n";
+        json << "      \"repeated\": " << stream.repeated << ",\n";
+        json << "      \"gaps\": " << stream.gaps << ",\n";
+        json << "      \"dropped\": " << stream.dropped << ",\n";
+        json << "      \"frame_number\": { \"first\": " << stream.first_frame_number << ", \"last\": " << stream.last_frame_number << ", \"skipped\": " << stream.skipped << " },\n";
+        json << "      \"timestamp\": { \"first\": " << stream.first_timestamp << ", \"last\": " << stream.last_timestamp << " },\n";
+        json << "      \"interval\": { \"count\": " << sorted.size() << ", \"mean\": " << mean << ", \"stddev\": " << stddev
+             << ", \"min\": " << ( sorted.empty() ? 0.0 : sorted.front() ) << ", \"p50\": " << percentile( sorted, 50.0 ) << ", \"p95\": " << percentile( sorted, 95.0 )
+             << ", \"p99\": " << percentile( sorted, 99.0 ) << ", \"max\": " << ( sorted.empty() ? 0.0 : sorted.back() ) << " },\n";
+        json << "      \"output\": { \"frames\": " << stream.kept << ", \"samples\": " << stream.images.size()
+             << ", \"convert_ms_per_frame\": " << stream.convert_milliseconds << ", \"encode_ms_per_frame\": " << stream.encode_milliseconds
+             << ", \"bytes_per_frame\": " << stream.image_bytes + stream.csv_bytes << ", \"bytes\": " << static_cast<uint64_t>( bytes ) << " }\n";
+        json << "    }" << ( ( ++i < streams.size() ) ? "," : "" ) << "\n";
+    }
+    json << "  ],\n";
+
+    // Time Estimate
+    // Reading and conversion run on the reading thread, and encoding runs on it (serial) or overlaps on encoder threads (pipelined).
+    const double serial_seconds = read_seconds + convert_seconds;
+    const double seconds = ( parameter.jobs == 0 ) ? serial_seconds + encode_seconds : std::max( serial_seconds, encode_seconds / parameter.jobs );
+    json << "  \"estimate\": { \"output_bytes\": " << static_cast<uint64_t>( output_bytes ) << ", \"read_seconds\": " << read_seconds
+         << ", \"convert_seconds\": " << convert_seconds << ", \"encode_seconds\": " << encode_seconds << ", \"jobs\": " << parameter.jobs
+         << ", \"seconds\": " << seconds << " }\n";
+    json << "}";
+}
+
+// Scan Frame Headers of Bag File
+inline double Probe::scan( const Parameter& parameter, std::map<StreamKey, Stream>& streams, uint64_t& start_position, uint64_t& end_position, uint64_t& duration, float& depth_scale )
+{
+    // Open Bag File with Selected Streams in Extraction Range
+    BagReader reader( parameter );
+    start_position = reader.getStartPosition();
+    end_position = reader.getEndPosition();
+    duration = reader.getDuration();
+    depth_scale = reader.getDepthScale();
+
+    // Initialize Depth Visualization (Scaling)
+    DepthColorizer depth_colorizer;
+    depth_colorizer.setRange( parameter.depth_near, parameter.depth_far );
+    depth_colorizer.setInverse( parameter.depth_inverse );
+    depth_colorizer.setColormap( parameter.depth_colormap );
+    depth_colorizer.setDepthScale( depth_scale );
+
+    // Initialize Streams
+    // Calibration samples are spread over the expected frames of each stream.
+    const double range_seconds = std::chrono::duration<double>( std::chrono::nanoseconds( end_position - start_position ) ).count();
+    std::map<StreamKey, uint64_t> sample_strides;
+    for( const rs2::stream_profile& stream_profile : reader.getStreams() ){
+        const StreamKey key( stream_profile.stream_type(), stream_profile.stream_index() );
+        Stream& stream = streams[key];
+        stream.profile = stream_profile;
+        stream.name = getStreamName( stream_profile.stream_type(), stream_profile.stream_index() );
+        const uint64_t expected = static_cast<uint64_t>( range_seconds * stream_profile.fps() / std::max<uint32_t>( 1, parameter.frame_step ) );
+        sample_strides[key] = std::max<uint64_t>( 1, expected / parameter.autotune_samples );
+    }
+
+    // Initialize Temporal Subsampling (Same Rule as Extraction)
+    TemporalSampler sampler( parameter.frame_step, parameter.target_fps, reader.getStreams() );
+
+    // Read All Framesets
+    double calibration_seconds = 0.0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    rs2::frameset frameset;
+    while( reader.read( frameset ) ){
+        const bool sampled = sampler.isKept( frameset );
+        #if 29 < RS2_API_MINOR_VERSION
+        frameset.foreach_rs( [&]( const rs2::frame& frame ){
+        #else
+        frameset.foreach( [&]( const rs2::frame& frame ){
+        #endif
+            const rs2::stream_profile stream_profile = frame.get_profile();
+            const StreamKey key( stream_profile.stream_type(), stream_profile.stream_index() );
+            const std::map<StreamKey, Stream>::iterator found = streams.find( key );
+            if( found == streams.end() ){
+                return;
+            }
+
+            Stream& stream = found->second;
+            if( !update( stream, frame, sampled ) ){
+                return;
+            }
+
+            // Imu Row of CSV (frame_number,timestamp,x,y,z)
+            if( frame.is<rs2::motion_frame>() ){
+                if( stream.csv_bytes == 0.0 ){
+                    const rs2_vector data = frame.as<rs2::motion_frame>().get_motion_data();
+                    std::ostringstream row;
+                    row << std::fixed << std::setprecision( 6 ) << frame.get_frame_number() << "," << frame.get_timestamp() << "," << data.x << "," << data.y << "," << data.z << "\n";
+                    stream.csv_bytes = static_cast<double>( row.str().size() );
+                }
+                return;
+            }
+
+            // Convert Calibration Sample
+            if( !frame.is<rs2::video_frame>() || stream.images.size() >= parameter.autotune_samples || ( stream.kept - 1 ) % sample_strides[key] != 0 ){
+                return;
+            }
+            const ConvertKernel convert = getConvertKernel( stream_profile.format() );
+            if( convert == nullptr ){
+                return;
+            }
+
+            const std::chrono::steady_clock::time_point convert_start = std::chrono::steady_clock::now();
+            const rs2::video_frame video_frame = frame.as<rs2::video_frame>();
+            const bool depth = ( key.first == rs2_stream::RS2_STREAM_DEPTH );
+            const FrameTransform& transform = depth ? parameter.depth_transform : ( key.first == rs2_stream::RS2_STREAM_COLOR ) ? parameter.color_transform : parameter.infrared_transform;
+            const bool pooling = ( stream_profile.format() == rs2_format::RS2_FORMAT_Z16 );
+            cv::Mat image;
+            convertFrame( convert, frame.get_data(), video_frame.get_width(), video_frame.get_height(), video_frame.get_stride_in_bytes(), video_frame.get_bytes_per_pixel(), transform, pooling, image );
+            if( depth && parameter.scaling && parameter.depth_stack.empty() && image.depth() == CV_16U ){
+                cv::Mat visual;
+                depth_colorizer.colorize( image, visual );
+                image = visual;
+            }
+            const double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - convert_start ).count();
+            stream.convert_milliseconds += milliseconds;
+            calibration_seconds += milliseconds / 1000.0;
+
+            // Copy Image (Image may Refer to Frame Buffer)
+            stream.images.push_back( image.clone() );
+
+            // Metadata Row of CSV (frame_number,timestamp,width,height,format)
+            std::ostringstream row;
+            row << std::fixed << std::setprecision( 6 ) << frame.get_frame_number() << "," << frame.get_timestamp() << "," << image.cols << "," << image.rows << "," << rs2_format_to_string( stream_profile.format() ) << "\n";
+            stream.csv_bytes += static_cast<double>( row.str().size() );
+        } );
+    }
+
+    // Reading Time without Calibration
+    return std::max( 0.0, std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() - calibration_seconds );
+}
+
+// Update Statistics with Frame
+inline bool Probe::update( Stream& stream, const rs2::frame& frame, bool sampled )
+{
+    // Skip Frame Repeated by Syncer (or Replayed from Beginning)
+    const unsigned long long frame_number = frame.get_frame_number();
+    const double timestamp = frame.get_timestamp();
+    if( stream.frames > 0 && timestamp <= stream.last_timestamp ){
+        stream.repeated++;
+        return false;
+    }
+
+    // Interval, Gap and Frame Number
+    if( stream.frames == 0 ){
+        stream.first_frame_number = frame_number;
+        stream.first_timestamp = timestamp;
+    }
+    else{
+        const double interval = timestamp - stream.last_timestamp;
+        stream.intervals.push_back( interval );
+
+        const int32_t fps = stream.profile.fps();
+        if( fps > 0 ){
+            const double period = 1000.0 / fps;
+            if( interval > period * 1.5 ){
+                stream.gaps++;
+                stream.dropped += static_cast<uint64_t>( std::max( 0LL, std::llround( interval / period ) - 1 ) );
+            }
+        }
+        if( frame_number > stream.last_frame_number + 1 ){
+            stream.skipped += frame_number - stream.last_frame_number - 1;
+        }
+    }
+    stream.frames++;
+    stream.last_frame_number = frame_number;
+    stream.last_timestamp = timestamp;
+
+    // Temporal Subsampling of Image Streams (Same Rule as Extraction)
+    if( frame.is<rs2::video_frame>() && !sampled ){
+        return false;
+    }
+
+    stream.kept++;
+    return true;
+}
+
+// Measure Encoding Cost of Calibration Samples
+inline void Probe::calibrate( const StreamKey& key, Stream& stream )
+{
+    if( stream.images.empty() ){
+        return;
+    }
+
+    const double count = static_cast<double>( stream.images.size() );
+    stream.convert_milliseconds /= count;
+    stream.csv_bytes /= count;
+
+    // Raw Depth Stack (Not Encoded)
+    if( key.first == rs2_stream::RS2_STREAM_DEPTH && !parameter.depth_stack.empty() ){
+        const cv::Mat& image = stream.images.front();
+        stream.image_bytes = static_cast<double>( image.total() * image.elemSize() );
+        return;
+    }
+
+    // Encode Samples with Encoder Profile of Stream
+    const EncoderProfile& profile = ( key.first == rs2_stream::RS2_STREAM_COLOR ) ? parameter.color_profile : ( key.first == rs2_stream::RS2_STREAM_DEPTH ) ? parameter.depth_profile : parameter.infrared_profile;
+    std::vector<uint8_t> buffer;
+    double bytes = 0.0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for( const cv::Mat& image : stream.images ){
+        if( !cv::imencode( profile.extension(), image, buffer, profile.params ) ){
+            throw std::runtime_error( "failed can't encode " + stream.name + " with " + profile.description );
+        }
+        bytes += static_cast<double>( buffer.size() );
+    }
+    stream.encode_milliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / count;
+    stream.image_bytes = bytes / count;
+}
@@ -0,0 +1,75 @@
+#ifndef __PROBE__
+#define __PROBE__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "parameter.h"
+
+// Bag Probe
+// Reads frame headers (frame number and timestamp) of selected streams in extraction range without converting or encoding,
+// and reports streams, frame interval statistics, gaps and an estimate of output size and conversion time as JSON.
+// The estimate is calibrated by converting and encoding a few sample frames of each image stream
+// with the configured transform and encoder profile, so it follows the content of the bag file.
+class Probe
+{
+private:
+    // Statistics of Stream
+    struct Stream
+    {
+        rs2::stream_profile profile;
+        std::string name;
+        uint64_t frames = 0;                // unique frames
+        uint64_t repeated = 0;              // frames repeated by syncer (same or older timestamp)
+        uint64_t kept = 0;                  // frames kept by temporal subsampling (written)
+        uint64_t gaps = 0;                  // intervals longer than 1.5 frame intervals of fps
+        uint64_t dropped = 0;               // frames missing in gaps
+        uint64_t skipped = 0;               // frame numbers missing between frames
+        unsigned long long first_frame_number = 0;
+        unsigned long long last_frame_number = 0;
+        double first_timestamp = 0.0;       // ms
+        double last_timestamp = 0.0;        // ms
+        std::vector<double> intervals;      // ms
+
+        // Calibration Samples (Converted Images) and Cost per Frame
+        std::vector<cv::Mat> images;
+        double convert_milliseconds = 0.0;
+        double encode_milliseconds = 0.0;
+        double image_bytes = 0.0;
+        double csv_bytes = 0.0;
+    };
+
+    Parameter parameter;
+
+public:
+    // Constructor
+    explicit Probe( const Parameter& parameter );
+
+    // Processing
+    // Write report of bag file (object), or of each bag file of batch mode (array) to standard output.
+    void run();
+
+private:
+    // Probe Bag File and Write Report
+    inline void probe( const filesystem::path& bag_file, std::ostream& json );
+
+    // Scan Frame Headers of Bag File
+    // Return seconds of reading.
+    inline double scan( const Parameter& parameter, std::map<StreamKey, Stream>& streams, uint64_t& start_position, uint64_t& end_position, uint64_t& duration, float& depth_scale );
+
+    // Update Statistics with Frame
+    // Return true if the frame is new and kept by temporal subsampling (decision of frameset).
+    inline bool update( Stream& stream, const rs2::frame& frame, bool sampled );
+
+    // Measure Encoding Cost of Calibration Samples
+    inline void calibrate( const StreamKey& key, Stream& stream );
+};
+
+#endif // __PROBE__
@@ -0,0 +1,141 @@
+#include "profile.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    // Lower Case
+    std::string toLower( std::string value )
+    {
+        std::transform( value.begin(), value.end(), value.begin(), []( unsigned char c ){ return static_cast<char>( std::tolower( c ) ); } );
+        return value;
+    }
+
+    // Parse Integer Value of Option in Range
+    int32_t toInteger( const std::string& key, const std::string& value, int32_t min, int32_t max )
+    {
+        try{
+            std::size_t length = 0;
+            const int32_t number = std::stoi( value, &length );
+            if( length == value.size() && min <= number && number <= max ){
+                return number;
+            }
+        }
+        catch( ... ){
+        }
+        throw std::runtime_error( "failed invalid encoder profile value " + key + "=" + value );
+    }
+}
+
+// Parse Profile String
+EncoderProfile EncoderProfile::parse( const std::string& profile )
+{
+    EncoderProfile encoder_profile;
+
+    // Codec
+    const std::size_t separator = profile.find( ':' );
+    encoder_profile.codec = toLower( profile.substr( 0, separator ) );
+    if( encoder_profile.codec == "jpeg" ){
+        encoder_profile.codec = "jpg";
+    }
+    if( encoder_profile.codec == "tif" ){
+        encoder_profile.codec = "tiff";
+    }
+    if( encoder_profile.codec != "png" && encoder_profile.codec != "jpg" && encoder_profile.codec != "webp" && encoder_profile.codec != "tiff" ){
+        throw std::runtime_error( "failed unknown encoder codec " + encoder_profile.codec );
+    }
+
+    // Options (key=value,...)
+    std::map<std::string, std::string> options;
+    if( separator != std::string::npos ){
+        std::istringstream iss( profile.substr( separator + 1 ) );
+        std::string option;
+        while( std::getline( iss, option, ',' ) ){
+            const std::size_t equal = option.find( '=' );
+            if( equal == std::string::npos ){
+                throw std::runtime_error( "failed invalid encoder profile option " + option );
+            }
+            options[toLower( option.substr( 0, equal ) )] = toLower( option.substr( equal + 1 ) );
+        }
+    }
+
+    // Codec Parameters
+    std::ostringstream description;
+    description << encoder_profile.codec;
+    char delimiter = ':';
+    const auto add = [&]( int32_t param, int32_t value, const std::string& key, const std::string& text ){
+        encoder_profile.params.push_back( param );
+        encoder_profile.params.push_back( value );
+        description << delimiter << key << "=" << text;
+        delimiter = ',';
+    };
+
+    for( const std::pair<const std::string, std::string>& option : options ){
+        const std::string& key = option.first;
+        const std::string& value = option.second;
+        if( encoder_profile.codec == "png" && key == "level" ){
+            add( cv::IMWRITE_PNG_COMPRESSION, toInteger( key, value, 0, 9 ), key, value );
+        }
+        else if( encoder_profile.codec == "png" && key == "strategy" ){
+            const std::map<std::string, int32_t> strategies = {
+                { "default", cv::IMWRITE_PNG_STRATEGY_DEFAULT }, { "filtered", cv::IMWRITE_PNG_STRATEGY_FILTERED },
+                { "huffman", cv::IMWRITE_PNG_STRATEGY_HUFFMAN_ONLY }, { "rle", cv::IMWRITE_PNG_STRATEGY_RLE }, { "fixed", cv::IMWRITE_PNG_STRATEGY_FIXED }
+            };
+            const std::map<std::string, int32_t>::const_iterator strategy = strategies.find( value );
+            if( strategy == strategies.end() ){
+                throw std::runtime_error( "failed unknown png strategy " + value );
+            }
+            add( cv::IMWRITE_PNG_STRATEGY, strategy->second, key, value );
+        }
+        else if( encoder_profile.codec == "jpg" && key == "quality" ){
+            add( cv::IMWRITE_JPEG_QUALITY, toInteger( key, value, 0, 100 ), key, value );
+        }
+        else if( encoder_profile.codec == "jpg" && key == "progressive" ){
+            add( cv::IMWRITE_JPEG_PROGRESSIVE, toInteger( key, value, 0, 1 ), key, value );
+        }
+        else if( encoder_profile.codec == "jpg" && key == "optimize" ){
+            add( cv::IMWRITE_JPEG_OPTIMIZE, toInteger( key, value, 0, 1 ), key, value );
+        }
+        else if( encoder_profile.codec == "webp" && key == "quality" ){
+            add( cv::IMWRITE_WEBP_QUALITY, toInteger( key, value, 1, 101 ), key, value );
+        }
+        else if( encoder_profile.codec == "tiff" && key == "compression" ){
+            // libtiff Compression Scheme
+            const std::map<std::string, int32_t> compressions = { { "none", 1 }, { "lzw", 5 }, { "deflate", 8 } };
+            const std::map<std::string, int32_t>::const_iterator compression = compressions.find( value );
+            if( compression == compressions.end() ){
+                throw std::runtime_error( "failed unknown tiff compression " + value );
+            }
+            add( cv::IMWRITE_TIFF_COMPRESSION, compression->second, key, value );
+        }
+        else{
+            throw std::runtime_error( "failed unknown " + encoder_profile.codec + " option " + key );
+        }
+    }
+
+    // WebP is Lossless by Default
+    if( encoder_profile.codec == "webp" && !options.count( "quality" ) ){
+        add( cv::IMWRITE_WEBP_QUALITY, 101, "quality", "101" );
+    }
+
+    encoder_profile.description = description.str();
+    return encoder_profile;
+}
+
+// Retrieve File Extension (with Dot)
+std::string EncoderProfile::extension() const
+{
+    return "." + codec;
+}
+
+// Check Codec Supports 16bit Image
+bool EncoderProfile::supports16bit() const
+{
+    return codec == "png" || codec == "tiff";
+}
@@ -0,0 +1,30 @@
+#ifndef __PROFILE__
+#define __PROFILE__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Encoder Profile
+// Codec and imwrite parameters of one stream, parsed from "codec[:key=value,...]".
+//   png  : level=[0-9], strategy=default|filtered|huffman|rle|fixed
+//   jpg  : quality=[0-100], progressive=[0|1], optimize=[0|1]
+//   webp : quality=[1-100], 101 is lossless (default)
+//   tiff : compression=none|lzw|deflate
+struct EncoderProfile
+{
+    std::string codec;              // png, jpg, webp or tiff
+    std::vector<int32_t> params;    // imwrite parameters
+    std::string description;        // normalized profile string
+
+    // Parse Profile String
+    static EncoderProfile parse( const std::string& profile );
+
+    // Retrieve File Extension (with Dot)
+    std::string extension() const;
+
+    // Check Codec Supports 16bit Image
+    bool supports16bit() const;
+};
+
+#endif // __PROFILE__
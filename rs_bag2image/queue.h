@@ -0,0 +1,98 @@
+#ifndef __QUEUE__
+#define __QUEUE__
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// Bounded Blocking Queue
+// push() blocks while the queue is full, so a fast producer is throttled by its consumers (backpressure).
+template<typename T>
+class BoundedQueue
+{
+private:
+    std::deque<T> queue;
+    std::size_t capacity;
+    bool closed = false;
+
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+
+public:
+    // Constructor
+    explicit BoundedQueue( std::size_t capacity )
+        : capacity( capacity == 0 ? 1 : capacity )
+    {
+    }
+
+    // Push Item (Block while Full)
+    // Return false if the queue has been closed.
+    bool push( T item )
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        not_full.wait( lock, [this]{ return closed || queue.size() < capacity; } );
+        if( closed ){
+            return false;
+        }
+
+        queue.push_back( std::move( item ) );
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Pop Item (Block while Empty)
+    // Return false if the queue has been closed and drained.
+    bool pop( T& item )
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        not_empty.wait( lock, [this]{ return closed || !queue.empty(); } );
+        if( queue.empty() ){
+            return false;
+        }
+
+        item = std::move( queue.front() );
+        queue.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return true;
+    }
+
+    // Pop Item (Never Block)
+    // Return false if the queue is empty.
+    bool tryPop( T& item )
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        if( queue.empty() ){
+            return false;
+        }
+
+        item = std::move( queue.front() );
+        queue.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return true;
+    }
+
+    // Close Queue
+    // Remaining items are still delivered to pop(), new items are rejected.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            closed = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    // Retrieve Capacity
+    std::size_t getCapacity() const
+    {
+        return capacity;
+    }
+};
+
+#endif // __QUEUE__
@@ -0,0 +1,29 @@
+#include "ray.h"
+
+#include <librealsense2/rsutil.h>
+
+// Constructor
+RayTable::RayTable( const rs2_intrinsics& intrinsics, float offset )
+    : rays( static_cast<std::size_t>( intrinsics.width ) * intrinsics.height ), width( intrinsics.width ), height( intrinsics.height )
+{
+    for( int32_t y = 0; y < height; y++ ){
+        for( int32_t x = 0; x < width; x++ ){
+            const float pixel[2] = { x + offset, y + offset };
+            float point[3];
+            rs2_deproject_pixel_to_point( point, &intrinsics, pixel, 1.0f );
+            rays[static_cast<std::size_t>( y ) * width + x] = { point[0], point[1] };
+        }
+    }
+}
+
+// Retrieve Width
+int32_t RayTable::getWidth() const
+{
+    return width;
+}
+
+// Retrieve Height
+int32_t RayTable::getHeight() const
+{
+    return height;
+}
@@ -0,0 +1,48 @@
+#ifndef __RAY__
+#define __RAY__
+
+#include <librealsense2/rs.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ray Table
+// Deprojection of each pixel through intrinsics (including distortion) at depth 1.0.
+// The point of pixel i at depth z is ( rays[i].x * z, rays[i].y * z, z ), so deprojection of a frame costs
+// one multiply per coordinate instead of undistortion per pixel. The table depends only on the stream profile.
+class RayTable
+{
+public:
+    // Ray (Point at Depth 1.0)
+    struct Ray
+    {
+        float x;
+        float y;
+    };
+
+private:
+    std::vector<Ray> rays;
+    int32_t width = 0;
+    int32_t height = 0;
+
+public:
+    // Constructor
+    RayTable() = default;
+
+    // Constructor
+    // Offset is added to pixel coordinates (e.g. -0.5 is top-left corner of each pixel).
+    explicit RayTable( const rs2_intrinsics& intrinsics, float offset = 0.0f );
+
+    // Retrieve Ray of Pixel Index (y * width + x)
+    const Ray& operator[]( std::size_t index ) const{ return rays[index]; }
+
+    // Retrieve Rays of Row
+    const Ray* row( int32_t y ) const{ return rays.data() + static_cast<std::size_t>( y ) * width; }
+
+    // Retrieve Size
+    int32_t getWidth() const;
+    int32_t getHeight() const;
+};
+
+#endif // __RAY__
@@ -0,0 +1,405 @@
+#include "reader.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Constructor
+BagReader::BagReader( const Parameter& parameter )
+    : selected_streams( parameter.selected_streams ), imu_lossless( parameter.imu_lossless )
+{
+    // Initialize Sensor
+    initializeSensor( parameter );
+}
+
+// Destructor
+BagReader::~BagReader()
+{
+    // Stop Pipeline
+    if( !native ){
+        pipeline.stop();
+    }
+}
+
+// Initialize Sensor
+inline void BagReader::initializeSensor( const Parameter& parameter )
+{
+    // Retrieve Each Streams that contain in File
+    // Streams that are not selected are never enabled, so they cost nothing to decode or sync.
+    rs2::config config;
+    rs2::context context;
+    const rs2::playback playback = context.load_device( parameter.bag_file.string() );
+    const std::vector<rs2::sensor> sensors = playback.query_sensors();
+    std::vector<rs2::stream_profile> motion_profiles;
+    std::vector<rs2::stream_profile> enabled_profiles;
+    double reference_fps = 0.0;
+    uint32_t enabled_streams = 0;
+    for( const rs2::sensor& sensor : sensors ){
+        const std::vector<rs2::stream_profile> stream_profiles = sensor.get_stream_profiles();
+        for( const rs2::stream_profile& stream_profile : stream_profiles ){
+            const rs2_stream stream_type = stream_profile.stream_type();
+            if( !isSelectedStream( stream_type, stream_profile.stream_index() ) ){
+                continue;
+            }
+
+            // Motion Streams are Read by IMU Reader in Lossless Mode
+            if( imu_lossless && ( stream_type == rs2_stream::RS2_STREAM_GYRO || stream_type == rs2_stream::RS2_STREAM_ACCEL ) ){
+                motion_profiles.push_back( stream_profile );
+                continue;
+            }
+
+            // Frame Rate of Reference Stream for Frame Range (Color, or Other Video Stream)
+            if( stream_profile.is<rs2::video_stream_profile>() && ( stream_type == rs2_stream::RS2_STREAM_COLOR || reference_fps == 0.0 ) ){
+                reference_fps = stream_profile.fps();
+            }
+
+            config.enable_stream( stream_type, stream_profile.stream_index() );
+            enabled_profiles.push_back( stream_profile );
+            enabled_streams++;
+        }
+    }
+
+    // Enable Motion Streams to Drive Pipeline if No Other Stream is Selected (Samples are Ignored)
+    if( enabled_streams == 0 ){
+        for( const rs2::stream_profile& stream_profile : motion_profiles ){
+            config.enable_stream( stream_profile.stream_type(), stream_profile.stream_index() );
+            enabled_profiles.push_back( stream_profile );
+            enabled_streams++;
+        }
+    }
+
+    if( enabled_streams == 0 ){
+        throw std::runtime_error( "failed can't find selected streams in bag file" );
+    }
+
+    // Open Native Reader with Streams of Playback Device (Pipeline is not Started)
+    if( parameter.native ){
+        native = std::make_unique<NativeReader>( parameter.bag_file, playback, enabled_profiles );
+        total_duration = playback.get_duration().count();
+    }
+    else{
+        // Start Pipeline
+        config.enable_device_from_file( playback.file_name() );
+        pipeline_profile = pipeline.start( config );
+
+        // Set Non Real Time Playback
+        pipeline_profile.get_device().as<rs2::playback>().set_real_time( false );
+
+        // Get Total Duration
+        total_duration = pipeline_profile.get_device().as<rs2::playback>().get_duration().count();
+    }
+
+    // Convert Frame Range to Time Range with Frame Rate of Reference Stream
+    double start_time = parameter.start_time;
+    double end_time = parameter.end_time;
+    if( parameter.first_frame >= 0 || parameter.last_frame >= 0 ){
+        if( reference_fps == 0.0 ){
+            throw std::runtime_error( "failed can't find video stream for frame range" );
+        }
+        start_time = ( parameter.first_frame >= 0 ) ? parameter.first_frame / reference_fps : 0.0;
+        end_time = ( parameter.last_frame >= 0 ) ? ( parameter.last_frame + 1 ) / reference_fps : 0.0;
+    }
+
+    // Seek to Start Position (Skip Decoding before Extraction Range)
+    start_position = std::min<uint64_t>( static_cast<uint64_t>( start_time * 1e9 ), total_duration );
+    end_position = ( end_time > 0.0 ) ? std::min<uint64_t>( static_cast<uint64_t>( end_time * 1e9 ), total_duration ) : total_duration;
+    if( end_position <= start_position ){
+        throw std::runtime_error( "failed extraction range is empty" );
+    }
+    if( start_position != 0 ){
+        seek( start_position );
+    }
+    last_position = getPosition();
+}
+
+// Read Next Frameset
+// Playback of pipeline wraps around to the beginning at end of file. The frameset whose position goes backwards holds
+// the first frames of bag file again, so it is not returned, and each frame is read only once.
+bool BagReader::read( rs2::frameset& frameset )
+{
+    if( finished ){
+        return false;
+    }
+
+    {
+        TRACE_SCOPE( "wait_for_frames" );
+        if( native ){
+            // End of File (Native Reader doesn't Wrap around)
+            if( !native->read( frameset ) ){
+                finished = true;
+                return false;
+            }
+        }
+        else{
+            frameset = pipeline.wait_for_frames();
+        }
+    }
+
+    // End of Extraction Range
+    const uint64_t position = getPosition();
+    if( end_position < total_duration && position > end_position ){
+        finished = true;
+        return false;
+    }
+
+    // End of File (Playback Wrapped around to Beginning)
+    if( static_cast<int64_t>( position - last_position ) < 0 ){
+        finished = true;
+        return false;
+    }
+    last_position = position;
+
+    return true;
+}
+
+// Read Next Frame (Pull)
+bool BagReader::next( Frame& frame )
+{
+    // Release Previous Image (Buffer can be Reused)
+    frame = Frame();
+
+    // Read Next Frameset if All Frames of Current Frameset have been Returned
+    while( frame_index >= frames.size() ){
+        rs2::frameset frameset;
+        if( !read( frameset ) ){
+            frames.clear();
+            frame_index = 0;
+            return false;
+        }
+
+        frames.clear();
+        frame_index = 0;
+        #if 29 < RS2_API_MINOR_VERSION
+        frameset.foreach_rs( [this]( const rs2::frame& frame ){
+        #else
+        frameset.foreach( [this]( const rs2::frame& frame ){
+        #endif
+            frames.push_back( frame );
+        } );
+    }
+
+    // Decode Frame
+    decode( frames[frame_index++], frame );
+    return true;
+}
+
+// Read All Frames (Push)
+void BagReader::run( const std::function<bool( const Frame& )>& callback )
+{
+    Frame frame;
+    while( next( frame ) ){
+        if( !callback( frame ) ){
+            break;
+        }
+    }
+}
+
+// Decode Frame
+inline void BagReader::decode( const rs2::frame& source, Frame& frame )
+{
+    const rs2::stream_profile stream_profile = source.get_profile();
+    frame.frame = source;
+    frame.stream_type = stream_profile.stream_type();
+    frame.stream_index = stream_profile.stream_index();
+    frame.format = stream_profile.format();
+    frame.frame_number = source.get_frame_number();
+    frame.timestamp = source.get_timestamp();
+    frame.position = last_position;
+
+    // Motion Data
+    if( source.is<rs2::motion_frame>() ){
+        frame.motion = source.as<rs2::motion_frame>().get_motion_data();
+        return;
+    }
+
+    // Convert Video Frame (Image is Empty for Unsupported Format)
+    if( !source.is<rs2::video_frame>() ){
+        return;
+    }
+
+    const ConvertKernel convert = getConvertKernel( frame.format );
+    if( !convert ){
+        return;
+    }
+
+    TRACE_SCOPE( "convert" );
+    const rs2::video_frame video_frame = source.as<rs2::video_frame>();
+    cv::Mat& buffer = buffers[StreamKey( frame.stream_type, frame.stream_index )];
+    convert( video_frame.get_data(), video_frame.get_width(), video_frame.get_height(), video_frame.get_stride_in_bytes(), buffer );
+    frame.image = buffer;
+}
+
+// Seek to Playback Position [ns]
+void BagReader::seek( uint64_t position )
+{
+    if( native ){
+        native->seek( position );
+    }
+    else{
+        pipeline_profile.get_device().as<rs2::playback>().seek( std::chrono::nanoseconds( position ) );
+    }
+    last_position = position;
+}
+
+// Retrieve Playback Position [ns]
+uint64_t BagReader::getPosition() const
+{
+    if( native ){
+        return native->getPosition();
+    }
+
+    return pipeline_profile.get_device().as<rs2::playback>().get_position();
+}
+
+// Retrieve Start Position of Extraction Range [ns]
+uint64_t BagReader::getStartPosition() const
+{
+    return start_position;
+}
+
+// Retrieve End Position of Extraction Range [ns]
+uint64_t BagReader::getEndPosition() const
+{
+    return end_position;
+}
+
+// Retrieve Duration of Bag File [ns]
+uint64_t BagReader::getDuration() const
+{
+    return total_duration;
+}
+
+// Retrieve Enabled Streams
+std::vector<rs2::stream_profile> BagReader::getStreams() const
+{
+    if( native ){
+        return native->getStreams();
+    }
+
+    return pipeline_profile.get_streams();
+}
+
+// Retrieve Depth Scale from Depth Sensor [meters per unit]
+float BagReader::getDepthScale() const
+{
+    if( native ){
+        return native->getDepthScale();
+    }
+
+    try{
+        const rs2::depth_sensor depth_sensor = pipeline_profile.get_device().first<rs2::depth_sensor>();
+        return depth_sensor.get_depth_scale();
+    }
+    catch( const rs2::error& ){
+        return 0.0f;
+    }
+}
+
+// Check Stream is Selected for Extraction
+bool BagReader::isSelectedStream( rs2_stream stream_type, int32_t stream_index ) const
+{
+    if( selected_streams.empty() ){
+        return true;
+    }
+
+    switch( stream_type ){
+        case rs2_stream::RS2_STREAM_COLOR:
+            return selected_streams.count( "color" ) != 0;
+        case rs2_stream::RS2_STREAM_DEPTH:
+            return selected_streams.count( "depth" ) != 0;
+        case rs2_stream::RS2_STREAM_INFRARED:
+            return selected_streams.count( ( stream_index == 2 ) ? "ir_right" : "ir" ) != 0;
+        case rs2_stream::RS2_STREAM_GYRO:
+            return selected_streams.count( "gyro" ) != 0;
+        case rs2_stream::RS2_STREAM_ACCEL:
+            return selected_streams.count( "accel" ) != 0;
+        default:
+            return false;
+    }
+}
+
+// Constructor
+TemporalSampler::TemporalSampler( uint32_t frame_step, double target_fps, const std::vector<rs2::stream_profile>& streams )
+    : frame_step( std::max<uint32_t>( 1, frame_step ) ), frame_period( ( target_fps > 0.0 ) ? 1000.0 / target_fps : 0.0 )
+{
+    // Select Reference Stream (Depth, Color, Infrared in Order of Stream Index)
+    int32_t priority = 0;
+    for( const rs2::stream_profile& stream_profile : streams ){
+        const rs2_stream stream_type = stream_profile.stream_type();
+        const int32_t stream_index = stream_profile.stream_index();
+        const int32_t rank = ( stream_type == rs2_stream::RS2_STREAM_DEPTH ) ? 4 : ( stream_type == rs2_stream::RS2_STREAM_COLOR ) ? 3 : ( stream_type == rs2_stream::RS2_STREAM_INFRARED ) ? ( ( stream_index == 2 ) ? 1 : 2 ) : 0;
+        if( rank > priority ){
+            priority = rank;
+            reference = StreamKey( stream_type, stream_index );
+            reference_fps = stream_profile.fps();
+        }
+    }
+}
+
+// Check Subsampling is Enabled
+bool TemporalSampler::isEnabled() const
+{
+    return frame_step > 1 || frame_period > 0.0;
+}
+
+// Check Frameset is Kept
+bool TemporalSampler::isKept( const rs2::frameset& frameset )
+{
+    if( !isEnabled() ){
+        return true;
+    }
+
+    // Retrieve Reference Frame (Skip Frameset without New Reference Frame)
+    rs2::frame frame;
+    for( std::size_t i = 0; i < frameset.size(); i++ ){
+        const rs2::stream_profile stream_profile = frameset[i].get_profile();
+        if( StreamKey( stream_profile.stream_type(), stream_profile.stream_index() ) == reference ){
+            frame = frameset[i];
+            break;
+        }
+    }
+    if( !frame ){
+        return false;
+    }
+
+    const std::pair<unsigned long long, double> id( frame.get_frame_number(), frame.get_timestamp() );
+    if( id == last_frame ){
+        return false;
+    }
+    last_frame = id;
+
+    bool keep = ( id.first % frame_step == 0 );
+    if( keep && frame_period > 0.0 ){
+        const double timestamp = id.second;
+        const double last = ( has_previous ) ? previous : timestamp - frame_step * 1000.0 / std::max( 1, reference_fps );
+        keep = ( std::floor( last / frame_period ) < std::floor( timestamp / frame_period ) );
+        has_previous = true;
+        previous = timestamp;
+    }
+
+    return keep;
+}
+
+// Retrieve Frame Rate of Kept Frames from Frame Rate of Stream
+// Kept framesets follow the reference stream, so the rate is the subsampled rate of reference stream.
+double TemporalSampler::getFrameRate( double fps ) const
+{
+    if( !isEnabled() ){
+        return fps;
+    }
+
+    fps = static_cast<double>( std::max( 1, reference_fps ) ) / frame_step;
+    if( frame_period > 0.0 ){
+        fps = std::min( fps, 1000.0 / frame_period );
+    }
+    return fps;
+}
+
+// Retrieve Name of Stream
+std::string getStreamName( rs2_stream stream_type, int32_t stream_index )
+{
+    if( stream_type == rs2_stream::RS2_STREAM_INFRARED ){
+        return ( stream_index == 2 ) ? "IR_Right" : "IR";
+    }
+    return rs2_stream_to_string( stream_type );
+}
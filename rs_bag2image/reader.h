@@ -0,0 +1,165 @@
+#ifndef __READER__
+#define __READER__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "convert.h"
+#include "filesystem.h"
+#include "native.h"
+#include "parameter.h"
+
+// Bag Reader
+// Reads frames of selected streams in extraction range of bag file in process, without writing anything to disk.
+// Framesets are pulled with read(), or decoded frames are pulled with next() or pushed to a callback with run().
+// The extraction (RealSense class) is a client of this reader that writes the frames to files.
+// In native mode, messages are read by NativeReader instead of pipeline of playback device (see native.h).
+class BagReader
+{
+public:
+    // Decoded Frame
+    // The image refers to the frame buffer when no conversion is needed, otherwise to a buffer of the reader
+    // that is reused when the consumer has released it. The frame keeps the frame buffer alive.
+    struct Frame
+    {
+        rs2::frame frame;                   // refcounted source frame
+        rs2_stream stream_type = rs2_stream::RS2_STREAM_ANY;
+        int32_t stream_index = 0;
+        rs2_format format = rs2_format::RS2_FORMAT_ANY;
+        unsigned long long frame_number = 0;
+        double timestamp = 0.0;             // milliseconds
+        uint64_t position = 0;              // playback position [ns]
+        cv::Mat image;                      // BGR/BGRA/GRAY 8bit or 16bit depth (video streams of supported format)
+        rs2_vector motion = { 0.0f, 0.0f, 0.0f }; // gyro [rad/s] or accel [m/s^2] (motion streams)
+    };
+
+private:
+    // RealSense
+    rs2::pipeline pipeline;
+    rs2::pipeline_profile pipeline_profile;
+
+    // Native Reader (Native Mode)
+    std::unique_ptr<NativeReader> native;
+
+    // Stream Selection (Empty is All Streams)
+    std::set<std::string> selected_streams;
+    bool imu_lossless = false;
+
+    // Extraction Range (Playback Position in Nanoseconds)
+    uint64_t start_position = 0;
+    uint64_t end_position = 0;
+    uint64_t total_duration = 0;
+    uint64_t last_position = 0;
+    bool finished = false;
+
+    // Frames of Current Frameset (Frame Iterator)
+    std::vector<rs2::frame> frames;
+    std::size_t frame_index = 0;
+    std::map<StreamKey, cv::Mat> buffers;
+
+public:
+    // Constructor
+    // Open bag file with selected streams, and seek to start of extraction range.
+    // Motion streams are not opened in lossless imu mode (they are read by ImuReader) unless no other stream is selected.
+    explicit BagReader( const Parameter& parameter );
+
+    // Destructor
+    ~BagReader();
+
+    BagReader( const BagReader& ) = delete;
+    BagReader& operator=( const BagReader& ) = delete;
+
+    // Read Next Frameset
+    // Return false at end of extraction range or end of file.
+    bool read( rs2::frameset& frameset );
+
+    // Read Next Frame (Pull)
+    // Return false at end of extraction range or end of file.
+    bool next( Frame& frame );
+
+    // Read All Frames (Push)
+    // Stop when the callback returns false.
+    void run( const std::function<bool( const Frame& )>& callback );
+
+    // Seek to Playback Position [ns]
+    void seek( uint64_t position );
+
+    // Retrieve Playback Position [ns]
+    uint64_t getPosition() const;
+
+    // Retrieve Extraction Range [ns]
+    uint64_t getStartPosition() const;
+    uint64_t getEndPosition() const;
+
+    // Retrieve Duration of Bag File [ns]
+    uint64_t getDuration() const;
+
+    // Retrieve Enabled Streams
+    std::vector<rs2::stream_profile> getStreams() const;
+
+    // Retrieve Depth Scale from Depth Sensor [meters per unit]
+    // Return 0.0 if the device has no depth sensor.
+    float getDepthScale() const;
+
+    // Check Stream is Selected for Extraction
+    bool isSelectedStream( rs2_stream stream_type, int32_t stream_index ) const;
+
+private:
+    // Initialize Sensor
+    inline void initializeSensor( const Parameter& parameter );
+
+    // Decode Frame
+    inline void decode( const rs2::frame& source, Frame& frame );
+};
+
+// Temporal Sampler
+// Decides which framesets are kept by temporal subsampling (frame step and target frame rate), and the decision is applied
+// to every image stream of the frameset, so color, depth and infrared that are kept stay paired (e.g. for alignment).
+// The decision is made on the frame of a reference stream (depth, color, infrared in this order) and depends only on that frame,
+// so sharded and resumed extractions that start reading at other positions keep the same framesets as a plain extraction.
+// Framesets whose reference frame number is a multiple of frame step are kept, and of them, the first frameset of each period
+// of target frame rate (reference timestamp crosses a multiple of period) is kept. Framesets without a new reference frame are skipped.
+// The extraction (RealSense class) and the probe share this rule, so the estimate counts the frames that are written.
+class TemporalSampler
+{
+private:
+    uint32_t frame_step = 1;
+    double frame_period = 0.0;              // milliseconds, 0 is all frames
+
+    // Reference Stream and its Last Frame
+    StreamKey reference = StreamKey( rs2_stream::RS2_STREAM_ANY, 0 );
+    int32_t reference_fps = 0;
+    std::pair<unsigned long long, double> last_frame = { 0, -1.0 };   // frame number and timestamp of last reference frame
+    bool has_previous = false;
+    double previous = 0.0;                  // timestamp of previous reference frame that has passed frame step
+
+public:
+    // Constructor
+    // The reference stream is chosen from the enabled streams.
+    TemporalSampler() = default;
+    TemporalSampler( uint32_t frame_step, double target_fps, const std::vector<rs2::stream_profile>& streams );
+
+    // Check Subsampling is Enabled
+    bool isEnabled() const;
+
+    // Check Frameset is Kept
+    // The previous timestamp is taken as one frame interval before the first reference frame that has been read.
+    bool isKept( const rs2::frameset& frameset );
+
+    // Retrieve Frame Rate of Kept Frames from Frame Rate of Stream
+    double getFrameRate( double fps ) const;
+};
+
+// Retrieve Name of Stream
+// IR for left infrared (index 1), IR_Right for right infrared (index 2), otherwise name of stream type.
+std::string getStreamName( rs2_stream stream_type, int32_t stream_index );
+
+#endif // __READER__
@@ -1,18 +1,27 @@
 #include "realsense.h"
 #include "version.h"
 
+#include <algorithm>
+#include <cctype>
+#include <map>
 #include <sstream>
 #include <iomanip>
-#include <limits>
-#include <fstream>
 
 // Constructor
 RealSense::RealSense( int argc, char* argv[] )
+    : RealSense( Parameter( argc, argv ) )
 {
-    std::cout << "rs_bag2image " << RS_BAG2IMAGE_VERSION << std::endl;
+}
+
+// Constructor
+RealSense::RealSense( const Parameter& parameter, const std::shared_ptr<Encoder>& encoder )
+{
+    if( !parameter.quiet ){
+        std::cout << "rs_bag2image " << RS_BAG2IMAGE_VERSION << std::endl;
+    }
 
     // Initialize
-    initialize( argc, argv );
+    initialize( parameter, encoder );
 }
 
 // Destructor
@@ -25,13 +34,30 @@ RealSense::~RealSense()
 // Processing
 void RealSense::run()
 {
-    // Retrieve Last Position
-    uint64_t last_position = pipeline_profile.get_device().as<rs2::playback>().get_position();
+    // Previous Extraction has Already Finished
+    if( completed ){
+        if( !quiet ){
+            std::cout << "already completed " << directory.generic_string() << std::endl;
+        }
+        progress = 1.0;
+        return;
+    }
+
+    // Start IMU Reader
+    if( imu ){
+        imu->start( start_position, ( end_position < total_duration ) ? end_position : 0 );
+    }
 
     // Main Loop
+    bool complete = true;
     while( true ){
-        // Update Data
-        update();
+        // Update Data (End of Extraction Range or End of Position)
+        if( !update() ){
+            if( !quiet ){
+                std::cout << std::endl; // New line after progress bar
+            }
+            break;
+        }
 
         // Draw Data
         draw();
@@ -46,164 +72,510 @@ void RealSense::run()
 
         // Increment frame count and show progress
         frame_count++;
-        const uint64_t current_position = pipeline_profile.get_device().as<rs2::playback>().get_position();
+        const uint64_t current_position = reader->getPosition();
         showProgress( current_position );
 
-        // Key Check
-        const int32_t key = cv::waitKey( 1 );
-        if( key == 'q' ){
-            break;
+        // Write Checkpoint at Interval
+        if( checkpoint && std::chrono::steady_clock::now() - last_checkpoint >= checkpoint_interval ){
+            writeCheckpoint( current_position, false );
         }
 
-        // End of Position
-        if( static_cast<int64_t>( current_position - last_position ) < 0 ){
-            std::cout << std::endl; // New line after progress bar
+        // Key Check (Headless Mode never Touches HighGUI)
+        if( preview && preview->isQuit() ){
+            // Cancel IMU Reader
+            imu.reset();
+            complete = false;
             break;
         }
-        last_position = current_position;
     }
+
+    // Show Number of Skipped Duplicate and Subsampled Frames, and Point Clouds without Texture
+    if( !quiet && duplicate_count > 0 ){
+        std::cout << "skipped " << duplicate_count << " duplicate frames" << std::endl;
+    }
+    if( !quiet && subsampled_count > 0 ){
+        std::cout << "skipped " << subsampled_count << " subsampled frames" << std::endl;
+    }
+    if( !quiet && untextured_count > 0 ){
+        std::cout << "skipped " << untextured_count << " point clouds without color frame" << std::endl;
+    }
+
+    // Wait for Pending Images
+    encoder->wait( encoder_group );
+
+    // Close Depth Stack (Write Index and Final Header)
+    if( depth_stack ){
+        depth_stack->close();
+    }
+
+    // Close Video Files (Encode Remaining Images)
+    if( color_video ){
+        color_video->close();
+    }
+    for( const std::unique_ptr<VideoStream>& infrared_video : infrared_videos ){
+        if( infrared_video ){
+            infrared_video->close();
+        }
+    }
+
+    // Close Point Cloud (Write Remaining Point Clouds)
+    if( cloud_stream ){
+        cloud_stream->close();
+    }
+
+    // Write Final Checkpoint
+    if( checkpoint ){
+        writeCheckpoint( reader->getPosition(), complete );
+    }
+    progress = 1.0;
+
+    // Wait for Remaining IMU Samples
+    if( imu ){
+        imu->join();
+    }
+
+    // Close Archive
+    if( archive ){
+        closeArchive();
+    }
+}
+
+// Retrieve Progress [0.0-1.0]
+double RealSense::getProgress() const
+{
+    return progress;
 }
 
 // Initialize
-void RealSense::initialize( int argc, char * argv[] )
+void RealSense::initialize( const Parameter& parameter, const std::shared_ptr<Encoder>& encoder )
 {
     cv::setUseOptimized( true );
 
     // Initialize Parameter
-    initializeParameter( argc, argv );
+    initializeParameter( parameter );
+
+    // Initialize Encoder
+    this->encoder = ( encoder ) ? encoder : std::make_shared<Encoder>( parameter.jobs, parameter.write_behind );
+    encoder_group = std::make_shared<Encoder::Group>();
+
+    // Initialize Conversion Buffers (One More than Images Held by Encoder)
+    const std::size_t num_buffers = this->encoder->getDepth() + 1;
+    for( BufferRing* buffers : { &color_buffers, &depth_buffers, &depth_visual_buffers, &infrared_buffers[0], &infrared_buffers[1] } ){
+        buffers->resize( num_buffers );
+    }
 
     // Initialize Sensor
-    initializeSensor();
+    initializeSensor( parameter );
+
+    // Initialize Depth Filter
+    if( !depth_filter_chain.empty() ){
+        depth_filter = std::make_unique<DepthFilter>( depth_filter_chain );
+    }
 
     // Initialize Save
     initializeSave();
+
+    // Initialize Checkpoint
+    initializeCheckpoint();
+
+    // Initialize Preview
+    if( display ){
+        preview = std::make_unique<Preview>();
+    }
+
+    // Initialize IMU Reader
+    if( imu_lossless ){
+        std::vector<rs2_stream> motion_streams;
+        for( const rs2_stream stream_type : { rs2_stream::RS2_STREAM_GYRO, rs2_stream::RS2_STREAM_ACCEL } ){
+            if( reader->isSelectedStream( stream_type, 0 ) ){
+                motion_streams.push_back( stream_type );
+            }
+        }
+        imu = std::make_unique<ImuReader>( bag_file, directory / "IMU", flush_interval, motion_streams );
+    }
 }
 
 // Initialize Parameter
-inline void RealSense::initializeParameter( int argc, char * argv[] )
+inline void RealSense::initializeParameter( const Parameter& parameter )
+{
+    // Retrieve Bag File Path
+    bag_file = parameter.bag_file;
+    output_directory = parameter.output_directory.empty() ? bag_file.parent_path() : parameter.output_directory;
+
+    // Retrieve Output Options
+    scaling = parameter.scaling;
+    color_profile = parameter.color_profile;
+    depth_profile = parameter.depth_profile;
+    infrared_profile = parameter.infrared_profile;
+    display = parameter.display;
+    flush_interval = parameter.flush_interval;
+    imu_lossless = parameter.imu_lossless;
+    depth_stack_layout = parameter.depth_stack;
+
+    // Retrieve Alignment (Aligned Depth is Always Raw 16bit)
+    align_depth = ( parameter.align == "depth" || parameter.align == "both" );
+    align_color = ( parameter.align == "color" || parameter.align == "both" );
+    aligned_depth_profile = ( depth_profile.supports16bit() ) ? depth_profile : EncoderProfile::parse( "png" );
+
+    // Retrieve Point Cloud
+    cloud_format = parameter.cloud;
+    cloud_stride = parameter.cloud_stride;
+    cloud_voxel = parameter.cloud_voxel;
+    cloud_texture = parameter.cloud_texture;
+
+    // Retrieve Depth Visualization
+    depth_colorizer.setRange( parameter.depth_near, parameter.depth_far );
+    depth_colorizer.setInverse( parameter.depth_inverse );
+    depth_colorizer.setColormap( parameter.depth_colormap );
+    video_fourcc = parameter.video_fourcc;
+    archive_format = parameter.archive;
+    depth_filter_chain = parameter.depth_filter;
+
+    // Retrieve Transform of Images
+    color_transform = parameter.color_transform;
+    depth_transform = parameter.depth_transform;
+    infrared_transform = parameter.infrared_transform;
+
+    // Retrieve Segment of Sharded Extraction
+    shard = parameter.shard;
+    timestamp_ranges = parameter.timestamp_ranges;
+    quiet = parameter.quiet;
+
+    // Retrieve Resume Flag and Checkpoint Interval
+    resume = parameter.resume;
+    checkpoint_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( parameter.checkpoint_interval ) );
+}
+
+// Initialize Sensor
+inline void RealSense::initializeSensor( const Parameter& parameter )
 {
-    // Create Command Line Parser
-    const std::string keys =
-        "{ help h    |       | print this message.                                                      }"
-        "{ bag b     |       | path to input bag file. (required)                                       }"
-        "{ scaling s | false | enable depth scaling for visualization. false is raw 16bit image. (bool) }"
-        "{ quality q | 95    | jpeg encoding quality for color and infrared. [0-100]                    }"
-        "{ display d | false | display each stream images on window. false is not display. (bool)       }";
-    cv::CommandLineParser parser( argc, argv, keys );
+    // Open Bag File with Selected Streams and Seek to Start Position
+    reader = std::make_unique<BagReader>( parameter );
+
+    // Retrieve Extraction Range for Progress Bar
+    total_duration = reader->getDuration();
+    start_position = reader->getStartPosition();
+    end_position = reader->getEndPosition();
+    frame_count = 0;
+
+    // Set Depth Scale of Depth Visualization
+    depth_colorizer.setDepthScale( reader->getDepthScale() );
 
-    if( parser.has( "help" ) ){
-        parser.printMessage();
-        std::exit( EXIT_SUCCESS );
+    // Initialize Temporal Subsampling (Reference Stream is Chosen from Enabled Streams)
+    sampler = TemporalSampler( parameter.frame_step, parameter.target_fps, reader->getStreams() );
+
+    // Show Enable Streams
+    if( quiet ){
+        return;
+    }
+    const std::vector<rs2::stream_profile> stream_profiles = reader->getStreams();
+    for( const rs2::stream_profile stream_profile : stream_profiles ){
+        std::cout << stream_profile.stream_name() << std::endl;
     }
+    std::cout << std::endl;
+}
 
-    // Check Parsing Error
-    if( !parser.check() ){
-        parser.printErrors();
-        throw std::runtime_error( "failed command arguments" );
+// Initialize Save
+inline void RealSense::initializeSave()
+{
+    // Create Root Directory (Bag File Name)
+    // Segments of sharded extraction share the root directory that has been created in advance.
+    directory = output_directory / bag_file.stem();
+    if( !filesystem::create_directories( directory ) && shard < 0 && !resume ){
+        throw std::runtime_error( "failed can't create root directory" );
     }
 
-    // Retrieve Bag File Path (Required)
-    if( !parser.has( "bag" ) ){
-        throw std::runtime_error( "failed can't find input bag file" );
+    // Create Sub Directory for Each Streams (Color, Depth, IR, IR_Right, IMU)
+    const std::vector<rs2::stream_profile> stream_profiles = reader->getStreams();
+    for( const rs2::stream_profile stream_profile : stream_profiles ){
+        filesystem::path sub_directory = directory / getStreamDirectory( stream_profile.stream_type(), stream_profile.stream_index() );
+        filesystem::create_directories( sub_directory );
+
+        if( stream_profile.stream_type() == rs2_stream::RS2_STREAM_COLOR ){
+            color_stream_profile = stream_profile;
+        }
     }
-    else{
-        bag_file = parser.get<cv::String>( "bag" ).c_str();
-        if( !filesystem::is_regular_file( bag_file ) || bag_file.extension() != ".bag" ){
-            throw std::runtime_error( "failed can't find input bag file" );
+
+    // Create Sub Directory for Aligned Images (Depth_Aligned, Color_Aligned)
+    if( align_depth || align_color ){
+        const bool has_depth = std::any_of( stream_profiles.begin(), stream_profiles.end(), []( const rs2::stream_profile& stream_profile ){ return stream_profile.stream_type() == rs2_stream::RS2_STREAM_DEPTH; } );
+        if( !color_stream_profile || !has_depth ){
+            throw std::runtime_error( "failed alignment needs color and depth streams" );
         }
     }
+    if( align_depth ){
+        filesystem::create_directories( directory / "Depth_Aligned" );
+    }
+    if( align_color ){
+        filesystem::create_directories( directory / "Color_Aligned" );
+    }
 
-    // Retrieve Scaling Flag (Option)
-    if( !parser.has( "scaling" ) ){
-        scaling = false;
+    // Create Sub Directory for Point Cloud (PointCloud)
+    if( !cloud_format.empty() ){
+        const bool has_depth = std::any_of( stream_profiles.begin(), stream_profiles.end(), []( const rs2::stream_profile& stream_profile ){ return stream_profile.stream_type() == rs2_stream::RS2_STREAM_DEPTH; } );
+        if( !has_depth ){
+            throw std::runtime_error( "failed point cloud needs depth stream" );
+        }
+        if( cloud_texture && !color_stream_profile ){
+            throw std::runtime_error( "failed point cloud texture needs color stream" );
+        }
+        filesystem::create_directories( directory / "PointCloud" );
     }
-    else{
-        scaling = parser.get<bool>( "scaling" );
+
+    // Create Archive (Images of Extraction are Appended by Encoder)
+    // Sub directories are kept for CSV files until they are appended at the end.
+    if( !archive_format.empty() ){
+        const Archive::Format format = Archive::getFormat( archive_format );
+        archive = std::make_shared<Archive>( directory / ( bag_file.stem().string() + Archive::getExtension( format ) ), format, directory );
+        encoder_group = std::make_shared<Encoder::Group>( archive );
     }
+}
 
-    // Retrieve JPEG Quality (Option)
-    if( !parser.has( "quality" ) ){
-        params = { cv::IMWRITE_JPEG_QUALITY, 95 };
+// Initialize Checkpoint
+// Checkpoint is taken only in extraction that writes one image per frame and rows of CSV files.
+// Depth filter reads framesets ahead of saved frames, so playback position can't be recorded as checkpoint.
+inline void RealSense::initializeCheckpoint()
+{
+    if( checkpoint_interval == std::chrono::steady_clock::duration::zero() || shard >= 0 || !depth_stack_layout.empty() || !video_fourcc.empty() || imu_lossless || archive || depth_filter ){
+        return;
     }
-    else{
-        params = { cv::IMWRITE_JPEG_QUALITY, std::min( std::max( 0, parser.get<int32_t>( "quality" ) ), 100 ) };
+
+    checkpoint = std::make_unique<Checkpoint>( directory );
+    last_checkpoint = std::chrono::steady_clock::now();
+    if( !resume ){
+        return;
     }
 
-    // Retrieve Display Flag (Option)
-    if( !parser.has( "display" ) ){
-        display = false;
+    // Load Checkpoint of Previous Extraction
+    const bool found = checkpoint->load();
+    if( found && checkpoint->complete ){
+        completed = true;
+        return;
     }
-    else{
-        display = parser.get<bool>( "display" );
+
+    // Remove CSV Files that have been Created after Checkpoint (All CSV Files if there is No Checkpoint)
+    // Rows are appended to existing CSV files, so they must not contain rows of frames that will be saved again.
+    const std::vector<rs2::stream_profile> stream_profiles = reader->getStreams();
+    for( const rs2::stream_profile stream_profile : stream_profiles ){
+        const std::string sub_directory = getStreamDirectory( stream_profile.stream_type(), stream_profile.stream_index() );
+        for( const char* name : { "metadata", "gyro_data", "accel_data" } ){
+            const std::string file = sub_directory + "/" + std::string( name ) + ".csv";
+            if( checkpoint->files.count( file ) == 0 ){
+                filesystem::remove( directory / file );
+            }
+        }
+    }
+    if( !found ){
+        return;
+    }
+
+    // Truncate Rows that have been Written after Checkpoint
+    checkpoint->restore();
+
+    // Frames up to Last Saved Timestamp of Each Stream are Skipped
+    for( const std::pair<const StreamKey, Checkpoint::Stream>& stream : checkpoint->streams ){
+        resume_timestamps[stream.first] = stream.second.timestamp;
+    }
+
+    // Seek to Checkpoint Position (with Margin for Frames that are Buffered to Synchronize Streams)
+    constexpr uint64_t margin = 1000000000; // 1 second
+    const uint64_t position = ( checkpoint->position > start_position + margin ) ? checkpoint->position - margin : start_position;
+    if( start_position < position && position < end_position ){
+        reader->seek( position );
+    }
+
+    if( !quiet ){
+        std::cout << "resume from " << std::fixed << std::setprecision( 3 ) << position / 1e9 << " seconds" << std::endl;
     }
 }
 
-// Initialize Sensor
-inline void RealSense::initializeSensor()
+// Check Frame is in Timestamp Range of Segment (Sharded Extraction)
+inline bool RealSense::isInSegment( const rs2::frame& frame )
+{
+    if( timestamp_ranges.empty() ){
+        return true;
+    }
+
+    const rs2::stream_profile stream_profile = frame.get_profile();
+    const std::map<StreamKey, std::pair<double, double>>::const_iterator range = timestamp_ranges.find( StreamKey( stream_profile.stream_type(), stream_profile.stream_index() ) );
+    if( range == timestamp_ranges.end() ){
+        return true;
+    }
+
+    const double timestamp = frame.get_timestamp();
+    return range->second.first <= timestamp && timestamp < range->second.second;
+}
+
+// Check Frame has been Saved by Previous Extraction (Resume Mode)
+inline bool RealSense::isSaved( const rs2::frame& frame )
+{
+    if( resume_timestamps.empty() ){
+        return false;
+    }
+
+    const rs2::stream_profile stream_profile = frame.get_profile();
+    const std::map<StreamKey, double>::const_iterator saved = resume_timestamps.find( StreamKey( stream_profile.stream_type(), stream_profile.stream_index() ) );
+    if( saved == resume_timestamps.end() ){
+        return false;
+    }
+
+    return frame.get_timestamp() <= saved->second;
+}
+
+// Record Saved Frame for Checkpoint
+inline void RealSense::commitFrame( const rs2::frame& frame )
 {
-    // Retrieve Each Streams that contain in File
-    rs2::config config;
-    rs2::context context;
-    const rs2::playback playback = context.load_device( bag_file.string() );
-    const std::vector<rs2::sensor> sensors = playback.query_sensors();
-    for( const rs2::sensor& sensor : sensors ){
-        const std::vector<rs2::stream_profile> stream_profiles = sensor.get_stream_profiles();
-        for( const rs2::stream_profile& stream_profile : stream_profiles ){
-            config.enable_stream( stream_profile.stream_type(), stream_profile.stream_index() );
+    if( !checkpoint ){
+        return;
+    }
+
+    const rs2::stream_profile stream_profile = frame.get_profile();
+    Checkpoint::Stream& stream = checkpoint->streams[StreamKey( stream_profile.stream_type(), stream_profile.stream_index() )];
+    stream.timestamp = frame.get_timestamp();
+    stream.frames++;
+}
+
+// Write Checkpoint
+// Images before checkpoint must be on disk, and rows before checkpoint must be in CSV files.
+inline void RealSense::writeCheckpoint( uint64_t position, bool complete )
+{
+    TRACE_SCOPE( "checkpoint" );
+
+    // Wait for Pending Images and Point Clouds
+    encoder->wait( encoder_group );
+    if( cloud_stream ){
+        cloud_stream->wait();
+    }
+
+    // Flush CSV Files and Record Committed Size
+    for( CsvWriter* writer : { color_metadata.get(), depth_metadata.get(), infrared_metadata[0].get(), infrared_metadata[1].get(), gyro_writer.get(), accel_writer.get() } ){
+        if( !writer ){
+            continue;
         }
+
+        writer->flush();
+        const filesystem::path& path = writer->getPath();
+        checkpoint->files[( path.parent_path().filename() / path.filename() ).generic_string()] = filesystem::file_size( path );
     }
 
-    // Start Pipeline
-    config.enable_device_from_file( playback.file_name() );
-    pipeline_profile = pipeline.start( config );
+    // Write Manifest
+    checkpoint->position = position;
+    checkpoint->complete = complete;
+    checkpoint->save();
+    last_checkpoint = std::chrono::steady_clock::now();
+}
 
-    // Set Non Real Time Playback
-    pipeline_profile.get_device().as<rs2::playback>().set_real_time( false );
+// Retrieve CSV File Path (Part File of Segment in Sharded Extraction)
+inline filesystem::path RealSense::getCsvPath( const filesystem::path& sub_directory, const std::string& name )
+{
+    if( shard < 0 ){
+        return sub_directory / ( name + ".csv" );
+    }
 
-    // Get Total Duration for Progress Bar
-    total_duration = pipeline_profile.get_device().as<rs2::playback>().get_duration().count();
-    frame_count = 0;
+    return sub_directory / ( name + ".shard" + std::to_string( shard ) + ".csv" );
+}
 
-    // Show Enable Streams
-    const std::vector<rs2::stream_profile> stream_profiles = pipeline_profile.get_streams();
-    for( const rs2::stream_profile stream_profile : stream_profiles ){
-        std::cout << stream_profile.stream_name() << std::endl;
+// Retrieve Sub Directory Name of Stream
+inline std::string RealSense::getStreamDirectory( rs2_stream stream_type, int32_t stream_index )
+{
+    switch( stream_type ){
+        case rs2_stream::RS2_STREAM_COLOR:
+            return "Color";
+        case rs2_stream::RS2_STREAM_DEPTH:
+            return "Depth";
+        case rs2_stream::RS2_STREAM_GYRO:
+        case rs2_stream::RS2_STREAM_ACCEL:
+            return "IMU";
+        default:
+            return getStreamName( stream_type, stream_index );
     }
-    std::cout << std::endl;
 }
 
-// Initialize Save
-inline void RealSense::initializeSave()
+// Close Archive (Append CSV Files and Remove Empty Sub Directories)
+inline void RealSense::closeArchive()
 {
-    // Create Root Directory (Bag File Name)
-    directory = bag_file.parent_path().generic_string() + "/" + bag_file.stem().string();
-    if( !filesystem::create_directories( directory ) ){
-        throw std::runtime_error( "failed can't create root directory" );
+    // Close CSV Writers (Flush Buffers)
+    std::vector<filesystem::path> files;
+    for( std::unique_ptr<CsvWriter>* writer : { &color_metadata, &depth_metadata, &infrared_metadata[0], &infrared_metadata[1], &gyro_writer, &accel_writer } ){
+        if( *writer ){
+            files.push_back( ( *writer )->getPath() );
+            writer->reset();
+        }
+    }
+    if( imu_lossless ){
+        imu.reset();
+        for( const char* name : { "gyro_data.csv", "accel_data.csv" } ){
+            if( filesystem::exists( directory / "IMU" / name ) ){
+                files.push_back( directory / "IMU" / name );
+            }
+        }
     }
 
-    // Create Sub Directory for Each Streams (Stream Name)
-    const std::vector<rs2::stream_profile> stream_profiles = pipeline_profile.get_streams();
-    for( const rs2::stream_profile stream_profile : stream_profiles ){
-        filesystem::path sub_directory = directory.generic_string() + "/" + stream_profile.stream_name();
-        filesystem::create_directories( sub_directory );
+    // Append CSV Files
+    for( const filesystem::path& file : files ){
+        archive->appendFile( file );
+    }
+    archive->close();
+
+    // Remove Empty Sub Directories
+    std::vector<filesystem::path> sub_directories;
+    for( const filesystem::directory_entry& entry : filesystem::directory_iterator( directory ) ){
+        if( filesystem::is_directory( entry.path() ) && filesystem::is_empty( entry.path() ) ){
+            sub_directories.push_back( entry.path() );
+        }
+    }
+    for( const filesystem::path& sub_directory : sub_directories ){
+        filesystem::remove( sub_directory );
     }
 }
 
 // Finalize
 void RealSense::finalize()
 {
+    // Stop IMU Reader
+    imu.reset();
+
+    // Stop Depth Filter (Release Framesets Read Ahead)
+    depth_filter.reset();
+    filtered_depth_frame = rs2::frame();
+
+    // Stop Encoder (Drain Pending Images)
+    encoder.reset();
+    encoder_group.reset();
+
+    // Close CSV Writers (Flush Buffers)
+    color_metadata.reset();
+    depth_metadata.reset();
+    for( std::unique_ptr<CsvWriter>& writer : infrared_metadata ){
+        writer.reset();
+    }
+    gyro_writer.reset();
+    accel_writer.reset();
+    depth_stack.reset();
+    color_video.reset();
+    for( std::unique_ptr<VideoStream>& infrared_video : infrared_videos ){
+        infrared_video.reset();
+    }
+    cloud_stream.reset();
+    archive.reset();
+
     // Close Windows
-    cv::destroyAllWindows();
+    preview.reset();
 
-    // Stop Pipline
-    pipeline.stop();
+    // Stop Pipeline
+    reader.reset();
 }
 
 // Update Data
-void RealSense::update()
+bool RealSense::update()
 {
     // Update Frame
-    updateFrame();
+    if( !updateFrame() ){
+        return false;
+    }
+
+    // Decide Temporal Subsampling of Frameset
+    sampled = sampler.isKept( frameset );
 
     // Update Color
     updateColor();
@@ -219,21 +591,79 @@ void RealSense::update()
 
     // Update Accel
     updateAccel();
+
+    return true;
 }
 
 // Update Frame
-inline void RealSense::updateFrame()
+// With depth filter, framesets are read ahead while depth is filtered, and a filtered frameset is returned in order.
+inline bool RealSense::updateFrame()
 {
     // Update Frame
-    frameset = pipeline.wait_for_frames();
+    if( !depth_filter ){
+        return reader->read( frameset );
+    }
+
+    // Read Next Frameset until Filtered Frameset is Ready (Drain Remaining Framesets at End)
+    DepthFilter::Result result;
+    while( !depth_filter->tryPop( result ) ){
+        if( playback_ended ){
+            if( !depth_filter->pop( result ) ){
+                return false;
+            }
+            break;
+        }
+
+        rs2::frameset next;
+        if( reader->read( next ) ){
+            depth_filter->push( next );
+        }
+        else{
+            depth_filter->close();
+            playback_ended = true;
+        }
+    }
+
+    frameset = result.frameset;
+    filtered_depth_frame = result.depth;
+    return true;
+}
+
+// Check Frame is New (Not Same Frame Number and Timestamp as Last Frame of Stream)
+inline bool RealSense::isNewFrame( const rs2::frame& frame )
+{
+    const rs2::stream_profile stream_profile = frame.get_profile();
+    const StreamKey key( stream_profile.stream_type(), stream_profile.stream_index() );
+    const std::pair<unsigned long long, double> id( frame.get_frame_number(), frame.get_timestamp() );
+
+    std::map<StreamKey, std::pair<unsigned long long, double>>::iterator last_frame = last_frames.find( key );
+    if( last_frame != last_frames.end() && last_frame->second == id ){
+        duplicate_count++;
+        countProfile( "frames/duplicate", 1 );
+        return false;
+    }
+
+    last_frames[key] = id;
+    return true;
+}
+
+// Check Frame is Kept by Temporal Subsampling (see TemporalSampler)
+inline bool RealSense::isSampled()
+{
+    if( !sampled ){
+        subsampled_count++;
+        countProfile( "frames/subsampled", 1 );
+    }
+    return sampled;
 }
 
 // Update Color
 inline void RealSense::updateColor()
 {
-    // Retrieve Color Flame
+    // Retrieve Color Flame (Skip Frame Repeated by Syncer, Subsampled, out of Segment or Saved, before Conversion)
     color_frame = frameset.get_color_frame();
-    if( !color_frame ){
+    color_updated = color_frame && isNewFrame( color_frame ) && isSampled() && isInSegment( color_frame ) && !isSaved( color_frame );
+    if( !color_updated ){
         return;
     }
 
@@ -245,9 +675,10 @@ inline void RealSense::updateColor()
 // Update Depth
 inline void RealSense::updateDepth()
 {
-    // Retrieve Depth Flame
-    depth_frame = frameset.get_depth_frame();
-    if( !depth_frame ){
+    // Retrieve Depth Flame (Filtered by Depth Filter, Skip Frame Repeated by Syncer, Subsampled, out of Segment or Saved, before Conversion)
+    depth_frame = ( depth_filter ) ? filtered_depth_frame : frameset.get_depth_frame();
+    depth_updated = depth_frame && isNewFrame( depth_frame ) && isSampled() && isInSegment( depth_frame ) && !isSaved( depth_frame );
+    if( !depth_updated ){
         return;
     }
 
@@ -272,8 +703,13 @@ inline void RealSense::updateInfrared()
         }
     } );
 
+    // Skip Frames Carried Over from Previous Frameset, Repeated by Syncer, Subsampled, out of Segment or Saved (before Conversion)
+    for( std::size_t i = 0; i < infrared_frames.size(); i++ ){
+        infrared_updated[i] = infrared_frames[i] && isNewFrame( infrared_frames[i] ) && isSampled() && isInSegment( infrared_frames[i] ) && !isSaved( infrared_frames[i] );
+    }
+
     const rs2::frame& infrared_frame = infrared_frames.front();
-    if( !infrared_frame ){
+    if( !infrared_updated.front() ){
         return;
     }
 
@@ -285,6 +721,11 @@ inline void RealSense::updateInfrared()
 // Update Gyro
 inline void RealSense::updateGyro()
 {
+    // Gyro Samples are Written by IMU Reader in Lossless Mode
+    if( imu ){
+        return;
+    }
+
     // Retrieve Gyro Frame
     #if 29 < RS2_API_MINOR_VERSION
     frameset.foreach_rs( [this]( const rs2::frame& frame ){
@@ -296,7 +737,9 @@ inline void RealSense::updateGyro()
         }
     } );
 
-    if( !gyro_frame ){
+    // Skip Frame Carried Over from Previous Frameset, out of Segment or Saved
+    gyro_updated = gyro_frame && isNewFrame( gyro_frame ) && isInSegment( gyro_frame ) && !isSaved( gyro_frame );
+    if( !gyro_updated ){
         return;
     }
 
@@ -309,6 +752,11 @@ inline void RealSense::updateGyro()
 // Update Accel
 inline void RealSense::updateAccel()
 {
+    // Accel Samples are Written by IMU Reader in Lossless Mode
+    if( imu ){
+        return;
+    }
+
     // Retrieve Accel Frame
     #if 29 < RS2_API_MINOR_VERSION
     frameset.foreach_rs( [this]( const rs2::frame& frame ){
@@ -320,7 +768,9 @@ inline void RealSense::updateAccel()
         }
     } );
 
-    if( !accel_frame ){
+    // Skip Frame Carried Over from Previous Frameset, out of Segment or Saved
+    accel_updated = accel_frame && isNewFrame( accel_frame ) && isInSegment( accel_frame ) && !isSaved( accel_frame );
+    if( !accel_updated ){
         return;
     }
 
@@ -346,74 +796,61 @@ void RealSense::draw()
 // Draw Color
 inline void RealSense::drawColor()
 {
-    if( !color_frame ){
+    TRACE_SCOPE( "convert/Color" );
+
+    if( !color_updated ){
         return;
     }
 
-    // Create cv::Mat form Color Frame
-    const rs2_format color_format = color_frame.get_profile().format();
-    switch( color_format ){
-        // RGB8
-        case rs2_format::RS2_FORMAT_RGB8:
-        {
-            color_mat = cv::Mat( color_height, color_width, CV_8UC3, const_cast<void*>( color_frame.get_data() ) ).clone();
-            cv::cvtColor( color_mat, color_mat, cv::COLOR_RGB2BGR );
-            break;
-        }
-        // RGBA8
-        case rs2_format::RS2_FORMAT_RGBA8:
-        {
-            color_mat = cv::Mat( color_height, color_width, CV_8UC4, const_cast<void*>( color_frame.get_data() ) ).clone();
-            cv::cvtColor( color_mat, color_mat, cv::COLOR_RGBA2BGRA );
-            break;
-        }
-        // BGR8
-        case rs2_format::RS2_FORMAT_BGR8:
-        {
-            color_mat = cv::Mat( color_height, color_width, CV_8UC3, const_cast<void*>( color_frame.get_data() ) ).clone();
-            break;
-        }
-        // BGRA8
-        case rs2_format::RS2_FORMAT_BGRA8:
-        {
-            color_mat = cv::Mat( color_height, color_width, CV_8UC4, const_cast<void*>( color_frame.get_data() ) ).clone();
-            break;
-        }
-        // Y16 (GrayScale)
-        case rs2_format::RS2_FORMAT_Y16:
-        {
-            color_mat = cv::Mat( color_height, color_width, CV_16UC1, const_cast<void*>( color_frame.get_data() ) ).clone();
-            constexpr double scaling = static_cast<double>( std::numeric_limits<uint8_t>::max() ) / static_cast<double>( std::numeric_limits<uint16_t>::max() );
-            color_mat.convertTo( color_mat, CV_8U, scaling );
-            break;
-        }
-        // YUYV
-        case rs2_format::RS2_FORMAT_YUYV:
-        {
-            color_mat = cv::Mat( color_height, color_width, CV_8UC2, const_cast<void*>( color_frame.get_data() ) ).clone();
-            cv::cvtColor( color_mat, color_mat, cv::COLOR_YUV2BGR_YUYV );
-            break;
-        }
-        default:
-            throw std::runtime_error( "unknown color format" );
-            break;
+    // Retrieve Convert Kernel for Color Format
+    const ConvertKernel convert = getConvertKernel( color_frame.get_profile().format() );
+    if( !convert ){
+        throw std::runtime_error( "unknown color format" );
     }
+
+    // Create cv::Mat form Color Frame (Cropped and Scaled in Conversion)
+    const rs2::video_frame video_frame = color_frame.as<rs2::video_frame>();
+    cv::Mat& color_buffer = color_buffers.next();
+    convertFrame( convert, color_frame.get_data(), color_width, color_height, video_frame.get_stride_in_bytes(), video_frame.get_bytes_per_pixel(), color_transform, false, color_buffer );
+    color_mat = color_buffer;
 }
 
 // Draw Depth
 inline void RealSense::drawDepth()
 {
-    if( !depth_frame ){
+    TRACE_SCOPE( "convert/Depth" );
+
+    if( !depth_updated ){
         return;
     }
 
-    // Create cv::Mat form Depth Frame
-    depth_mat = cv::Mat( depth_height, depth_width, CV_16UC1, const_cast<void*>( depth_frame.get_data() ) ).clone();
+    // Retrieve Convert Kernel for Depth Format
+    const ConvertKernel convert = getConvertKernel( depth_frame.get_profile().format() );
+    if( !convert ){
+        throw std::runtime_error( "unknown depth format" );
+    }
+
+    // Create cv::Mat form Depth Frame (Cropped and Min-Pooled in Conversion)
+    const rs2::video_frame video_frame = depth_frame.as<rs2::video_frame>();
+    const bool pooling = ( depth_frame.get_profile().format() == rs2_format::RS2_FORMAT_Z16 );
+    cv::Mat& depth_buffer = depth_buffers.next();
+    convertFrame( convert, depth_frame.get_data(), depth_width, depth_height, video_frame.get_stride_in_bytes(), video_frame.get_bytes_per_pixel(), depth_transform, pooling, depth_buffer );
+    depth_mat = depth_buffer;
+
+    // Visualize Depth Once for Show and Save
+    const bool save_visual = scaling && depth_stack_layout.empty();
+    if( ( save_visual || display ) && depth_mat.depth() == CV_16U ){
+        cv::Mat& depth_visual_buffer = depth_visual_buffers.next();
+        depth_colorizer.colorize( depth_mat, depth_visual_buffer );
+        depth_visual_mat = depth_visual_buffer;
+    }
 }
 
 // Draw Infrared
 inline void RealSense::drawInfrared()
 {
+    TRACE_SCOPE( "convert/Infrared" );
+
     // Create cv::Mat form Infrared Frame
     for( const rs2::frame& infrared_frame : infrared_frames ){
         if( !infrared_frame ){
@@ -422,57 +859,28 @@ inline void RealSense::drawInfrared()
 
         const uint8_t infrared_stream_index = infrared_frame.get_profile().stream_index();
         const uint8_t infrared_mat_index = ( infrared_stream_index != 0 ) ? infrared_stream_index - 1 : 0;
-        const rs2_format infrared_format = infrared_frame.get_profile().format();
-        switch( infrared_format ){
-            // RGB8 (Color)
-            case rs2_format::RS2_FORMAT_RGB8:
-            {
-                infrared_mats[infrared_mat_index] = cv::Mat( infrared_height, infrared_width, CV_8UC3, const_cast<void*>( infrared_frame.get_data() ) ).clone();
-                cv::cvtColor( infrared_mats[infrared_mat_index], infrared_mats[infrared_mat_index], cv::COLOR_RGB2BGR );
-                break;
-            }
-            // RGBA8 (Color)
-            case rs2_format::RS2_FORMAT_RGBA8:
-            {
-                infrared_mats[infrared_mat_index] = cv::Mat( infrared_height, infrared_width, CV_8UC4, const_cast<void*>( infrared_frame.get_data() ) ).clone();
-                cv::cvtColor( infrared_mats[infrared_mat_index], infrared_mats[infrared_mat_index], cv::COLOR_RGBA2BGRA );
-                break;
-            }
-            // BGR8 (Color)
-            case rs2_format::RS2_FORMAT_BGR8:
-            {
-                infrared_mats[infrared_mat_index] = cv::Mat( infrared_height, infrared_width, CV_8UC3, const_cast<void*>( infrared_frame.get_data() ) ).clone();
-                break;
-            }
-            // BGRA8 (Color)
-            case rs2_format::RS2_FORMAT_BGRA8:
-            {
-                infrared_mats[infrared_mat_index] = cv::Mat( infrared_height, infrared_width, CV_8UC4, const_cast<void*>( infrared_frame.get_data() ) ).clone();
-                break;
-            }
-            // Y8
-            case rs2_format::RS2_FORMAT_Y8:
-            {
-                infrared_mats[infrared_mat_index] = cv::Mat( infrared_height, infrared_width, CV_8UC1, const_cast<void*>( infrared_frame.get_data() ) ).clone();
-                break;
-            }
-            // UYVY
-            case rs2_format::RS2_FORMAT_UYVY:
-            {
-                infrared_mats[infrared_mat_index] = cv::Mat( infrared_height, infrared_width, CV_8UC2, const_cast<void*>( infrared_frame.get_data() ) ).clone();
-                cv::cvtColor( infrared_mats[infrared_mat_index], infrared_mats[infrared_mat_index], cv::COLOR_YUV2GRAY_UYVY );
-                break;
-            }
-            default:
-                throw std::runtime_error( "unknown infrared format" );
-                break;
+        if( !infrared_updated[infrared_mat_index] ){
+            continue;
+        }
+
+        // Retrieve Convert Kernel for Infrared Format
+        const ConvertKernel convert = getConvertKernel( infrared_frame.get_profile().format() );
+        if( !convert ){
+            throw std::runtime_error( "unknown infrared format" );
         }
+
+        const rs2::video_frame video_frame = infrared_frame.as<rs2::video_frame>();
+        cv::Mat& infrared_buffer = infrared_buffers[infrared_mat_index].next();
+        convertFrame( convert, infrared_frame.get_data(), infrared_width, infrared_height, video_frame.get_stride_in_bytes(), video_frame.get_bytes_per_pixel(), infrared_transform, false, infrared_buffer );
+        infrared_mats[infrared_mat_index] = infrared_buffer;
     }
 }
 
 // Show Data
 void RealSense::show()
 {
+    TRACE_SCOPE( "show" );
+
     // Show Color
     showColor();
 
@@ -495,7 +903,7 @@ inline void RealSense::showColor()
     }
 
     // Show Color Image
-    cv::imshow( "Color", color_mat );
+    preview->update( "Color", color_mat, color_frame );
 }
 
 // Show Depth
@@ -509,12 +917,13 @@ inline void RealSense::showDepth()
         return;
     }
 
-    // Scaling
-    cv::Mat scale_mat;
-    depth_mat.convertTo( scale_mat, CV_8U, -255.0 / 10000.0, 255.0 ); // 0-10000 -> 255(white)-0(black)
-
-    // Show Depth Image
-    cv::imshow( "Depth", scale_mat );
+    // Show Depth Image (Visualized in Draw)
+    if( !depth_visual_mat.empty() ){
+        preview->update( "Depth", depth_visual_mat );
+    }
+    else{
+        preview->update( "Depth", depth_mat, depth_frame );
+    }
 }
 
 // Show Infrared
@@ -532,7 +941,7 @@ inline void RealSense::showInfrared()
         }
 
         // Show Infrared Image
-        cv::imshow( "Infrared " + std::to_string( infrared_stream_index ), infrared_mats[infrared_mat_index] );
+        preview->update( "Infrared " + std::to_string( infrared_stream_index ), infrared_mats[infrared_mat_index], infrared_frame );
     }
 }
 
@@ -545,6 +954,12 @@ void RealSense::save()
     // Save Depth
     saveDepth();
 
+    // Save Aligned Images
+    saveAligned();
+
+    // Save Point Cloud
+    saveCloud();
+
     // Save Infrared
     saveInfrared();
 
@@ -558,7 +973,9 @@ void RealSense::save()
 // Save Color
 inline void RealSense::saveColor()
 {
-    if( !color_frame ){
+    TRACE_SCOPE( "save/Color" );
+
+    if( !color_updated ){
         return;
     }
 
@@ -566,38 +983,34 @@ inline void RealSense::saveColor()
         return;
     }
 
-    // Create Save Directory and File Name
-    std::ostringstream oss;
-    oss << directory.generic_string() << "/Color/";
-    oss << std::setfill( '0' ) << std::setw( 6 ) << color_frame.get_frame_number() << ".jpg";
+    // Write Color Image to Video File
+    if( !video_fourcc.empty() ){
+        saveVideo( color_video, directory / "Color", "color", color_mat, color_frame );
+    }
+    else{
+        // Create Save Directory and File Name
+        std::ostringstream oss;
+        oss << directory.generic_string() << "/Color/";
+        oss << std::setfill( '0' ) << std::setw( 6 ) << color_frame.get_frame_number() << color_profile.extension();
 
-    // Write Color Image
-    cv::imwrite( oss.str(), color_mat, params );
+        // Write Color Image
+        encoder->write( oss.str(), color_mat, color_profile.params, color_frame, encoder_group );
+    }
 
     // Save Metadata
-    std::ostringstream meta_oss;
-    meta_oss << directory.generic_string() << "/Color/metadata.csv";
-    filesystem::path meta_path = meta_oss.str();
-    bool write_header = !filesystem::exists( meta_path );
-    std::ofstream meta_file( meta_oss.str(), std::ios::app );
-    if( meta_file.is_open() ){
-        if( write_header ){
-            meta_file << "frame_number,timestamp,width,height,format" << std::endl;
-        }
-        meta_file << std::fixed << std::setprecision( 6 );
-        meta_file << color_frame.get_frame_number() << ",";
-        meta_file << color_frame.get_timestamp() << ",";
-        meta_file << color_width << ",";
-        meta_file << color_height << ",";
-        meta_file << color_frame.get_profile().format() << std::endl;
-        meta_file.close();
+    if( !color_metadata ){
+        color_metadata = std::make_unique<CsvWriter>( getCsvPath( directory / "Color", "metadata" ), "frame_number,timestamp,width,height,format", flush_interval );
     }
+    color_metadata->write( color_frame.get_frame_number(), color_frame.get_timestamp(), color_mat.cols, color_mat.rows, rs2_format_to_string( color_frame.get_profile().format() ) );
+    commitFrame( color_frame );
 }
 
 // Save Depth
 inline void RealSense::saveDepth()
 {
-    if( !depth_frame ){
+    TRACE_SCOPE( "save/Depth" );
+
+    if( !depth_updated ){
         return;
     }
 
@@ -605,43 +1018,156 @@ inline void RealSense::saveDepth()
         return;
     }
 
-    // Create Save Directory and File Name
-    std::ostringstream oss;
-    oss << directory.generic_string() << "/Depth/";
-    oss << std::setfill( '0' ) << std::setw( 6 ) << depth_frame.get_frame_number() << ".png";
-
-    // Scaling
-    cv::Mat scale_mat = depth_mat;
-    if( scaling ){
-        depth_mat.convertTo( scale_mat, CV_8U, -255.0 / 10000.0, 255.0 ); // 0-10000 -> 255(white)-0(black)
+    // Write Raw Depth to Depth Stack
+    if( !depth_stack_layout.empty() ){
+        saveDepthStack();
     }
+    else{
+        // Create Save Directory and File Name
+        std::ostringstream oss;
+        oss << directory.generic_string() << "/Depth/";
+        oss << std::setfill( '0' ) << std::setw( 6 ) << depth_frame.get_frame_number() << depth_profile.extension();
 
-    // Write Depth Image
-    cv::imwrite( oss.str(), scale_mat );
+        // Scaling (Visualized in Draw)
+        const bool visual = scaling && !depth_visual_mat.empty();
+        const cv::Mat& scale_mat = ( visual ) ? depth_visual_mat : depth_mat;
+
+        // Write Depth Image
+        encoder->write( oss.str(), scale_mat, depth_profile.params, ( visual ) ? rs2::frame() : depth_frame, encoder_group );
+    }
 
     // Save Metadata
-    std::ostringstream meta_oss;
-    meta_oss << directory.generic_string() << "/Depth/metadata.csv";
-    filesystem::path meta_path = meta_oss.str();
-    bool write_header = !filesystem::exists( meta_path );
-    std::ofstream meta_file( meta_oss.str(), std::ios::app );
-    if( meta_file.is_open() ){
-        if( write_header ){
-            meta_file << "frame_number,timestamp,width,height,format" << std::endl;
+    if( !depth_metadata ){
+        depth_metadata = std::make_unique<CsvWriter>( getCsvPath( directory / "Depth", "metadata" ), "frame_number,timestamp,width,height,format", flush_interval );
+    }
+    depth_metadata->write( depth_frame.get_frame_number(), depth_frame.get_timestamp(), depth_mat.cols, depth_mat.rows, rs2_format_to_string( depth_frame.get_profile().format() ) );
+    commitFrame( depth_frame );
+}
+
+// Save Depth Stack
+inline void RealSense::saveDepthStack()
+{
+    const rs2::video_frame video_frame = depth_frame.as<rs2::video_frame>();
+    if( !depth_stack ){
+        const rs2_format format = depth_frame.get_profile().format();
+        if( format != rs2_format::RS2_FORMAT_Z16 ){
+            throw std::runtime_error( "failed depth stack supports only z16 format" );
         }
-        meta_file << std::fixed << std::setprecision( 6 );
-        meta_file << depth_frame.get_frame_number() << ",";
-        meta_file << depth_frame.get_timestamp() << ",";
-        meta_file << depth_width << ",";
-        meta_file << depth_height << ",";
-        meta_file << depth_frame.get_profile().format() << std::endl;
-        meta_file.close();
+
+        const DepthStack::Layout layout = ( depth_stack_layout == "npy" ) ? DepthStack::Layout::Npy : DepthStack::Layout::Raw;
+        const filesystem::path path = directory / "Depth" / ( ( layout == DepthStack::Layout::Npy ) ? "depth.npy" : "depth.stack" );
+        depth_stack = std::make_unique<DepthStack>( path, layout, video_frame.get_width(), video_frame.get_height(), format, reader->getDepthScale() );
+    }
+
+    depth_stack->write( video_frame.get_data(), video_frame.get_stride_in_bytes(), depth_frame.get_frame_number(), depth_frame.get_timestamp() );
+}
+
+// Save Aligned Images
+// Alignment runs on encoder worker threads with the aligner that is shared by tasks.
+// Depth_Aligned is named by depth frame number, and Color_Aligned is named by color frame number.
+inline void RealSense::saveAligned()
+{
+    TRACE_SCOPE( "save/Aligned" );
+
+    if( !align_depth && !align_color ){
+        return;
+    }
+
+    if( !depth_updated || depth_mat.type() != CV_16UC1 ){
+        return;
+    }
+
+    // Create Aligner at First Frame (Ray Tables are Rebuilt only if Stream Profiles have Changed)
+    if( !aligner || !aligner->isCreatedFor( depth_frame.get_profile(), color_stream_profile ) ){
+        const float depth_scale = depth_frame.as<rs2::depth_frame>().get_units();
+        aligner = std::make_shared<const DepthAligner>( depth_frame.get_profile().as<rs2::video_stream_profile>(), color_stream_profile.as<rs2::video_stream_profile>(), depth_scale );
+    }
+    const std::shared_ptr<const DepthAligner> depth_aligner = aligner;
+
+    // Write Depth Aligned to Color
+    if( align_depth ){
+        std::ostringstream oss;
+        oss << directory.generic_string() << "/Depth_Aligned/";
+        oss << std::setfill( '0' ) << std::setw( 6 ) << depth_frame.get_frame_number() << aligned_depth_profile.extension();
+
+        encoder->write( oss.str(), depth_mat, aligned_depth_profile.params, depth_frame, encoder_group, [depth_aligner]( const cv::Mat& depth ){
+            cv::Mat aligned;
+            depth_aligner->alignDepth( depth, aligned );
+            return aligned;
+        } );
+    }
+
+    // Write Color Aligned to Depth (Color Frame of Same Frameset)
+    if( align_color && color_updated && !color_mat.empty() ){
+        std::ostringstream oss;
+        oss << directory.generic_string() << "/Color_Aligned/";
+        oss << std::setfill( '0' ) << std::setw( 6 ) << color_frame.get_frame_number() << color_profile.extension();
+
+        // Keep Depth Frame Buffer Alive until Alignment (Depth Image may Refer to It)
+        rs2::frame depth_source = depth_frame;
+        depth_source.keep();
+        const cv::Mat depth = depth_mat;
+        encoder->write( oss.str(), color_mat, color_profile.params, color_frame, encoder_group, [depth_aligner, depth, depth_source]( const cv::Mat& color ){
+            cv::Mat aligned;
+            depth_aligner->alignColor( depth, color, aligned );
+            return aligned;
+        } );
     }
 }
 
+// Save Point Cloud (Open Point Cloud Writer at First Frame)
+inline void RealSense::saveCloud()
+{
+    TRACE_SCOPE( "save/PointCloud" );
+
+    if( cloud_format.empty() ){
+        return;
+    }
+
+    if( !depth_updated || depth_mat.type() != CV_16UC1 ){
+        return;
+    }
+
+    // Skip Point Cloud without New Color Frame in Same Frameset (Texture of Older Frameset Doesn't Match)
+    if( cloud_texture && ( !color_updated || color_mat.empty() ) ){
+        untextured_count++;
+        countProfile( "frames/untextured", 1 );
+        return;
+    }
+
+    if( !cloud_stream ){
+        const float depth_scale = depth_frame.as<rs2::depth_frame>().get_units();
+        const rs2::stream_profile texture_profile = ( cloud_texture ) ? color_stream_profile : rs2::stream_profile();
+        cloud_stream = std::make_unique<CloudStream>( directory / "PointCloud", CloudStream::getFormat( cloud_format ), depth_frame.get_profile().as<rs2::video_stream_profile>(), depth_scale, cloud_stride, cloud_voxel, texture_profile, flush_interval );
+    }
+
+    // Write Point Cloud (Textured with Color Frame of Same Frameset)
+    if( cloud_texture ){
+        cloud_stream->write( depth_mat, depth_frame, color_mat, color_frame );
+    }
+    else{
+        cloud_stream->write( depth_mat, depth_frame );
+    }
+}
+
+// Save Video Frame (Open Video File at First Frame)
+inline void RealSense::saveVideo( std::unique_ptr<VideoStream>& video, const filesystem::path& sub_directory, const std::string& name, const cv::Mat& image, const rs2::frame& frame )
+{
+    if( !video ){
+        // Frame Rate of Kept Frames (Stream Profile Subsampled by Frame Step and Target Frame Rate)
+        const double fps = sampler.getFrameRate( frame.get_profile().fps() );
+        const filesystem::path path = sub_directory / ( name + VideoStream::getExtension( video_fourcc ) );
+        video = std::make_unique<VideoStream>( path, video_fourcc, fps, image.size(), image.channels() != 1, flush_interval );
+    }
+
+    video->write( image, frame );
+}
+
 // Save Infrared
 inline void RealSense::saveInfrared()
 {
+    TRACE_SCOPE( "save/Infrared" );
+
     for( const rs2::frame& infrared_frame : infrared_frames ){
         if( !infrared_frame ){
             continue;
@@ -649,138 +1175,75 @@ inline void RealSense::saveInfrared()
 
         const uint8_t infrared_stream_index = infrared_frame.get_profile().stream_index();
         const uint8_t infrared_mat_index = ( infrared_stream_index != 0 ) ? infrared_stream_index - 1 : 0;
-        if( infrared_mats[infrared_mat_index].empty() ){
+        if( !infrared_updated[infrared_mat_index] || infrared_mats[infrared_mat_index].empty() ){
             continue;
         }
 
-        // Create Save Directory and File Name
-        std::ostringstream oss;
-        // Use cleaner directory names: IR for left (index 1), IR_Right for right (index 2)
-        if( infrared_stream_index == 2 ){
-            oss << directory.generic_string() << "/IR_Right/";
+        // Write Infrared Image to Video File
+        if( !video_fourcc.empty() ){
+            const std::string name = ( infrared_mat_index == 0 ) ? "ir" : "ir_right";
+            saveVideo( infrared_videos[infrared_mat_index], directory / getStreamDirectory( rs2_stream::RS2_STREAM_INFRARED, infrared_stream_index ), name, infrared_mats[infrared_mat_index], infrared_frame );
         }
         else{
-            oss << directory.generic_string() << "/IR/";
-        }
-        oss << std::setfill( '0' ) << std::setw( 6 ) << infrared_frame.get_frame_number() << ".jpg";
+            // Create Save Directory and File Name
+            std::ostringstream oss;
+            oss << directory.generic_string() << "/" << getStreamDirectory( rs2_stream::RS2_STREAM_INFRARED, infrared_stream_index ) << "/";
+            oss << std::setfill( '0' ) << std::setw( 6 ) << infrared_frame.get_frame_number() << infrared_profile.extension();
 
-        // Write Infrared Image
-        cv::imwrite( oss.str(), infrared_mats[infrared_mat_index], params );
+            // Write Infrared Image
+            encoder->write( oss.str(), infrared_mats[infrared_mat_index], infrared_profile.params, infrared_frame, encoder_group );
+        }
 
         // Save Metadata
-        std::ostringstream meta_oss;
-        if( infrared_stream_index == 2 ){
-            meta_oss << directory.generic_string() << "/IR_Right/metadata.csv";
-        }
-        else{
-            meta_oss << directory.generic_string() << "/IR/metadata.csv";
-        }
-        filesystem::path meta_path = meta_oss.str();
-        bool write_header = !filesystem::exists( meta_path );
-        std::ofstream meta_file( meta_oss.str(), std::ios::app );
-        if( meta_file.is_open() ){
-            if( write_header ){
-                meta_file << "frame_number,timestamp,width,height,format" << std::endl;
-            }
-            meta_file << std::fixed << std::setprecision( 6 );
-            meta_file << infrared_frame.get_frame_number() << ",";
-            meta_file << infrared_frame.get_timestamp() << ",";
-            meta_file << infrared_width << ",";
-            meta_file << infrared_height << ",";
-            meta_file << infrared_frame.get_profile().format() << std::endl;
-            meta_file.close();
+        std::unique_ptr<CsvWriter>& metadata = infrared_metadata[infrared_mat_index];
+        if( !metadata ){
+            metadata = std::make_unique<CsvWriter>( getCsvPath( directory / getStreamDirectory( rs2_stream::RS2_STREAM_INFRARED, infrared_stream_index ), "metadata" ), "frame_number,timestamp,width,height,format", flush_interval );
         }
+        metadata->write( infrared_frame.get_frame_number(), infrared_frame.get_timestamp(), infrared_mats[infrared_mat_index].cols, infrared_mats[infrared_mat_index].rows, rs2_format_to_string( infrared_frame.get_profile().format() ) );
+        commitFrame( infrared_frame );
     }
 }
 
 // Save Gyro
 inline void RealSense::saveGyro()
 {
-    if( !gyro_frame ){
-        return;
-    }
-
-    // Create IMU Directory if it doesn't exist
-    filesystem::path imu_dir = directory.generic_string() + "/IMU";
-    if( !filesystem::exists( imu_dir ) ){
-        filesystem::create_directories( imu_dir );
-    }
-
-    // Create Save Directory and File Name
-    std::ostringstream oss;
-    oss << directory.generic_string() << "/IMU/gyro_data.csv";
+    TRACE_SCOPE( "save/Gyro" );
 
-    // Open File (append mode)
-    std::ofstream file;
-    filesystem::path file_path = oss.str();
-
-    // Check if file exists to write header
-    bool write_header = !filesystem::exists( file_path );
-    file.open( oss.str(), std::ios::app );
-
-    if( !file.is_open() ){
+    if( !gyro_updated ){
         return;
     }
 
-    // Write Header
-    if( write_header ){
-        file << "frame_number,timestamp,x,y,z" << std::endl;
+    // Open Gyro CSV (Create IMU Directory if it doesn't exist)
+    if( !gyro_writer ){
+        const filesystem::path imu_directory = directory / "IMU";
+        filesystem::create_directories( imu_directory );
+        gyro_writer = std::make_unique<CsvWriter>( getCsvPath( imu_directory, "gyro_data" ), "frame_number,timestamp,x,y,z", flush_interval );
     }
 
     // Write Gyro Data
-    file << std::fixed << std::setprecision( 6 );
-    file << gyro_frame.get_frame_number() << ",";
-    file << gyro_timestamp << ",";
-    file << gyro_data.x << ",";
-    file << gyro_data.y << ",";
-    file << gyro_data.z << std::endl;
-
-    file.close();
+    gyro_writer->write( gyro_frame.get_frame_number(), gyro_timestamp, gyro_data.x, gyro_data.y, gyro_data.z );
+    commitFrame( gyro_frame );
 }
 
 // Save Accel
 inline void RealSense::saveAccel()
 {
-    if( !accel_frame ){
-        return;
-    }
+    TRACE_SCOPE( "save/Accel" );
 
-    // Create IMU Directory if it doesn't exist
-    filesystem::path imu_dir = directory.generic_string() + "/IMU";
-    if( !filesystem::exists( imu_dir ) ){
-        filesystem::create_directories( imu_dir );
-    }
-
-    // Create Save Directory and File Name
-    std::ostringstream oss;
-    oss << directory.generic_string() << "/IMU/accel_data.csv";
-
-    // Open File (append mode)
-    std::ofstream file;
-    filesystem::path file_path = oss.str();
-
-    // Check if file exists to write header
-    bool write_header = !filesystem::exists( file_path );
-    file.open( oss.str(), std::ios::app );
-
-    if( !file.is_open() ){
+    if( !accel_updated ){
         return;
     }
 
-    // Write Header
-    if( write_header ){
-        file << "frame_number,timestamp,x,y,z" << std::endl;
+    // Open Accel CSV (Create IMU Directory if it doesn't exist)
+    if( !accel_writer ){
+        const filesystem::path imu_directory = directory / "IMU";
+        filesystem::create_directories( imu_directory );
+        accel_writer = std::make_unique<CsvWriter>( getCsvPath( imu_directory, "accel_data" ), "frame_number,timestamp,x,y,z", flush_interval );
     }
 
     // Write Accel Data
-    file << std::fixed << std::setprecision( 6 );
-    file << accel_frame.get_frame_number() << ",";
-    file << accel_timestamp << ",";
-    file << accel_data.x << ",";
-    file << accel_data.y << ",";
-    file << accel_data.z << std::endl;
-
-    file.close();
+    accel_writer->write( accel_frame.get_frame_number(), accel_timestamp, accel_data.x, accel_data.y, accel_data.z );
+    commitFrame( accel_frame );
 }
 
 // Show Progress Bar
@@ -790,9 +1253,15 @@ inline void RealSense::showProgress( uint64_t current_position )
         return;
     }
 
-    // Calculate percentage
-    double percentage = ( static_cast<double>( current_position ) / static_cast<double>( total_duration ) ) * 100.0;
+    // Calculate percentage (in Extraction Range)
+    const uint64_t range_position = ( current_position > start_position ) ? current_position - start_position : 0;
+    double percentage = ( static_cast<double>( range_position ) / static_cast<double>( end_position - start_position ) ) * 100.0;
     percentage = std::min( percentage, 100.0 );
+    progress = percentage / 100.0;
+
+    if( quiet ){
+        return;
+    }
 
     // Create progress bar
     const int bar_width = 50;
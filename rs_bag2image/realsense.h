@@ -5,45 +5,80 @@
 #include <opencv2/opencv.hpp>
 
 #include <array>
-
-#if __has_include(<filesystem>)
-#include <filesystem>
-namespace filesystem = std::filesystem;
-#else
-#include <experimental/filesystem>
-#if _WIN32
-namespace filesystem = std::experimental::filesystem::v1;
-#else
-namespace filesystem = std::experimental::filesystem;
-#endif
-#endif
+#include <atomic>
+#include <memory>
+#include <set>
+
+#include "align.h"
+#include "archive.h"
+#include "checkpoint.h"
+#include "cloud.h"
+#include "colorize.h"
+#include "convert.h"
+#include "encoder.h"
+#include "filesystem.h"
+#include "filter.h"
+#include "imu.h"
+#include "parameter.h"
+#include "preview.h"
+#include "reader.h"
+#include "stack.h"
+#include "trace.h"
+#include "video.h"
+#include "writer.h"
 
 class RealSense
 {
 private:
-    // RealSense
-    rs2::pipeline pipeline;
-    rs2::pipeline_profile pipeline_profile;
+    // Bag Reader
+    std::unique_ptr<BagReader> reader;
     rs2::frameset frameset;
 
     // Color Buffer
     rs2::frame color_frame;
     cv::Mat color_mat;
+    BufferRing color_buffers;
     uint32_t color_width;
     uint32_t color_height;
 
     // Depth Buffer
     rs2::frame depth_frame;
     cv::Mat depth_mat;
+    cv::Mat depth_visual_mat;           // 8bit gray or colormapped depth for show and save
+    BufferRing depth_buffers;
+    BufferRing depth_visual_buffers;
+    DepthColorizer depth_colorizer;
     uint32_t depth_width;
     uint32_t depth_height;
 
     // Infrared Buffer
     std::array<rs2::frame, 2> infrared_frames;
     std::array<cv::Mat, 2> infrared_mats;
+    std::array<BufferRing, 2> infrared_buffers;
     uint32_t infrared_width;
     uint32_t infrared_height;
 
+    // New Frames of Current Frameset to be Written
+    // Frames repeated by syncer, carried over from previous frameset, subsampled, out of segment or saved by previous extraction
+    // are not converted and saved.
+    bool color_updated = false;
+    bool depth_updated = false;
+    std::array<bool, 2> infrared_updated = {};
+    bool gyro_updated = false;
+    bool accel_updated = false;
+    std::map<StreamKey, std::pair<unsigned long long, double>> last_frames;   // frame number and timestamp of last new frame of each stream
+    uint64_t duplicate_count = 0;
+
+    // Temporal Subsampling of Image Streams (Skipped Frames are not Converted)
+    TemporalSampler sampler;
+    bool sampled = true;                    // current frameset is kept (one decision for all image streams)
+    uint64_t subsampled_count = 0;
+
+    // Spatial Transform of Images (Cropped and Scaled while Converting)
+    FrameTransform color_transform;
+    FrameTransform depth_transform;
+    FrameTransform infrared_transform;
+
     // IMU Buffer
     rs2::frame gyro_frame;
     rs2::frame accel_frame;
@@ -53,46 +88,162 @@ private:
     double accel_timestamp;
 
     filesystem::path bag_file;
+    filesystem::path output_directory;
     filesystem::path directory;
-    std::vector<int32_t> params;
     bool scaling = false;
     bool display = false;
 
+    // Encoder Profiles
+    EncoderProfile color_profile;
+    EncoderProfile depth_profile;
+    EncoderProfile infrared_profile;
+
+    // Preview Window (Only in Display Mode)
+    std::unique_ptr<Preview> preview;
+
+    // Image Encoder (Pipelined with Worker Threads, Shared between Extractions)
+    std::shared_ptr<Encoder> encoder;
+    std::shared_ptr<Encoder::Group> encoder_group;
+
+    // CSV Writers (Metadata and IMU)
+    std::unique_ptr<CsvWriter> color_metadata;
+    std::unique_ptr<CsvWriter> depth_metadata;
+    std::array<std::unique_ptr<CsvWriter>, 2> infrared_metadata;
+    std::unique_ptr<CsvWriter> gyro_writer;
+    std::unique_ptr<CsvWriter> accel_writer;
+
+    // Depth Filter Stage (Post-Processing Filters of Depth on Its Own Thread, Framesets are Read Ahead)
+    std::unique_ptr<DepthFilter> depth_filter;
+    std::string depth_filter_chain;
+    rs2::frame filtered_depth_frame;
+    bool playback_ended = false;
+
+    // Depth Stack Writer (Raw Depth of All Frames in One File instead of PNG Files)
+    std::unique_ptr<DepthStack> depth_stack;
+    std::string depth_stack_layout;
+
+    // Video Writers (Color and Infrared to Video File instead of JPEG Files)
+    std::unique_ptr<VideoStream> color_video;
+    std::array<std::unique_ptr<VideoStream>, 2> infrared_videos;
+    std::string video_fourcc;
+    std::chrono::steady_clock::duration flush_interval;
+
+    // Archive (Images and CSV Files Appended to One Tar or Zip File instead of Files)
+    std::shared_ptr<Archive> archive;
+    std::string archive_format;
+
+    // Aligned Images (Depth to Color and Color to Depth, Aligned on Encoder Worker Threads)
+    bool align_depth = false;
+    bool align_color = false;
+    rs2::stream_profile color_stream_profile;
+    std::shared_ptr<const DepthAligner> aligner;    // ray tables cached for stream profiles
+    EncoderProfile aligned_depth_profile;
+
+    // Point Cloud Writer (Deprojection of Depth on Its Own Thread)
+    std::unique_ptr<CloudStream> cloud_stream;
+    std::string cloud_format;
+    uint32_t cloud_stride = 1;
+    double cloud_voxel = 0.0;
+    bool cloud_texture = false;
+    uint64_t untextured_count = 0;                  // depth frames without color frame in frameset (no point cloud with texture)
+
+    // IMU Reader (Lossless IMU Extraction with Sensor Callbacks)
+    std::unique_ptr<ImuReader> imu;
+    bool imu_lossless = false;
+
+    // Extraction Range (Playback Position in Nanoseconds)
+    uint64_t start_position;
+    uint64_t end_position;
+
+    // Sharded Extraction (Segment Index and Timestamp Range of Each Stream)
+    int32_t shard = -1;
+    std::map<StreamKey, std::pair<double, double>> timestamp_ranges;
+
+    // Resumable Extraction (Checkpoint Manifest in Output Directory)
+    std::unique_ptr<Checkpoint> checkpoint;
+    std::map<StreamKey, double> resume_timestamps;  // last saved timestamp of each stream in previous extraction
+    bool resume = false;
+    bool completed = false;                         // previous extraction has already finished
+    std::chrono::steady_clock::duration checkpoint_interval;
+    std::chrono::steady_clock::time_point last_checkpoint;
+
     // Progress tracking
     uint64_t total_duration;
     uint64_t frame_count;
+    std::atomic<double> progress{ 0.0 };
+    bool quiet = false;
 
 public:
     // Constructor
     RealSense( int argc, char* argv[] );
 
+    // Constructor
+    // Use shared encoder if specified, otherwise create own encoder.
+    RealSense( const Parameter& parameter, const std::shared_ptr<Encoder>& encoder = nullptr );
+
     // Destructor
     ~RealSense();
 
     // Processing
     void run();
 
+    // Retrieve Progress [0.0-1.0]
+    double getProgress() const;
+
 private:
     // Initialize
-    void initialize( int argc, char * argv[] );
+    void initialize( const Parameter& parameter, const std::shared_ptr<Encoder>& encoder );
 
     // Initialize Parameter
-    inline void initializeParameter( int argc, char* argv[] );
+    inline void initializeParameter( const Parameter& parameter );
 
     // Initialize Sensor
-    inline void initializeSensor();
+    inline void initializeSensor( const Parameter& parameter );
 
     // Initialize Save
     inline void initializeSave();
 
+    // Initialize Checkpoint (Restore Output Directory and Seek to Last Checkpoint in Resume Mode)
+    inline void initializeCheckpoint();
+
+    // Check Frame is in Timestamp Range of Segment (Sharded Extraction)
+    inline bool isInSegment( const rs2::frame& frame );
+
+    // Check Frame has been Saved by Previous Extraction (Resume Mode)
+    inline bool isSaved( const rs2::frame& frame );
+
+    // Record Saved Frame for Checkpoint
+    inline void commitFrame( const rs2::frame& frame );
+
+    // Write Checkpoint (Wait for Pending Images and Flush CSV Files)
+    inline void writeCheckpoint( uint64_t position, bool complete );
+
+    // Retrieve CSV File Path (Part File of Segment in Sharded Extraction)
+    inline filesystem::path getCsvPath( const filesystem::path& sub_directory, const std::string& name );
+
+    // Retrieve Sub Directory Name of Stream
+    inline std::string getStreamDirectory( rs2_stream stream_type, int32_t stream_index );
+
+    // Close Archive (Append CSV Files and Remove Empty Sub Directories)
+    inline void closeArchive();
+
     // Finalize
     void finalize();
 
     // Update Data
-    void update();
+    // Return false at end of extraction range or end of file.
+    bool update();
 
     // Update Frame
-    inline void updateFrame();
+    inline bool updateFrame();
+
+    // Check Frame is New (Not Same Frame Number and Timestamp as Last Frame of Stream)
+    // Count the frame as duplicate if it is not new.
+    inline bool isNewFrame( const rs2::frame& frame );
+
+    // Check Frame is Kept by Temporal Subsampling (Decision of Current Frameset)
+    // Count the frame as subsampled if it is not kept.
+    inline bool isSampled();
 
     // Update Color
     inline void updateColor();
@@ -142,6 +293,18 @@ private:
     // Save Depth
     inline void saveDepth();
 
+    // Save Video Frame (Open Video File at First Frame)
+    inline void saveVideo( std::unique_ptr<VideoStream>& video, const filesystem::path& sub_directory, const std::string& name, const cv::Mat& image, const rs2::frame& frame );
+
+    // Save Depth Stack
+    inline void saveDepthStack();
+
+    // Save Aligned Images
+    inline void saveAligned();
+
+    // Save Point Cloud
+    inline void saveCloud();
+
     // Save Infrared
     inline void saveInfrared();
 
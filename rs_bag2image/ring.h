@@ -0,0 +1,69 @@
+#ifndef __RING__
+#define __RING__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-Free Single Producer Single Consumer Ring Buffer
+// push() must be called from only one thread, and pop() from only one (other) thread.
+template<typename T>
+class SpscRing
+{
+private:
+    std::vector<T> buffer;
+    std::size_t mask;
+
+    // Indices (on separate cache lines to avoid false sharing)
+    alignas( 64 ) std::atomic<std::size_t> head{ 0 }; // next slot to pop
+    alignas( 64 ) std::atomic<std::size_t> tail{ 0 }; // next slot to push
+
+public:
+    // Constructor
+    // Capacity is rounded up to the power of two.
+    explicit SpscRing( std::size_t capacity )
+    {
+        std::size_t size = 2;
+        while( size < capacity ){
+            size <<= 1;
+        }
+        buffer.resize( size );
+        mask = size - 1;
+    }
+
+    // Push Item (Producer)
+    // Return false if the ring is full.
+    bool push( const T& item )
+    {
+        const std::size_t current_tail = tail.load( std::memory_order_relaxed );
+        if( current_tail - head.load( std::memory_order_acquire ) == buffer.size() ){
+            return false;
+        }
+
+        buffer[current_tail & mask] = item;
+        tail.store( current_tail + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Pop Item (Consumer)
+    // Return false if the ring is empty.
+    bool pop( T& item )
+    {
+        const std::size_t current_head = head.load( std::memory_order_relaxed );
+        if( current_head == tail.load( std::memory_order_acquire ) ){
+            return false;
+        }
+
+        item = buffer[current_head & mask];
+        head.store( current_head + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Check Empty
+    bool empty() const
+    {
+        return head.load( std::memory_order_acquire ) == tail.load( std::memory_order_acquire );
+    }
+};
+
+#endif // __RING__
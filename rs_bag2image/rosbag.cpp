@@ -0,0 +1,504 @@
+#include "rosbag.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <set>
+#include <stdexcept>
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#ifdef HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+namespace
+{
+    // Operation of Record
+    constexpr uint8_t op_message_data = 0x02;
+    constexpr uint8_t op_bag_header = 0x03;
+    constexpr uint8_t op_index_data = 0x04;
+    constexpr uint8_t op_chunk = 0x05;
+    constexpr uint8_t op_chunk_info = 0x06;
+    constexpr uint8_t op_connection = 0x07;
+
+    // Field of Record Header (Value and Length)
+    using Field = std::pair<const uint8_t*, uint32_t>;
+
+    // Load Little Endian Integer
+    inline uint32_t loadUint32( const uint8_t* data )
+    {
+        return static_cast<uint32_t>( data[0] ) | ( static_cast<uint32_t>( data[1] ) << 8 ) | ( static_cast<uint32_t>( data[2] ) << 16 ) | ( static_cast<uint32_t>( data[3] ) << 24 );
+    }
+
+    inline uint64_t loadUint64( const uint8_t* data )
+    {
+        return static_cast<uint64_t>( loadUint32( data ) ) | ( static_cast<uint64_t>( loadUint32( data + 4 ) ) << 32 );
+    }
+
+    // Load Time (uint32 secs, uint32 nsecs) [ns]
+    inline uint64_t loadTime( const uint8_t* data )
+    {
+        return static_cast<uint64_t>( loadUint32( data ) ) * 1000000000 + loadUint32( data + 4 );
+    }
+
+    // Read Record at Position of Buffer
+    // Return position of next record.
+    inline std::size_t readRecord( const uint8_t* buffer, std::size_t size, std::size_t position, Field& header, Field& data )
+    {
+        if( size < position || size - position < 4 ){
+            throw std::runtime_error( "failed corrupted bag file" );
+        }
+        header = { buffer + position + 4, loadUint32( buffer + position ) };
+        position += 4 + static_cast<std::size_t>( header.second );
+
+        if( size < position || size - position < 4 ){
+            throw std::runtime_error( "failed corrupted bag file" );
+        }
+        data = { buffer + position + 4, loadUint32( buffer + position ) };
+        position += 4 + static_cast<std::size_t>( data.second );
+
+        if( size < position ){
+            throw std::runtime_error( "failed corrupted bag file" );
+        }
+        return position;
+    }
+
+    // Find Field of Record Header (Fields of int32 field_len, name=value)
+    // Return empty field if the header has no field of name.
+    inline Field findField( const Field& header, const char* name )
+    {
+        const std::size_t name_size = std::strlen( name );
+        std::size_t position = 0;
+        while( position + 4 <= header.second ){
+            const uint32_t field_size = loadUint32( header.first + position );
+            const uint8_t* field = header.first + position + 4;
+            position += 4 + static_cast<std::size_t>( field_size );
+            if( header.second < position ){
+                break;
+            }
+            if( name_size < field_size && field[name_size] == '=' && std::memcmp( field, name, name_size ) == 0 ){
+                return { field + name_size + 1, static_cast<uint32_t>( field_size - name_size - 1 ) };
+            }
+        }
+        return { nullptr, 0 };
+    }
+
+    // Retrieve Field Value
+    inline uint8_t getOp( const Field& header )
+    {
+        const Field field = findField( header, "op" );
+        if( field.second != 1 ){
+            throw std::runtime_error( "failed corrupted bag file" );
+        }
+        return field.first[0];
+    }
+
+    inline uint32_t getUint32( const Field& header, const char* name )
+    {
+        const Field field = findField( header, name );
+        if( field.second != 4 ){
+            throw std::runtime_error( "failed corrupted bag file" );
+        }
+        return loadUint32( field.first );
+    }
+
+    inline uint64_t getUint64( const Field& header, const char* name )
+    {
+        const Field field = findField( header, name );
+        if( field.second != 8 ){
+            throw std::runtime_error( "failed corrupted bag file" );
+        }
+        return loadUint64( field.first );
+    }
+
+    inline std::string getString( const Field& header, const char* name )
+    {
+        const Field field = findField( header, name );
+        return std::string( reinterpret_cast<const char*>( field.first ), field.second );
+    }
+}
+
+// Constructor
+RosBag::RosBag( const filesystem::path& path, uint32_t threads )
+    : window( 2 * std::max<std::size_t>( ( threads != 0 ) ? threads : std::thread::hardware_concurrency(), 1 ) ), tasks( window )
+{
+    // Map File
+    map( path );
+
+    // Read Connections and Index
+    try{
+        readIndex();
+    }
+    catch( ... ){
+        unmap();
+        throw;
+    }
+
+    // Start Decompression Threads
+    for( std::size_t i = 0; i < window / 2; i++ ){
+        workers.emplace_back( &RosBag::work, this );
+    }
+}
+
+// Destructor
+RosBag::~RosBag()
+{
+    // Stop Decompression Threads (after Queued Tasks)
+    tasks.close();
+    for( std::thread& worker : workers ){
+        worker.join();
+    }
+
+    // Unmap File
+    unmap();
+}
+
+// Map File
+inline void RosBag::map( const filesystem::path& path )
+{
+#if _WIN32
+    file_handle = CreateFileW( path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if( file_handle == INVALID_HANDLE_VALUE ){
+        file_handle = nullptr;
+        throw std::runtime_error( "failed can't open bag file" );
+    }
+    LARGE_INTEGER size = {};
+    GetFileSizeEx( file_handle, &size );
+    file_size = static_cast<std::size_t>( size.QuadPart );
+    mapping_handle = ( file_size != 0 ) ? CreateFileMappingW( file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr ) : nullptr;
+    file = ( mapping_handle != nullptr ) ? static_cast<const uint8_t*>( MapViewOfFile( mapping_handle, FILE_MAP_READ, 0, 0, 0 ) ) : nullptr;
+#else
+    file_descriptor = open( path.string().c_str(), O_RDONLY );
+    if( file_descriptor < 0 ){
+        throw std::runtime_error( "failed can't open bag file" );
+    }
+    struct stat status = {};
+    fstat( file_descriptor, &status );
+    file_size = static_cast<std::size_t>( status.st_size );
+    void* address = ( file_size != 0 ) ? mmap( nullptr, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0 ) : MAP_FAILED;
+    file = ( address != MAP_FAILED ) ? static_cast<const uint8_t*>( address ) : nullptr;
+    if( file != nullptr ){
+        // Chunks are Read Mostly in File Order
+        madvise( address, file_size, MADV_SEQUENTIAL );
+    }
+#endif
+
+    if( file == nullptr ){
+        unmap();
+        throw std::runtime_error( "failed can't map bag file" );
+    }
+}
+
+// Unmap File
+inline void RosBag::unmap()
+{
+#if _WIN32
+    if( file != nullptr ){
+        UnmapViewOfFile( file );
+    }
+    if( mapping_handle != nullptr ){
+        CloseHandle( mapping_handle );
+    }
+    if( file_handle != nullptr ){
+        CloseHandle( file_handle );
+    }
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    if( file != nullptr ){
+        munmap( const_cast<uint8_t*>( file ), file_size );
+    }
+    if( file_descriptor >= 0 ){
+        close( file_descriptor );
+    }
+    file_descriptor = -1;
+#endif
+    file = nullptr;
+    file_size = 0;
+}
+
+// Read Connection and Chunk Info Records
+inline void RosBag::readIndex()
+{
+    // Check Format Version
+    constexpr char magic[] = "#ROSBAG V2.0\n";
+    constexpr std::size_t magic_size = sizeof( magic ) - 1;
+    if( file_size < magic_size || std::memcmp( file, magic, magic_size ) != 0 ){
+        throw std::runtime_error( "failed bag file is not rosbag format version 2.0" );
+    }
+
+    // Read Bag Header
+    Field header, data;
+    readRecord( file, file_size, magic_size, header, data );
+    if( getOp( header ) != op_bag_header ){
+        throw std::runtime_error( "failed corrupted bag file" );
+    }
+    const uint64_t index_position = getUint64( header, "index_pos" );
+    if( index_position == 0 || file_size <= index_position ){
+        throw std::runtime_error( "failed bag file is not indexed" );
+    }
+
+    // Read Connection and Chunk Info Records (after Last Chunk)
+    std::size_t position = static_cast<std::size_t>( index_position );
+    while( position < file_size ){
+        position = readRecord( file, file_size, position, header, data );
+        const uint8_t op = getOp( header );
+        if( op == op_connection ){
+            // Connection Header is Stored as Data
+            Connection connection;
+            connection.id = getUint32( header, "conn" );
+            connection.topic = getString( header, "topic" );
+            connection.type = getString( data, "type" );
+            connections.push_back( connection );
+        }
+        else if( op == op_chunk_info ){
+            ChunkInfo chunk;
+            chunk.position = getUint64( header, "chunk_pos" );
+            chunks.push_back( chunk );
+        }
+    }
+    std::sort( connections.begin(), connections.end(), []( const Connection& a, const Connection& b ){ return a.id < b.id; } );
+    std::sort( chunks.begin(), chunks.end(), []( const ChunkInfo& a, const ChunkInfo& b ){ return a.position < b.position; } );
+
+    // Read Index Data Records of Each Chunk
+    for( ChunkInfo& chunk : chunks ){
+        readChunkIndex( chunk );
+    }
+
+    // Check Index Entries Refer to Connections
+    std::set<uint32_t> ids;
+    for( const Connection& connection : connections ){
+        ids.insert( connection.id );
+    }
+    for( const ChunkInfo& chunk : chunks ){
+        for( const IndexEntry& entry : chunk.entries ){
+            if( ids.count( entry.connection ) == 0 ){
+                throw std::runtime_error( "failed corrupted bag file" );
+            }
+        }
+    }
+}
+
+// Read Index Data Records that Follow Chunk
+inline void RosBag::readChunkIndex( ChunkInfo& chunk )
+{
+    Field header, data;
+    std::size_t position = readRecord( file, file_size, static_cast<std::size_t>( chunk.position ), header, data );
+    if( getOp( header ) != op_chunk ){
+        throw std::runtime_error( "failed corrupted bag file" );
+    }
+
+    while( position < file_size ){
+        const std::size_t next = readRecord( file, file_size, position, header, data );
+        if( getOp( header ) != op_index_data ){
+            break;
+        }
+        position = next;
+
+        // Entries (time, uint32 offset)
+        if( getUint32( header, "ver" ) != 1 ){
+            throw std::runtime_error( "failed unsupported index version of bag file" );
+        }
+        const uint32_t connection = getUint32( header, "conn" );
+        const uint32_t count = getUint32( header, "count" );
+        if( data.second < static_cast<uint64_t>( count ) * 12 ){
+            throw std::runtime_error( "failed corrupted bag file" );
+        }
+        for( uint32_t i = 0; i < count; i++ ){
+            const uint8_t* entry = data.first + static_cast<std::size_t>( i ) * 12;
+            chunk.entries.push_back( { loadTime( entry ), connection, loadUint32( entry + 8 ) } );
+        }
+    }
+
+    std::sort( chunk.entries.begin(), chunk.entries.end(), []( const IndexEntry& a, const IndexEntry& b ){ return ( a.time != b.time ) ? a.time < b.time : a.offset < b.offset; } );
+}
+
+// Find Connection of Topic
+const RosBag::Connection* RosBag::findConnection( const std::string& topic ) const
+{
+    const std::vector<Connection>::const_iterator found = std::find_if( connections.begin(), connections.end(), [&]( const Connection& connection ){ return connection.topic == topic; } );
+    return ( found != connections.end() ) ? &*found : nullptr;
+}
+
+// Select Connections to Read from Time [ns]
+void RosBag::select( const std::vector<uint32_t>& connections, uint64_t time )
+{
+    // Discard Chunks of Previous Selection (Queued Decompressions are Abandoned)
+    plan.clear();
+    loading.clear();
+    pending = decltype( pending )();
+    next_chunk = 0;
+    next_task = 0;
+
+    // Plan Chunks that have Messages of Selected Connections
+    // Chunks are merged in order of their first selected message, so a message is returned only after
+    // all chunks that may have earlier messages have been loaded.
+    const std::set<uint32_t> selected( connections.begin(), connections.end() );
+    for( std::size_t i = 0; i < chunks.size(); i++ ){
+        PlannedChunk planned_chunk = { i, 0, {} };
+        for( const IndexEntry& entry : chunks[i].entries ){
+            if( time <= entry.time && selected.count( entry.connection ) != 0 ){
+                planned_chunk.entries.push_back( entry );
+            }
+        }
+        if( !planned_chunk.entries.empty() ){
+            planned_chunk.start_time = planned_chunk.entries.front().time;
+            plan.push_back( std::move( planned_chunk ) );
+        }
+    }
+    std::stable_sort( plan.begin(), plan.end(), []( const PlannedChunk& a, const PlannedChunk& b ){ return a.start_time < b.start_time; } );
+
+    // Start Decompression of First Chunks
+    schedule();
+}
+
+// Read Next Message of Selected Connections in Time Order
+bool RosBag::next( Message& message )
+{
+    // Merge Chunks that may have Earlier Messages than Next Pending Message
+    while( next_chunk < plan.size() && ( pending.empty() || plan[next_chunk].start_time < pending.top().entry.time ) ){
+        std::shared_ptr<const Chunk> chunk;
+        {
+            TRACE_SCOPE( "rosbag/wait" );
+            chunk = loading.front().get();
+        }
+        loading.pop_front();
+
+        for( const IndexEntry& entry : plan[next_chunk].entries ){
+            pending.push( { entry, next_chunk, chunk } );
+        }
+        std::vector<IndexEntry>().swap( plan[next_chunk].entries );
+        next_chunk++;
+
+        schedule();
+    }
+
+    if( pending.empty() ){
+        return false;
+    }
+
+    // Read Message Data Record at Offset of Uncompressed Chunk
+    const Pending top = pending.top();
+    pending.pop();
+
+    Field header, data;
+    readRecord( top.chunk->data, top.chunk->size, top.entry.offset, header, data );
+    if( getOp( header ) != op_message_data ){
+        throw std::runtime_error( "failed corrupted bag file" );
+    }
+
+    message.connection = top.entry.connection;
+    message.time = top.entry.time;
+    message.data = data.first;
+    message.size = data.second;
+    message.chunk = top.chunk;
+    return true;
+}
+
+// Load Chunk (Decompress)
+inline std::shared_ptr<const RosBag::Chunk> RosBag::load( std::size_t index ) const
+{
+    Field header, data;
+    readRecord( file, file_size, static_cast<std::size_t>( chunks[index].position ), header, data );
+    const std::string compression = getString( header, "compression" );
+    const uint32_t size = getUint32( header, "size" );
+
+    // Uncompressed Chunk Refers to Mapped File
+    std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+    if( compression == "none" ){
+        chunk->data = data.first;
+        chunk->size = data.second;
+        return chunk;
+    }
+
+    chunk->buffer.resize( size );
+    chunk->data = chunk->buffer.data();
+    chunk->size = chunk->buffer.size();
+
+    if( compression == "lz4" ){
+        #ifdef HAVE_LZ4
+        // LZ4 Frame
+        LZ4F_dctx* context = nullptr;
+        if( LZ4F_isError( LZ4F_createDecompressionContext( &context, LZ4F_VERSION ) ) ){
+            throw std::runtime_error( "failed can't create lz4 decompression context" );
+        }
+        std::size_t source_offset = 0;
+        std::size_t destination_offset = 0;
+        std::size_t result = 1;
+        while( result != 0 && source_offset < data.second ){
+            std::size_t source_size = data.second - source_offset;
+            std::size_t destination_size = chunk->buffer.size() - destination_offset;
+            result = LZ4F_decompress( context, chunk->buffer.data() + destination_offset, &destination_size, data.first + source_offset, &source_size, nullptr );
+            if( LZ4F_isError( result ) || ( source_size == 0 && destination_size == 0 ) ){
+                break;
+            }
+            source_offset += source_size;
+            destination_offset += destination_size;
+        }
+        LZ4F_freeDecompressionContext( context );
+        if( LZ4F_isError( result ) || destination_offset != chunk->buffer.size() ){
+            throw std::runtime_error( "failed can't decompress lz4 chunk of bag file" );
+        }
+        #else
+        throw std::runtime_error( "failed lz4 chunk of bag file is not supported (build with lz4)" );
+        #endif
+    }
+    else if( compression == "bz2" ){
+        #ifdef HAVE_BZIP2
+        unsigned int destination_size = size;
+        const int result = BZ2_bzBuffToBuffDecompress( reinterpret_cast<char*>( chunk->buffer.data() ), &destination_size, const_cast<char*>( reinterpret_cast<const char*>( data.first ) ), data.second, 0, 0 );
+        if( result != BZ_OK || destination_size != size ){
+            throw std::runtime_error( "failed can't decompress bz2 chunk of bag file" );
+        }
+        #else
+        throw std::runtime_error( "failed bz2 chunk of bag file is not supported (build with bzip2)" );
+        #endif
+    }
+    else{
+        throw std::runtime_error( "failed unsupported compression of bag file " + compression );
+    }
+
+    countProfile( "bytes/decompress", size );
+    return chunk;
+}
+
+// Queue Decompression of Planned Chunks within Window
+inline void RosBag::schedule()
+{
+    while( next_task < plan.size() && loading.size() < window ){
+        Task task;
+        task.chunk = plan[next_task++].chunk;
+        loading.push_back( task.promise.get_future() );
+        tasks.push( std::move( task ) );
+    }
+}
+
+// Decompression Thread
+void RosBag::work()
+{
+    Profiler::instance().setThreadName( "rosbag" );
+
+    Task task;
+    while( tasks.pop( task ) ){
+        try{
+            TRACE_SCOPE( "rosbag/decompress" );
+            task.promise.set_value( load( task.chunk ) );
+        }
+        catch( ... ){
+            task.promise.set_exception( std::current_exception() );
+        }
+    }
+}
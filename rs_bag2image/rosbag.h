@@ -0,0 +1,177 @@
+#ifndef __ROSBAG__
+#define __ROSBAG__
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filesystem.h"
+#include "queue.h"
+
+// ROS Bag Reader (Format Version 2.0)
+// Memory-maps bag file and reads messages of selected connections in time order without librealsense.
+// Connections, chunk info and index records are parsed at open, so time and location of every message are
+// known without decompressing chunks. Chunks are decompressed (none, lz4 or bz2) ahead on worker threads,
+// and messages of chunks are merged by time on the reading thread.
+//
+// Record
+//   int32 header_len, header (fields of int32 field_len, name=value), int32 data_len, data
+//   op=0x02 message data, 0x03 bag header, 0x04 index data, 0x05 chunk, 0x06 chunk info, 0x07 connection
+class RosBag
+{
+public:
+    // Connection (Topic)
+    struct Connection
+    {
+        uint32_t id = 0;
+        std::string topic;
+        std::string type;
+    };
+
+    // Message
+    // Data refers to the chunk buffer that is kept alive by the message.
+    struct Message
+    {
+        uint32_t connection = 0;
+        uint64_t time = 0;                  // receive time [ns]
+        const uint8_t* data = nullptr;      // serialized message
+        std::size_t size = 0;
+        std::shared_ptr<const void> chunk;
+    };
+
+private:
+    // Index Entry (Message Location in Uncompressed Chunk)
+    struct IndexEntry
+    {
+        uint64_t time;
+        uint32_t connection;
+        uint32_t offset;
+    };
+
+    // Chunk (Chunk Info and Index Records)
+    struct ChunkInfo
+    {
+        uint64_t position;                  // bytes from beginning of file to chunk record
+        std::vector<IndexEntry> entries;    // sorted by time
+    };
+
+    // Uncompressed Chunk Data
+    struct Chunk
+    {
+        std::vector<uint8_t> buffer;        // empty if chunk is not compressed (data refers to mapped file)
+        const uint8_t* data;
+        std::size_t size;
+    };
+
+    // Planned Chunk of Reading (Chunks are Loaded in Order of First Selected Message)
+    struct PlannedChunk
+    {
+        std::size_t chunk;
+        uint64_t start_time;
+        std::vector<IndexEntry> entries;
+    };
+
+    // Pending Message of Merge
+    struct Pending
+    {
+        IndexEntry entry;
+        std::size_t order;                  // index of planned chunk (earlier chunk first on same time)
+        std::shared_ptr<const Chunk> chunk;
+
+        bool operator>( const Pending& pending ) const
+        {
+            if( entry.time != pending.entry.time ){
+                return entry.time > pending.entry.time;
+            }
+            if( order != pending.order ){
+                return order > pending.order;
+            }
+            return entry.offset > pending.entry.offset;
+        }
+    };
+
+    // Decompression Task
+    struct Task
+    {
+        std::size_t chunk;
+        std::promise<std::shared_ptr<const Chunk>> promise;
+    };
+
+    // Mapped File
+    const uint8_t* file = nullptr;
+    std::size_t file_size = 0;
+    #if _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+    #else
+    int file_descriptor = -1;
+    #endif
+
+    // Records
+    std::vector<Connection> connections;
+    std::vector<ChunkInfo> chunks;
+
+    // Reading
+    std::vector<PlannedChunk> plan;
+    std::size_t next_chunk = 0;         // next planned chunk to merge
+    std::size_t next_task = 0;          // next planned chunk to decompress
+    std::deque<std::future<std::shared_ptr<const Chunk>>> loading;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+
+    // Decompression Workers
+    std::size_t window;
+    BoundedQueue<Task> tasks;
+    std::vector<std::thread> workers;
+
+public:
+    // Constructor
+    // Open bag file and read connections and index. threads is number of decompression threads, 0 is number of cores.
+    explicit RosBag( const filesystem::path& path, uint32_t threads = 0 );
+
+    // Destructor
+    ~RosBag();
+
+    RosBag( const RosBag& ) = delete;
+    RosBag& operator=( const RosBag& ) = delete;
+
+    // Find Connection of Topic
+    // Return nullptr if the bag has no connection of topic.
+    const Connection* findConnection( const std::string& topic ) const;
+
+    // Select Connections to Read from Time [ns]
+    // Reading restarts at first message of selected connections at or after time.
+    void select( const std::vector<uint32_t>& connections, uint64_t time = 0 );
+
+    // Read Next Message of Selected Connections in Time Order
+    // Return false at end of file.
+    bool next( Message& message );
+
+private:
+    // Map File
+    inline void map( const filesystem::path& path );
+
+    // Unmap File
+    inline void unmap();
+
+    // Read Connection and Chunk Info Records
+    inline void readIndex();
+
+    // Read Index Data Records that Follow Chunk
+    inline void readChunkIndex( ChunkInfo& chunk );
+
+    // Load Chunk (Decompress)
+    inline std::shared_ptr<const Chunk> load( std::size_t index ) const;
+
+    // Queue Decompression of Planned Chunks within Window
+    inline void schedule();
+
+    // Decompression Thread
+    void work();
+};
+
+#endif // __ROSBAG__
@@ -0,0 +1,295 @@
+#include "shard.h"
+#include "realsense.h"
+#include "trace.h"
+#include "version.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <regex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Margin of Segment (Playback Position in Nanoseconds)
+    // Each segment reads this margin beyond its boundaries to cover frames recorded out of order.
+    constexpr uint64_t segment_margin = 1000000000;
+
+    // Scan Limit of First Frames (Playback Position in Nanoseconds)
+    constexpr uint64_t scan_limit = 5000000000;
+}
+
+// Constructor
+Sharding::Sharding( const Parameter& parameter, const std::shared_ptr<Encoder>& encoder )
+    : parameter( parameter )
+{
+    if( !parameter.quiet ){
+        std::cout << "rs_bag2image " << RS_BAG2IMAGE_VERSION << " (" << parameter.shards << " shards)" << std::endl;
+    }
+
+    // Encoder Shared by Segments
+    this->encoder = ( encoder ) ? encoder : std::make_shared<Encoder>( parameter.jobs, parameter.write_behind );
+
+    // Initialize Range
+    initializeRange();
+}
+
+// Processing
+void Sharding::run()
+{
+    // Create Root Directory (Bag File Name)
+    directory = ( parameter.output_directory.empty() ? parameter.bag_file.parent_path() : parameter.output_directory ) / parameter.bag_file.stem();
+    if( !filesystem::create_directories( directory ) ){
+        throw std::runtime_error( "failed can't create root directory" );
+    }
+
+    // Create Segments
+    std::vector<std::unique_ptr<RealSense>> segments;
+    for( uint32_t index = 0; index < parameter.shards; index++ ){
+        segments.push_back( std::make_unique<RealSense>( createSegment( index ), encoder ) );
+    }
+
+    // Create IMU Reader for Whole Range (Lossless IMU Extraction is not Sharded)
+    std::unique_ptr<ImuReader> imu;
+    if( parameter.imu_lossless ){
+        std::vector<rs2_stream> motion_streams;
+        if( parameter.selected_streams.empty() || parameter.selected_streams.count( "gyro" ) ){
+            motion_streams.push_back( rs2_stream::RS2_STREAM_GYRO );
+        }
+        if( parameter.selected_streams.empty() || parameter.selected_streams.count( "accel" ) ){
+            motion_streams.push_back( rs2_stream::RS2_STREAM_ACCEL );
+        }
+        imu = std::make_unique<ImuReader>( parameter.bag_file, directory / "IMU", parameter.flush_interval, motion_streams );
+        imu->start( start_position, ( end_position < total_duration ) ? end_position : 0 );
+    }
+
+    // Run Segments in Parallel
+    std::vector<std::exception_ptr> exceptions( segments.size() );
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> running{ static_cast<uint32_t>( segments.size() ) };
+    for( size_t i = 0; i < segments.size(); i++ ){
+        threads.emplace_back( [&, i](){
+            Profiler::instance().setThreadName( "shard " + std::to_string( i ) );
+            try{
+                segments[i]->run();
+            }
+            catch( ... ){
+                exceptions[i] = std::current_exception();
+            }
+            running--;
+        } );
+    }
+
+    // Show Progress of All Segments
+    while( running > 0 ){
+        if( parameter.quiet ){
+            std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+            continue;
+        }
+
+        double progress = 0.0;
+        for( const std::unique_ptr<RealSense>& segment : segments ){
+            progress += segment->getProgress();
+        }
+        progress = progress / segments.size() * 100.0;
+
+        std::cout << "\rProgress: " << std::fixed << std::setprecision( 1 ) << progress << "% " << std::flush;
+        std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+    }
+    if( !parameter.quiet ){
+        std::cout << "\rProgress: 100.0% " << std::endl;
+    }
+
+    for( std::thread& thread : threads ){
+        thread.join();
+    }
+
+    // Wait for Remaining IMU Samples
+    if( imu ){
+        imu->join();
+    }
+
+    // Finalize Segments (Flush Metadata)
+    // Each segment has waited for its images and rethrown its encoder error in run().
+    segments.clear();
+
+    for( const std::exception_ptr& exception : exceptions ){
+        if( exception ){
+            std::rethrow_exception( exception );
+        }
+    }
+
+    // Merge Metadata Part Files
+    merge();
+}
+
+// Initialize Range (Scan First Frame of Each Stream)
+inline void Sharding::initializeRange()
+{
+    // Start Pipeline with All Streams in File
+    rs2::config config;
+    config.enable_device_from_file( parameter.bag_file.string() );
+    rs2::pipeline pipeline;
+    const rs2::pipeline_profile pipeline_profile = pipeline.start( config );
+    rs2::playback playback = pipeline_profile.get_device().as<rs2::playback>();
+    playback.set_real_time( false );
+    total_duration = playback.get_duration().count();
+
+    // Retrieve Frame Rate of Reference Stream for Frame Range (Color, or Other Video Stream)
+    const std::vector<rs2::stream_profile> stream_profiles = pipeline_profile.get_streams();
+    double reference_fps = 0.0;
+    for( const rs2::stream_profile& stream_profile : stream_profiles ){
+        if( stream_profile.is<rs2::video_stream_profile>() && ( stream_profile.stream_type() == rs2_stream::RS2_STREAM_COLOR || reference_fps == 0.0 ) ){
+            reference_fps = stream_profile.fps();
+        }
+    }
+
+    // Scan First Frame of Each Stream
+    uint64_t last_position = playback.get_position();
+    while( first_frames.size() < stream_profiles.size() ){
+        const rs2::frameset frameset = pipeline.wait_for_frames();
+        const uint64_t position = playback.get_position();
+        #if 29 < RS2_API_MINOR_VERSION
+        frameset.foreach_rs( [&]( const rs2::frame& frame ){
+        #else
+        frameset.foreach( [&]( const rs2::frame& frame ){
+        #endif
+            const StreamKey key( frame.get_profile().stream_type(), frame.get_profile().stream_index() );
+            first_frames.emplace( key, FirstFrame( frame.get_timestamp(), position ) );
+        } );
+
+        // End of Position or Scan Limit
+        if( static_cast<int64_t>( position - last_position ) < 0 || position > scan_limit ){
+            break;
+        }
+        last_position = position;
+    }
+    pipeline.stop();
+
+    if( first_frames.empty() ){
+        throw std::runtime_error( "failed can't find frames in bag file" );
+    }
+
+    // Convert Frame Range to Time Range with Frame Rate of Reference Stream
+    double start_time = parameter.start_time;
+    double end_time = parameter.end_time;
+    if( parameter.first_frame >= 0 || parameter.last_frame >= 0 ){
+        if( reference_fps == 0.0 ){
+            throw std::runtime_error( "failed can't find video stream for frame range" );
+        }
+        start_time = ( parameter.first_frame >= 0 ) ? parameter.first_frame / reference_fps : 0.0;
+        end_time = ( parameter.last_frame >= 0 ) ? ( parameter.last_frame + 1 ) / reference_fps : 0.0;
+    }
+
+    // Retrieve Extraction Range
+    start_position = std::min<uint64_t>( static_cast<uint64_t>( start_time * 1e9 ), total_duration );
+    end_position = ( end_time > 0.0 ) ? std::min<uint64_t>( static_cast<uint64_t>( end_time * 1e9 ), total_duration ) : total_duration;
+    if( end_position <= start_position ){
+        throw std::runtime_error( "failed extraction range is empty" );
+    }
+}
+
+// Create Parameter of Segment
+inline Parameter Sharding::createSegment( uint32_t index )
+{
+    // Segment Boundaries (Playback Position)
+    const uint64_t length = end_position - start_position;
+    const uint64_t segment_start = start_position + length * index / parameter.shards;
+    const uint64_t segment_end = start_position + length * ( index + 1 ) / parameter.shards;
+    const bool first = ( index == 0 );
+    const bool last = ( index + 1 == parameter.shards );
+
+    Parameter segment = parameter;
+    segment.shards = 1;
+    segment.shard = static_cast<int32_t>( index );
+    segment.display = false;
+    segment.quiet = true;
+    segment.first_frame = -1;
+    segment.last_frame = -1;
+
+    // Read Range with Margin (Playback Position)
+    segment.start_time = ( first || segment_start < start_position + segment_margin ) ? start_position * 1e-9 : ( segment_start - segment_margin ) * 1e-9;
+    segment.end_time = ( last || segment_end + segment_margin >= end_position ) ? ( ( end_position < total_duration ) ? end_position * 1e-9 : 0.0 ) : ( segment_end + segment_margin ) * 1e-9;
+
+    // Write Range (Frame Timestamp of Each Stream)
+    // Streams that were not found by the scan use the mapping of the first found stream.
+    const FirstFrame& reference = first_frames.begin()->second;
+    const std::vector<StreamKey> keys = {
+        { rs2_stream::RS2_STREAM_COLOR, 0 }, { rs2_stream::RS2_STREAM_DEPTH, 0 },
+        { rs2_stream::RS2_STREAM_INFRARED, 0 }, { rs2_stream::RS2_STREAM_INFRARED, 1 }, { rs2_stream::RS2_STREAM_INFRARED, 2 },
+        { rs2_stream::RS2_STREAM_GYRO, 0 }, { rs2_stream::RS2_STREAM_ACCEL, 0 }
+    };
+    for( const StreamKey& key : keys ){
+        const std::map<StreamKey, FirstFrame>::const_iterator found = first_frames.find( key );
+        const FirstFrame& first_frame = ( found != first_frames.end() ) ? found->second : reference;
+        const double lower = ( first && start_position == 0 ) ? -std::numeric_limits<double>::infinity() : toTimestamp( first_frame, segment_start );
+        const double upper = ( last && end_position == total_duration ) ? std::numeric_limits<double>::infinity() : toTimestamp( first_frame, segment_end );
+        segment.timestamp_ranges[key] = { lower, upper };
+    }
+    for( const std::pair<const StreamKey, FirstFrame>& first_frame : first_frames ){
+        const double lower = ( first && start_position == 0 ) ? -std::numeric_limits<double>::infinity() : toTimestamp( first_frame.second, segment_start );
+        const double upper = ( last && end_position == total_duration ) ? std::numeric_limits<double>::infinity() : toTimestamp( first_frame.second, segment_end );
+        segment.timestamp_ranges[first_frame.first] = { lower, upper };
+    }
+
+    // Lossless IMU Extraction is Done for Whole Range by Sharding
+    if( parameter.imu_lossless ){
+        segment.imu_lossless = false;
+        if( segment.selected_streams.empty() ){
+            segment.selected_streams = { "color", "depth", "ir", "ir_right" };
+        }
+        segment.selected_streams.erase( "gyro" );
+        segment.selected_streams.erase( "accel" );
+    }
+
+    return segment;
+}
+
+// Convert Playback Position to Frame Timestamp of Stream
+inline double Sharding::toTimestamp( const FirstFrame& first_frame, uint64_t position )
+{
+    // Timestamp [ms] = First Timestamp [ms] + Elapsed Position [ns]
+    return first_frame.first + ( static_cast<double>( position ) - static_cast<double>( first_frame.second ) ) * 1e-6;
+}
+
+// Merge Metadata Part Files of Segments
+inline void Sharding::merge()
+{
+    // Collect Part Files (name.shardN.csv)
+    const std::regex pattern( R"((.*)\.shard(\d+)\.csv)" );
+    std::map<filesystem::path, std::map<uint32_t, filesystem::path>> part_files;
+    for( const filesystem::directory_entry& entry : filesystem::recursive_directory_iterator( directory ) ){
+        std::smatch match;
+        const std::string file_name = entry.path().filename().string();
+        if( !std::regex_match( file_name, match, pattern ) ){
+            continue;
+        }
+        part_files[entry.path().parent_path() / ( match[1].str() + ".csv" )][std::stoul( match[2].str() )] = entry.path();
+    }
+
+    // Concatenate Part Files in Segment Order (Header from First Part)
+    for( const std::pair<const filesystem::path, std::map<uint32_t, filesystem::path>>& part_file : part_files ){
+        std::ofstream output( part_file.first.string(), std::ios::binary );
+        bool header = true;
+        for( const std::pair<const uint32_t, filesystem::path>& part : part_file.second ){
+            std::ifstream input( part.second.string(), std::ios::binary );
+            std::string line;
+            if( !header ){
+                std::getline( input, line );
+            }
+            if( input.peek() != std::ifstream::traits_type::eof() ){
+                output << input.rdbuf();
+            }
+            header = false;
+            input.close();
+            filesystem::remove( part.second );
+        }
+        if( !output ){
+            throw std::runtime_error( "failed can't write " + part_file.first.generic_string() );
+        }
+    }
+}
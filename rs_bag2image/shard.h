@@ -0,0 +1,60 @@
+#ifndef __SHARD__
+#define __SHARD__
+
+#include <librealsense2/rs.hpp>
+
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "encoder.h"
+#include "filesystem.h"
+#include "parameter.h"
+
+// Sharded Extraction
+// Splits the extraction range of bag file into K time segments that are converted in parallel,
+// each by own RealSense (context, playback and pipeline seeked to the segment).
+// Segment boundaries are mapped to frame timestamps of each stream (first frame timestamp + offset),
+// each segment reads one second beyond its boundaries and writes only frames within them,
+// so frames at boundaries are written exactly once. Metadata part files are merged in segment order.
+class Sharding
+{
+private:
+    // First Frame of Stream (Timestamp, Playback Position)
+    using FirstFrame = std::pair<double, uint64_t>;
+
+    Parameter parameter;
+    filesystem::path directory;
+    std::shared_ptr<Encoder> encoder;
+
+    // Extraction Range (Playback Position in Nanoseconds)
+    uint64_t start_position;
+    uint64_t end_position;
+    uint64_t total_duration;
+
+    // First Frame of Each Stream
+    std::map<StreamKey, FirstFrame> first_frames;
+
+public:
+    // Constructor
+    // Use shared encoder if specified, otherwise create own encoder.
+    explicit Sharding( const Parameter& parameter, const std::shared_ptr<Encoder>& encoder = nullptr );
+
+    // Processing
+    void run();
+
+private:
+    // Initialize Range (Scan First Frame of Each Stream)
+    inline void initializeRange();
+
+    // Create Parameter of Segment
+    inline Parameter createSegment( uint32_t index );
+
+    // Convert Playback Position to Frame Timestamp of Stream
+    inline double toTimestamp( const FirstFrame& first_frame, uint64_t position );
+
+    // Merge Metadata Part Files of Segments
+    inline void merge();
+};
+
+#endif // __SHARD__
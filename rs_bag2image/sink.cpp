@@ -0,0 +1,325 @@
+#include "sink.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef HAVE_LIBURING
+#include <fcntl.h>
+#include <liburing.h>
+#endif
+
+namespace
+{
+    #ifdef HAVE_LIBURING
+    // Depth of Ring (Maximum Requests in Ring, Each Request has One Entry at a Time)
+    constexpr uint32_t ring_depth = 256;
+    #endif
+
+    // Create Error of Path
+    std::exception_ptr makeError( const std::string& path, int32_t error )
+    {
+        return std::make_exception_ptr( std::runtime_error( "failed can't write " + path + " (" + std::strerror( error ) + ")" ) );
+    }
+}
+
+// Constructor
+FileSink::FileSink( uint32_t num_threads, std::size_t max_inflight_bytes, uint32_t batch_size )
+    : max_inflight_bytes( max_inflight_bytes ), batch_size( std::max<uint32_t>( batch_size, 1 ) ), max_buffers( std::max<std::size_t>( num_threads, 1 ) + batch_size )
+{
+    // Create Ring Thread (io_uring)
+    #ifdef HAVE_LIBURING
+    if( initializeRing() ){
+        backend = Backend::Uring;
+        threads.emplace_back( &FileSink::workRing, this );
+        return;
+    }
+    #endif
+
+    // Create Writer Threads (Thread Pool)
+    backend = Backend::Threads;
+    for( uint32_t i = 0; i < std::max<uint32_t>( num_threads, 1 ); i++ ){
+        threads.emplace_back( &FileSink::work, this );
+    }
+}
+
+// Destructor
+FileSink::~FileSink()
+{
+    // Stop Threads (Write Remaining Files)
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        closed = true;
+    }
+    not_empty.notify_all();
+    not_full.notify_all();
+    for( std::thread& thread : threads ){
+        if( thread.joinable() ){
+            thread.join();
+        }
+    }
+
+    #ifdef HAVE_LIBURING
+    if( ring ){
+        io_uring_queue_exit( ring );
+        delete ring;
+    }
+    #endif
+}
+
+// Acquire Buffer from Pool
+FileSink::Buffer FileSink::acquire()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    if( buffers.empty() ){
+        return Buffer();
+    }
+
+    Buffer buffer = std::move( buffers.back() );
+    buffers.pop_back();
+    return buffer;
+}
+
+// Write Buffer to File
+void FileSink::write( const std::string& path, Buffer&& data, Callback callback )
+{
+    std::unique_ptr<Request> request = std::make_unique<Request>();
+    request->path = path;
+    request->data = std::move( data );
+    request->callback = std::move( callback );
+    if( Profiler::instance().isEnabled() ){
+        request->submit_time = std::chrono::steady_clock::now();
+    }
+
+    // Block while In-Flight Bytes Exceed Cap (One Request is Always Accepted)
+    const std::size_t size = request->data.size();
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        not_full.wait( lock, [this, size]{ return closed || inflight_requests == 0 || inflight_bytes + size <= max_inflight_bytes; } );
+        if( closed ){
+            throw std::runtime_error( "failed file sink has been closed" );
+        }
+
+        inflight_bytes += size;
+        inflight_requests++;
+        queue.push_back( std::move( request ) );
+    }
+    not_empty.notify_one();
+}
+
+// Wait for All Pending Files
+void FileSink::flush()
+{
+    std::unique_lock<std::mutex> lock( mutex );
+    idle.wait( lock, [this]{ return inflight_requests == 0; } );
+}
+
+// Retrieve Backend
+FileSink::Backend FileSink::getBackend() const
+{
+    return backend;
+}
+
+// Writer Thread (Thread Pool)
+void FileSink::work()
+{
+    Profiler::instance().setThreadName( "io" );
+
+    while( true ){
+        std::unique_ptr<Request> request;
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            not_empty.wait( lock, [this]{ return closed || !queue.empty(); } );
+            if( queue.empty() ){
+                return;
+            }
+
+            request = std::move( queue.front() );
+            queue.pop_front();
+        }
+
+        // Open, Write and Close File
+        std::FILE* file = std::fopen( request->path.c_str(), "wb" );
+        if( !file ){
+            request->exception = makeError( request->path, errno );
+        }
+        else{
+            const bool written = std::fwrite( request->data.data(), 1, request->data.size(), file ) == request->data.size();
+            const int32_t error = errno;
+            if( std::fclose( file ) != 0 || !written ){
+                request->exception = makeError( request->path, written ? errno : error );
+            }
+        }
+
+        complete( std::move( request ) );
+    }
+}
+
+// Complete Request (Record Latency, Call Callback and Release Buffer)
+inline void FileSink::complete( std::unique_ptr<Request> request )
+{
+    Profiler& profiler = Profiler::instance();
+    if( profiler.isEnabled() ){
+        profiler.record( "io/write", request->submit_time, std::chrono::steady_clock::now() );
+    }
+
+    request->callback( request->exception );
+
+    const std::size_t size = request->data.size();
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        if( buffers.size() < max_buffers ){
+            request->data.clear();
+            buffers.push_back( std::move( request->data ) );
+        }
+
+        inflight_bytes -= size;
+        if( --inflight_requests == 0 ){
+            idle.notify_all();
+        }
+    }
+    not_full.notify_all();
+}
+
+#ifdef HAVE_LIBURING
+// Initialize io_uring
+// Requires openat, write and close operations (Linux 5.6 or later).
+inline bool FileSink::initializeRing()
+{
+    ring = new io_uring();
+    if( io_uring_queue_init( ring_depth, ring, 0 ) < 0 ){
+        delete ring;
+        ring = nullptr;
+        return false;
+    }
+
+    io_uring_probe* probe = io_uring_get_probe_ring( ring );
+    const bool supported = probe && io_uring_opcode_supported( probe, IORING_OP_OPENAT ) && io_uring_opcode_supported( probe, IORING_OP_WRITE ) && io_uring_opcode_supported( probe, IORING_OP_CLOSE );
+    if( probe ){
+        io_uring_free_probe( probe );
+    }
+    if( !supported ){
+        io_uring_queue_exit( ring );
+        delete ring;
+        ring = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+// Ring Thread (io_uring)
+// New requests are taken in batches and submitted together with the next stages of completed requests.
+void FileSink::workRing()
+{
+    Profiler::instance().setThreadName( "io" );
+
+    std::size_t active = 0;
+    while( true ){
+        // Take New Requests (Wait while Ring is Idle)
+        std::vector<std::unique_ptr<Request>> requests;
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            if( active == 0 ){
+                not_empty.wait( lock, [this]{ return closed || !queue.empty(); } );
+                if( queue.empty() ){
+                    return;
+                }
+            }
+            while( !queue.empty() && requests.size() < batch_size && active + requests.size() < ring_depth ){
+                requests.push_back( std::move( queue.front() ) );
+                queue.pop_front();
+            }
+        }
+
+        // Submit Open of New Requests (Request is Owned by Ring until Completion)
+        for( std::unique_ptr<Request>& request : requests ){
+            prepareRing( request.release() );
+            active++;
+        }
+        io_uring_submit( ring );
+
+        // Wait for Completion (Timeout to Take New Requests)
+        io_uring_cqe* cqe = nullptr;
+        __kernel_timespec timeout = { 0, 1000000 }; // 1 ms
+        if( io_uring_wait_cqe_timeout( ring, &cqe, &timeout ) < 0 ){
+            continue;
+        }
+
+        // Handle All Completions and Submit Next Stages
+        while( io_uring_peek_cqe( ring, &cqe ) == 0 ){
+            Request* request = static_cast<Request*>( io_uring_cqe_get_data( cqe ) );
+            const int32_t result = cqe->res;
+            io_uring_cqe_seen( ring, cqe );
+
+            if( handleRing( request, result ) ){
+                complete( std::unique_ptr<Request>( request ) );
+                active--;
+            }
+            else{
+                prepareRing( request );
+            }
+        }
+        io_uring_submit( ring );
+    }
+}
+
+// Handle Completion of Request Stage in Ring
+inline bool FileSink::handleRing( Request* request, int32_t result )
+{
+    switch( request->stage ){
+        case Stage::Open:
+            if( result < 0 ){
+                request->exception = makeError( request->path, -result );
+                return true;
+            }
+            request->fd = result;
+            request->stage = ( request->data.empty() ) ? Stage::Close : Stage::Write;
+            return false;
+        case Stage::Write:
+            if( result <= 0 ){
+                request->exception = makeError( request->path, ( result < 0 ) ? -result : EIO );
+                request->stage = Stage::Close;
+                return false;
+            }
+            request->written += result;
+            if( request->written == request->data.size() ){
+                request->stage = Stage::Close;
+            }
+            return false;
+        case Stage::Close:
+            if( result < 0 && !request->exception ){
+                request->exception = makeError( request->path, -result );
+            }
+            return true;
+    }
+    return true;
+}
+
+// Prepare Next Stage of Request in Ring
+inline void FileSink::prepareRing( Request* request )
+{
+    // Each request has one entry at a time, and active requests are limited to ring depth
+    io_uring_sqe* sqe = io_uring_get_sqe( ring );
+    if( !sqe ){
+        io_uring_submit( ring );
+        sqe = io_uring_get_sqe( ring );
+    }
+
+    switch( request->stage ){
+        case Stage::Open:
+            io_uring_prep_openat( sqe, AT_FDCWD, request->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+            break;
+        case Stage::Write:
+            io_uring_prep_write( sqe, request->fd, request->data.data() + request->written, static_cast<unsigned>( request->data.size() - request->written ), request->written );
+            break;
+        case Stage::Close:
+            io_uring_prep_close( sqe, request->fd );
+            break;
+    }
+    io_uring_sqe_set_data( sqe, request );
+}
+#endif
@@ -0,0 +1,131 @@
+#ifndef __SINK__
+#define __SINK__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct io_uring;
+
+// File Sink (Write-Behind)
+// Writes encoded files asynchronously, so encoder threads never block on open, write and close.
+//   io_uring : one ring thread submits openat, write and close of pending files in batches (Linux, built with liburing)
+//   threads  : a pool of threads writes files with stdio (other platforms, or io_uring is unavailable at runtime)
+// write() blocks while the in-flight bytes exceed the cap (backpressure).
+// Written buffers are returned to a pool, so encoding into acquired buffers reuses their capacity.
+// Write latency (from write() to close) is recorded as stage "io/write" of profiler.
+class FileSink
+{
+public:
+    using Buffer = std::vector<unsigned char>;
+    using Callback = std::function<void( std::exception_ptr exception )>;
+
+    // Backend
+    enum class Backend
+    {
+        Uring,
+        Threads
+    };
+
+private:
+    // Stage of Request in Ring
+    enum class Stage
+    {
+        Open,
+        Write,
+        Close
+    };
+
+    // Write Request
+    struct Request
+    {
+        std::string path;
+        Buffer data;
+        Callback callback;
+        std::chrono::steady_clock::time_point submit_time;
+
+        // State in Ring
+        Stage stage = Stage::Open;
+        int32_t fd = -1;
+        std::size_t written = 0;
+        std::exception_ptr exception;
+    };
+
+    Backend backend = Backend::Threads;
+    std::size_t max_inflight_bytes;
+    uint32_t batch_size;
+
+    // Pending Requests
+    std::deque<std::unique_ptr<Request>> queue;
+    std::size_t inflight_bytes = 0;
+    std::size_t inflight_requests = 0;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::condition_variable idle;
+
+    // Buffer Pool
+    std::vector<Buffer> buffers;
+    std::size_t max_buffers;
+
+    std::vector<std::thread> threads;
+
+    // io_uring (Only if Built with liburing, Same Layout in Every Build)
+    io_uring* ring = nullptr;
+
+public:
+    // Constructor
+    // Use io_uring if available, otherwise create the pool of num_threads threads.
+    FileSink( uint32_t num_threads, std::size_t max_inflight_bytes, uint32_t batch_size = 32 );
+
+    // Destructor
+    // Write all pending files.
+    ~FileSink();
+
+    FileSink( const FileSink& ) = delete;
+    FileSink& operator=( const FileSink& ) = delete;
+
+    // Acquire Buffer from Pool (Empty, with Capacity of Written Buffer)
+    Buffer acquire();
+
+    // Write Buffer to File
+    // The callback is called on the sink thread with the error (nullptr is success) after the file has been closed.
+    void write( const std::string& path, Buffer&& data, Callback callback );
+
+    // Wait for All Pending Files
+    void flush();
+
+    // Retrieve Backend
+    Backend getBackend() const;
+
+private:
+    // Writer Thread (Thread Pool)
+    void work();
+
+    // Complete Request (Record Latency, Call Callback and Release Buffer)
+    inline void complete( std::unique_ptr<Request> request );
+
+    // Initialize io_uring (Return false if Unavailable)
+    inline bool initializeRing();
+
+    // Ring Thread (io_uring)
+    void workRing();
+
+    // Handle Completion of Request Stage in Ring
+    // Return true if the request has been completed.
+    inline bool handleRing( Request* request, int32_t result );
+
+    // Prepare Next Stage of Request in Ring
+    inline void prepareRing( Request* request );
+};
+
+#endif // __SINK__
@@ -0,0 +1,222 @@
+#include "stack.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static_assert( sizeof( DepthStack::StackHeader ) == 64, "unexpected stack header size" );
+static_assert( sizeof( DepthStack::StackIndex ) == 24, "unexpected stack index size" );
+
+// Constructor
+DepthStack::DepthStack( const filesystem::path& path, Layout layout, uint32_t width, uint32_t height, uint32_t format, float depth_scale, std::size_t buffer_size )
+    : path( path ), layout( layout ), width( width ), height( height ), format( format ), depth_scale( depth_scale ), frame_size( static_cast<std::size_t>( width ) * height * sizeof( uint16_t ) )
+{
+    // Open File
+    file = std::fopen( path.string().c_str(), "wb" );
+    if( !file ){
+        throw std::runtime_error( "failed can't open " + path.generic_string() );
+    }
+
+    // Disable stdio Buffering (use own buffer)
+    std::setvbuf( file, nullptr, _IONBF, 0 );
+
+    // Allocate Buffer (Multiple of Header Size, at least One Frame)
+    buffer_size = std::max( buffer_size, frame_size );
+    buffer.resize( ( buffer_size + header_size - 1 ) / header_size * header_size );
+
+    // Reserve Header (Final Header is Written at Close)
+    std::memset( buffer.data(), 0, header_size );
+    size = header_size;
+}
+
+// Destructor
+DepthStack::~DepthStack()
+{
+    try{
+        close();
+    }
+    catch( ... ){
+    }
+}
+
+// Write Frame (Raw 16bit Depth, width * height Pixels, Row Stride in Bytes)
+void DepthStack::write( const void* data, int32_t stride, uint64_t frame_number, double timestamp )
+{
+    if( !file ){
+        throw std::runtime_error( "failed " + path.generic_string() + " has been closed" );
+    }
+
+    index.push_back( { frame_number, timestamp, header_size + index.size() * frame_size } );
+
+    // Copy Rows into Buffer (Write Buffer when Full)
+    const std::size_t row_size = static_cast<std::size_t>( width ) * sizeof( uint16_t );
+    const uint8_t* source = static_cast<const uint8_t*>( data );
+    if( static_cast<std::size_t>( stride ) == row_size ){
+        std::size_t remaining = frame_size;
+        while( remaining > 0 ){
+            const std::size_t length = std::min( remaining, buffer.size() - size );
+            std::memcpy( buffer.data() + size, source, length );
+            size += length;
+            source += length;
+            remaining -= length;
+            if( size == buffer.size() ){
+                flush();
+            }
+        }
+        return;
+    }
+
+    for( uint32_t y = 0; y < height; y++ ){
+        const uint8_t* row = source + static_cast<std::size_t>( y ) * stride;
+        std::size_t remaining = row_size;
+        while( remaining > 0 ){
+            const std::size_t length = std::min( remaining, buffer.size() - size );
+            std::memcpy( buffer.data() + size, row, length );
+            size += length;
+            row += length;
+            remaining -= length;
+            if( size == buffer.size() ){
+                flush();
+            }
+        }
+    }
+}
+
+// Close (Write Remaining Frames, Index and Final Header)
+void DepthStack::close()
+{
+    if( !file ){
+        return;
+    }
+
+    std::FILE* closing = file;
+    try{
+        flush();
+        writeIndex();
+        writeHeader();
+        if( layout == Layout::Npy ){
+            writeInfo();
+        }
+    }
+    catch( ... ){
+        std::fclose( closing );
+        file = nullptr;
+        throw;
+    }
+
+    file = nullptr;
+    if( std::fclose( closing ) != 0 ){
+        throw std::runtime_error( "failed can't write " + path.generic_string() );
+    }
+}
+
+// Write Buffer to File
+inline void DepthStack::flush()
+{
+    if( size == 0 ){
+        return;
+    }
+
+    const std::size_t length = size;
+    size = 0;
+    if( std::fwrite( buffer.data(), 1, length, file ) != length ){
+        throw std::runtime_error( "failed can't write " + path.generic_string() );
+    }
+    countProfile( "bytes/depth_stack", length );
+}
+
+// Write Header
+inline void DepthStack::writeHeader()
+{
+    std::string header;
+    if( layout == Layout::Raw ){
+        StackHeader stack_header = {};
+        std::memcpy( stack_header.magic, "RSSTACK", 8 );
+        stack_header.version = 1;
+        stack_header.header_size = header_size;
+        stack_header.width = width;
+        stack_header.height = height;
+        stack_header.format = format;
+        stack_header.bytes_per_pixel = sizeof( uint16_t );
+        stack_header.depth_scale = depth_scale;
+        stack_header.frame_count = index.size();
+        stack_header.frame_size = frame_size;
+        stack_header.index_offset = header_size + index.size() * frame_size;
+
+        header.assign( header_size, '\0' );
+        std::memcpy( &header[0], &stack_header, sizeof( StackHeader ) );
+    }
+    else{
+        const std::string shape = "(" + std::to_string( index.size() ) + ", " + std::to_string( height ) + ", " + std::to_string( width ) + ")";
+        header = createNpyHeader( "'<u2'", shape, header_size );
+    }
+
+    std::fseek( file, 0, SEEK_SET );
+    if( std::fwrite( header.data(), 1, header.size(), file ) != header.size() ){
+        throw std::runtime_error( "failed can't write " + path.generic_string() );
+    }
+}
+
+// Write Index
+inline void DepthStack::writeIndex()
+{
+    const std::size_t length = index.size() * sizeof( StackIndex );
+
+    // Raw Layout (Append Index after Frames)
+    if( layout == Layout::Raw ){
+        if( length > 0 && std::fwrite( index.data(), 1, length, file ) != length ){
+            throw std::runtime_error( "failed can't write " + path.generic_string() );
+        }
+        return;
+    }
+
+    // NumPy Layout (Structured Array in Index File)
+    const filesystem::path index_path = path.parent_path() / ( path.stem().string() + "_index.npy" );
+    std::FILE* index_file = std::fopen( index_path.string().c_str(), "wb" );
+    if( !index_file ){
+        throw std::runtime_error( "failed can't open " + index_path.generic_string() );
+    }
+
+    const std::string descr = "[('frame_number', '<u8'), ('timestamp', '<f8'), ('offset', '<u8')]";
+    const std::string header = createNpyHeader( descr, "(" + std::to_string( index.size() ) + ",)", 0 );
+    const bool succeeded = std::fwrite( header.data(), 1, header.size(), index_file ) == header.size() && ( length == 0 || std::fwrite( index.data(), 1, length, index_file ) == length );
+    if( std::fclose( index_file ) != 0 || !succeeded ){
+        throw std::runtime_error( "failed can't write " + index_path.generic_string() );
+    }
+}
+
+// Write Format (NumPy Layout)
+inline void DepthStack::writeInfo()
+{
+    const filesystem::path info_path = path.parent_path() / ( path.stem().string() + "_info.csv" );
+    filesystem::remove( info_path );
+    CsvWriter info( info_path, "width,height,format,depth_scale,frame_count" );
+    info.write( width, height, format, depth_scale, index.size() );
+}
+
+// Create NPY Header (Padded to Length)
+// Length 0 is padded to the minimum multiple of 64 bytes.
+std::string DepthStack::createNpyHeader( const std::string& descr, const std::string& shape, std::size_t length )
+{
+    // Magic String, Version 1.0, Header Length (Little Endian), Dictionary Padded with Spaces, Newline
+    const std::string dictionary = "{'descr': " + descr + ", 'fortran_order': False, 'shape': " + shape + ", }";
+    const std::size_t prefix = 10;
+    if( length == 0 ){
+        length = ( prefix + dictionary.size() + 1 + 63 ) / 64 * 64;
+    }
+    if( length < prefix + dictionary.size() + 1 || length - prefix > 0xFFFF ){
+        throw std::runtime_error( "failed npy header is too long" );
+    }
+
+    const std::size_t header_length = length - prefix;
+    std::string header = "\x93NUMPY";
+    header += static_cast<char>( 1 );
+    header += static_cast<char>( 0 );
+    header += static_cast<char>( header_length & 0xFF );
+    header += static_cast<char>( ( header_length >> 8 ) & 0xFF );
+    header += dictionary;
+    header.append( length - header.size() - 1, ' ' );
+    header += '\n';
+    return header;
+}
@@ -0,0 +1,117 @@
+#ifndef __STACK__
+#define __STACK__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "writer.h"
+
+// Depth Stack Writer
+// Writes raw 16bit depth of all frames to one file that can be memory-mapped for zero-copy random access.
+// Frames are stored back to back after a 4096 byte header, so frame N is at header_size + N * frame_size.
+// Frames are streamed sequentially through a large buffer, so every write except the last is 4096 byte aligned.
+//
+// Raw Layout (.stack)
+//   Header (StackHeader, padded to 4096 bytes)
+//   Frames (frame_count * frame_size bytes)
+//   Index (frame_count * StackIndex at index_offset)
+//
+// NumPy Layout (.npy)
+//   NPY 1.0 Header (padded to 4096 bytes, uint16 array of shape (frame_count, height, width))
+//   Frames (frame_count * frame_size bytes)
+//   Index is written to <name>_index.npy (structured array of StackIndex).
+//   NPY header can't carry depth scale, so format is written to <name>_info.csv.
+class DepthStack
+{
+public:
+    // Output Layout
+    enum class Layout
+    {
+        Raw,
+        Npy
+    };
+
+    // Header of Raw Layout
+    struct StackHeader
+    {
+        char magic[8];          // "RSSTACK\0"
+        uint32_t version;       // 1
+        uint32_t header_size;   // 4096
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;        // rs2_format
+        uint32_t bytes_per_pixel;
+        float depth_scale;      // meters per unit
+        uint32_t reserved;
+        uint64_t frame_count;
+        uint64_t frame_size;    // bytes
+        uint64_t index_offset;  // bytes from beginning of file
+    };
+
+    // Index Entry
+    struct StackIndex
+    {
+        uint64_t frame_number;
+        double timestamp;       // milliseconds
+        uint64_t offset;        // bytes from beginning of file
+    };
+
+    static constexpr std::size_t header_size = 4096;
+
+private:
+    std::FILE* file = nullptr;
+    filesystem::path path;
+    Layout layout;
+
+    // Frame Format
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    float depth_scale;
+    std::size_t frame_size;
+
+    // Buffer (Multiple of Header Size)
+    std::vector<uint8_t> buffer;
+    std::size_t size = 0;
+
+    // Index
+    std::vector<StackIndex> index;
+
+public:
+    // Constructor
+    DepthStack( const filesystem::path& path, Layout layout, uint32_t width, uint32_t height, uint32_t format, float depth_scale, std::size_t buffer_size = 4 << 20 );
+
+    // Destructor
+    // Write remaining frames, index and final header.
+    ~DepthStack();
+
+    DepthStack( const DepthStack& ) = delete;
+    DepthStack& operator=( const DepthStack& ) = delete;
+
+    // Write Frame (Raw 16bit Depth, width * height Pixels, Row Stride in Bytes)
+    void write( const void* data, int32_t stride, uint64_t frame_number, double timestamp );
+
+    // Close (Write Remaining Frames, Index and Final Header)
+    void close();
+
+private:
+    // Write Buffer to File
+    inline void flush();
+
+    // Write Header
+    inline void writeHeader();
+
+    // Write Index
+    inline void writeIndex();
+
+    // Write Format (NumPy Layout)
+    inline void writeInfo();
+
+    // Create NPY Header (Padded to Length)
+    static std::string createNpyHeader( const std::string& descr, const std::string& shape, std::size_t length );
+};
+
+#endif // __STACK__
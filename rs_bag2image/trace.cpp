@@ -0,0 +1,234 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#include <psapi.h>
+#elif defined( __unix__ ) || defined( __APPLE__ )
+#include <sys/resource.h>
+#endif
+
+// Retrieve Instance
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+// Enable Profiling (Summary Table and/or Trace File)
+void Profiler::enable( bool summary, const filesystem::path& trace_path )
+{
+    this->summary = summary;
+    this->trace_path = trace_path;
+    origin = std::chrono::steady_clock::now();
+    enabled = summary || !trace_path.empty();
+    if( enabled ){
+        setThreadName( "main" );
+    }
+}
+
+// Enable Recording Only (Totals are Retrieved by Caller with collect())
+void Profiler::enable()
+{
+    summary = false;
+    trace_path.clear();
+    origin = std::chrono::steady_clock::now();
+    enabled = true;
+    setThreadName( "main" );
+}
+
+// Record Duration Event
+void Profiler::record( const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end )
+{
+    // Events are Kept until Exit, so Nothing is Buffered while Disabled
+    if( !isEnabled() ){
+        return;
+    }
+
+    const int64_t start_time = std::chrono::duration_cast<std::chrono::nanoseconds>( start - origin ).count();
+    const int64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count();
+    getBuffer().events.push_back( { name, start_time, duration } );
+}
+
+// Add Counter (e.g. Bytes Written)
+void Profiler::count( const char* name, uint64_t value )
+{
+    if( !isEnabled() ){
+        return;
+    }
+
+    // Accumulate into Last Entry of Same Name (Counters are Summed in Summary)
+    std::vector<Counter>& counters = getBuffer().counters;
+    for( Counter& counter : counters ){
+        if( counter.name == name ){
+            counter.value += value;
+            return;
+        }
+    }
+    counters.push_back( { name, value } );
+}
+
+// Set Name of Current Thread (Shown in Trace)
+void Profiler::setThreadName( const std::string& name )
+{
+    if( !isEnabled() ){
+        return;
+    }
+
+    Buffer& buffer = getBuffer();
+    std::lock_guard<std::mutex> lock( mutex );
+    buffer.name = name;
+}
+
+// Show Summary Table and Write Trace File
+void Profiler::finish( std::ostream& stream )
+{
+    if( !isEnabled() ){
+        return;
+    }
+    enabled = false;
+
+    std::lock_guard<std::mutex> lock( mutex );
+
+    // Write Trace File
+    if( !trace_path.empty() ){
+        writeTrace();
+    }
+
+    if( !summary ){
+        return;
+    }
+
+    // Collect Durations and Counters of Each Name
+    std::map<std::string, std::vector<int64_t>> durations;
+    std::map<std::string, uint64_t> counters;
+    for( const std::unique_ptr<Buffer>& buffer : buffers ){
+        for( const Event& event : buffer->events ){
+            durations[event.name].push_back( event.duration );
+        }
+        for( const Counter& counter : buffer->counters ){
+            counters[counter.name] += counter.value;
+        }
+    }
+
+    // Show Stages
+    stream << std::endl;
+    stream << std::left << std::setw( 24 ) << "stage" << std::right << std::setw( 10 ) << "count" << std::setw( 14 ) << "total [ms]" << std::setw( 12 ) << "p50 [ms]" << std::setw( 12 ) << "p95 [ms]" << std::setw( 12 ) << "p99 [ms]" << std::endl;
+    for( std::pair<const std::string, std::vector<int64_t>>& duration : durations ){
+        std::vector<int64_t>& values = duration.second;
+        std::sort( values.begin(), values.end() );
+        int64_t total = 0;
+        for( const int64_t value : values ){
+            total += value;
+        }
+        const auto percentile = [&values]( double p ){
+            const std::size_t index = std::min( values.size() - 1, static_cast<std::size_t>( p * ( values.size() - 1 ) + 0.5 ) );
+            return values[index] / 1e6;
+        };
+        stream << std::left << std::setw( 24 ) << duration.first << std::right << std::fixed
+               << std::setw( 10 ) << values.size()
+               << std::setprecision( 1 ) << std::setw( 14 ) << total / 1e6
+               << std::setprecision( 3 ) << std::setw( 12 ) << percentile( 0.50 ) << std::setw( 12 ) << percentile( 0.95 ) << std::setw( 12 ) << percentile( 0.99 ) << std::endl;
+    }
+
+    // Show Counters and Peak RSS
+    stream << std::endl;
+    for( const std::pair<const std::string, uint64_t>& counter : counters ){
+        stream << std::left << std::setw( 24 ) << counter.first << std::right << std::setw( 16 ) << counter.second << std::endl;
+    }
+    stream << std::left << std::setw( 24 ) << "peak rss [bytes]" << std::right << std::setw( 16 ) << getPeakRss() << std::endl;
+}
+
+// Retrieve Totals of Stages and Counters
+void Profiler::collect( std::map<std::string, Stage>& stages, std::map<std::string, uint64_t>& counters )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    for( const std::unique_ptr<Buffer>& buffer : buffers ){
+        for( const Event& event : buffer->events ){
+            Stage& stage = stages[event.name];
+            stage.count++;
+            stage.total += event.duration;
+        }
+        for( const Counter& counter : buffer->counters ){
+            counters[counter.name] += counter.value;
+        }
+    }
+}
+
+// Clear Recorded Events and Counters
+void Profiler::reset()
+{
+    // Buffers are Kept (Threads Refer to Them)
+    std::lock_guard<std::mutex> lock( mutex );
+    for( const std::unique_ptr<Buffer>& buffer : buffers ){
+        buffer->events.clear();
+        buffer->counters.clear();
+    }
+}
+
+// Retrieve Buffer of Current Thread
+Profiler::Buffer& Profiler::getBuffer()
+{
+    thread_local Buffer* buffer = nullptr;
+    if( !buffer ){
+        std::lock_guard<std::mutex> lock( mutex );
+        buffers.push_back( std::make_unique<Buffer>() );
+        buffer = buffers.back().get();
+        buffer->id = static_cast<uint32_t>( buffers.size() );
+        buffer->events.reserve( 1 << 16 );
+    }
+    return *buffer;
+}
+
+// Write Trace File (Chrome trace_event JSON)
+inline void Profiler::writeTrace()
+{
+    std::ofstream trace( trace_path.string() );
+    trace << std::fixed << std::setprecision( 3 );
+    trace << "{\"traceEvents\":[\n";
+    bool first = true;
+    for( const std::unique_ptr<Buffer>& buffer : buffers ){
+        // Thread Name (Metadata Event)
+        if( !buffer->name.empty() ){
+            trace << ( first ? "" : ",\n" ) << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+            first = false;
+        }
+
+        // Complete Events (Microseconds)
+        for( const Event& event : buffer->events ){
+            trace << ( first ? "" : ",\n" ) << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":" << event.start / 1e3 << ",\"dur\":" << event.duration / 1e3 << "}";
+            first = false;
+        }
+    }
+    trace << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    if( !trace ){
+        throw std::runtime_error( "failed can't write " + trace_path.generic_string() );
+    }
+}
+
+// Retrieve Peak Resident Set Size [bytes]
+uint64_t Profiler::getPeakRss()
+{
+#if defined( _WIN32 )
+    PROCESS_MEMORY_COUNTERS counters;
+    if( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) ){
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined( __APPLE__ )
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    return static_cast<uint64_t>( usage.ru_maxrss ); // bytes
+#elif defined( __unix__ )
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    return static_cast<uint64_t>( usage.ru_maxrss ) * 1024; // kilobytes
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,156 @@
+#ifndef __TRACE__
+#define __TRACE__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+
+// Profiler
+// Records duration of scoped stages and counters (e.g. bytes written) into per-thread buffers without locks.
+// When disabled, a scoped timer costs one relaxed atomic load and no clock read.
+// At exit it shows a summary table (count, total, p50/p95/p99 per stage), and optionally writes
+// Chrome trace_event JSON that can be opened with Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+// Stage and counter names must be string literals (only the pointer is stored).
+class Profiler
+{
+public:
+    // Totals of Stage
+    struct Stage
+    {
+        uint64_t count = 0;
+        int64_t total = 0;  // nanoseconds
+    };
+
+private:
+    // Duration Event
+    struct Event
+    {
+        const char* name;
+        int64_t start;      // nanoseconds from profiler start
+        int64_t duration;   // nanoseconds
+    };
+
+    // Counter
+    struct Counter
+    {
+        const char* name;
+        uint64_t value;
+    };
+
+    // Per-Thread Buffer
+    struct Buffer
+    {
+        uint32_t id;
+        std::string name;
+        std::vector<Event> events;
+        std::vector<Counter> counters;
+    };
+
+    std::atomic<bool> enabled{ false };
+    bool summary = false;
+    filesystem::path trace_path;
+    std::chrono::steady_clock::time_point origin;
+
+    // Buffers of All Threads (Kept after Thread Exit)
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+public:
+    // Retrieve Instance
+    static Profiler& instance();
+
+    // Enable Profiling (Summary Table and/or Trace File)
+    void enable( bool summary, const filesystem::path& trace_path );
+
+    // Enable Recording Only (Totals are Retrieved by Caller with collect())
+    void enable();
+
+    // Check Profiling is Enabled
+    bool isEnabled() const
+    {
+        return enabled.load( std::memory_order_relaxed );
+    }
+
+    // Record Duration Event (Ignored if Disabled)
+    void record( const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end );
+
+    // Add Counter (e.g. Bytes Written, Ignored if Disabled)
+    void count( const char* name, uint64_t value );
+
+    // Set Name of Current Thread (Shown in Trace)
+    void setThreadName( const std::string& name );
+
+    // Show Summary Table and Write Trace File
+    // Call after all instrumented threads have finished.
+    void finish( std::ostream& stream );
+
+    // Retrieve Totals of Stages and Counters
+    // Call after all instrumented threads have finished.
+    void collect( std::map<std::string, Stage>& stages, std::map<std::string, uint64_t>& counters );
+
+    // Clear Recorded Events and Counters (e.g. between Runs of Benchmark)
+    // Call after all instrumented threads have finished.
+    void reset();
+
+private:
+    // Retrieve Buffer of Current Thread
+    Buffer& getBuffer();
+
+    // Write Trace File (Chrome trace_event JSON)
+    inline void writeTrace();
+
+    // Retrieve Peak Resident Set Size [bytes]
+    static uint64_t getPeakRss();
+};
+
+// Scoped Timer
+// Records duration from construction to destruction as a stage of profiler.
+class ScopedTimer
+{
+private:
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+    bool enabled;
+
+public:
+    explicit ScopedTimer( const char* name )
+        : name( name ), enabled( Profiler::instance().isEnabled() )
+    {
+        if( enabled ){
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        if( enabled ){
+            Profiler::instance().record( name, start, std::chrono::steady_clock::now() );
+        }
+    }
+
+    ScopedTimer( const ScopedTimer& ) = delete;
+    ScopedTimer& operator=( const ScopedTimer& ) = delete;
+};
+
+// Add Counter if Profiling is Enabled
+inline void countProfile( const char* name, uint64_t value )
+{
+    Profiler& profiler = Profiler::instance();
+    if( profiler.isEnabled() ){
+        profiler.count( name, value );
+    }
+}
+
+#define TRACE_CONCAT_EXP( a, b ) a##b
+#define TRACE_CONCAT( a, b )     TRACE_CONCAT_EXP( a, b )
+#define TRACE_SCOPE( name )      ScopedTimer TRACE_CONCAT( scoped_timer_, __LINE__ )( name )
+
+#endif // __TRACE__
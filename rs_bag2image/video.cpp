@@ -0,0 +1,131 @@
+#include "video.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+// Constructor
+VideoStream::VideoStream( const filesystem::path& path, const std::string& fourcc, double fps, const cv::Size& size, bool is_color, std::chrono::steady_clock::duration flush_interval, std::size_t queue_capacity )
+    : path( path ), tasks( queue_capacity )
+{
+    // Open Video File
+    if( fourcc.size() != 4 ){
+        throw std::runtime_error( "failed fourcc must be four characters " + fourcc );
+    }
+    const int32_t code = cv::VideoWriter::fourcc( fourcc[0], fourcc[1], fourcc[2], fourcc[3] );
+    if( !writer.open( path.string(), code, fps, size, is_color ) ){
+        throw std::runtime_error( "failed can't open video " + path.generic_string() );
+    }
+
+    // Open Sidecar Index
+    index = std::make_unique<CsvWriter>( path.parent_path() / ( path.stem().string() + "_index.csv" ), "video_frame,frame_number,timestamp", flush_interval );
+
+    // Create Encoder Thread
+    thread = std::thread( &VideoStream::work, this );
+}
+
+// Destructor
+VideoStream::~VideoStream()
+{
+    try{
+        close();
+    }
+    catch( ... ){
+    }
+}
+
+// Write Image
+void VideoStream::write( const cv::Mat& image, const rs2::frame& frame )
+{
+    rethrow();
+
+    // Keep Source Frame if Image Refers to Frame Buffer (External Data)
+    rs2::frame source;
+    if( !image.u && frame ){
+        source = frame;
+        source.keep();
+    }
+
+    // Block while Queue is Full
+    if( !tasks.push( { image, source, frame.get_frame_number(), frame.get_timestamp() } ) ){
+        throw std::runtime_error( "failed video " + path.generic_string() + " has been closed" );
+    }
+}
+
+// Close (Encode Remaining Images and Rethrow Encoder Error)
+void VideoStream::close()
+{
+    tasks.close();
+    if( thread.joinable() ){
+        thread.join();
+    }
+
+    writer.release();
+    if( index ){
+        index->flush();
+    }
+
+    rethrow();
+}
+
+// Retrieve File Extension of Container for FourCC
+std::string VideoStream::getExtension( const std::string& fourcc )
+{
+    std::string code = fourcc;
+    std::transform( code.begin(), code.end(), code.begin(), []( unsigned char c ){ return static_cast<char>( std::toupper( c ) ); } );
+    if( code == "MJPG" || code == "XVID" || code == "DIVX" ){
+        return ".avi";
+    }
+    if( code == "FFV1" ){
+        return ".mkv";
+    }
+    return ".mp4";
+}
+
+// Encoder Thread
+void VideoStream::work()
+{
+    Profiler::instance().setThreadName( "video" );
+
+    Task task;
+    cv::Mat bgr;
+    while( tasks.pop( task ) ){
+        // Skip Remaining Tasks after Error
+        try{
+            if( !failed ){
+                TRACE_SCOPE( "video_encode" );
+                // Drop Alpha of BGRA (Color Video Accepts Only 3 Channels, Other Frames are Dropped Silently)
+                if( task.image.channels() == 4 ){
+                    cv::cvtColor( task.image, bgr, cv::COLOR_BGRA2BGR );
+                    writer.write( bgr );
+                }
+                else{
+                    writer.write( task.image );
+                }
+                index->write( frame_count++, task.frame_number, task.timestamp );
+            }
+        }
+        catch( ... ){
+            std::lock_guard<std::mutex> lock( mutex );
+            if( !exception ){
+                exception = std::current_exception();
+            }
+            failed = true;
+        }
+
+        // Release Image Buffer before Waiting Next Task
+        task = Task();
+    }
+}
+
+// Rethrow Encoder Error
+inline void VideoStream::rethrow()
+{
+    if( !failed ){
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( mutex );
+    std::rethrow_exception( exception );
+}
@@ -0,0 +1,79 @@
+#ifndef __VIDEO__
+#define __VIDEO__
+
+#include <librealsense2/rs.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "filesystem.h"
+#include "queue.h"
+#include "writer.h"
+
+// Video Stream Writer
+// Encodes images of one stream into a video file on its own thread fed through a bounded queue.
+// A sidecar index (<name>_index.csv) maps each video frame to frame number and timestamp of the source frame.
+// 4 channel (BGRA) images are written as BGR, because color video accepts only 3 channel images.
+class VideoStream
+{
+private:
+    // Encode Task
+    struct Task
+    {
+        cv::Mat image;
+        rs2::frame frame; // source frame that image refers to
+        uint64_t frame_number;
+        double timestamp;
+    };
+
+    filesystem::path path;
+    cv::VideoWriter writer;
+    std::unique_ptr<CsvWriter> index;
+    uint64_t frame_count = 0;
+
+    BoundedQueue<Task> tasks;
+    std::thread thread;
+
+    // Error Handling
+    std::mutex mutex;
+    std::exception_ptr exception;
+    std::atomic<bool> failed{ false };
+
+public:
+    // Constructor
+    // Open video file with fourcc (e.g. "mp4v"), fps and size, and start the encoder thread.
+    VideoStream( const filesystem::path& path, const std::string& fourcc, double fps, const cv::Size& size, bool is_color, std::chrono::steady_clock::duration flush_interval, std::size_t queue_capacity = 8 );
+
+    // Destructor
+    ~VideoStream();
+
+    VideoStream( const VideoStream& ) = delete;
+    VideoStream& operator=( const VideoStream& ) = delete;
+
+    // Write Image
+    // The image must not be modified by the caller after it has been passed (share or clone it).
+    // If the image refers to the buffer of frame, the frame is kept alive until the image has been encoded.
+    void write( const cv::Mat& image, const rs2::frame& frame );
+
+    // Close (Encode Remaining Images and Rethrow Encoder Error)
+    void close();
+
+    // Retrieve File Extension of Container for FourCC
+    static std::string getExtension( const std::string& fourcc );
+
+private:
+    // Encoder Thread
+    void work();
+
+    // Rethrow Encoder Error
+    inline void rethrow();
+};
+
+#endif // __VIDEO__
@@ -0,0 +1,140 @@
+#include "writer.h"
+#include "trace.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+// Constructor
+CsvWriter::CsvWriter( const filesystem::path& path, const std::string& header, std::chrono::steady_clock::duration interval, std::size_t buffer_size )
+    : path( path ), buffer( buffer_size ), interval( interval ), last_flush( std::chrono::steady_clock::now() )
+{
+    // Open File (append mode)
+    file = std::fopen( path.string().c_str(), "ab" );
+    if( !file ){
+        throw std::runtime_error( "failed can't open " + path.generic_string() );
+    }
+
+    // Disable stdio Buffering (use own buffer)
+    std::setvbuf( file, nullptr, _IONBF, 0 );
+
+    // Write Header
+    std::fseek( file, 0, SEEK_END );
+    if( std::ftell( file ) == 0 ){
+        append( header.c_str() );
+        append( '\n' );
+    }
+}
+
+// Destructor
+CsvWriter::~CsvWriter()
+{
+    try{
+        flush();
+    }
+    catch( ... ){
+    }
+
+    std::fclose( file );
+}
+
+// Retrieve File Path
+const filesystem::path& CsvWriter::getPath() const
+{
+    return path;
+}
+
+// Flush Buffer to File
+void CsvWriter::flush()
+{
+    last_flush = std::chrono::steady_clock::now();
+    if( size == 0 ){
+        return;
+    }
+
+    const std::size_t length = size;
+    size = 0;
+    if( std::fwrite( buffer.data(), 1, length, file ) != length ){
+        throw std::runtime_error( "failed can't write " + path.generic_string() );
+    }
+    countProfile( "bytes/csv", length );
+}
+
+// Ensure Capacity for Next Row
+void CsvWriter::reserve( std::size_t length )
+{
+    if( buffer.size() - size < length ){
+        flush();
+    }
+
+    if( buffer.size() < length ){
+        buffer.resize( length );
+    }
+}
+
+// Write Buffer if Full or Flush Interval Elapsed
+void CsvWriter::commit()
+{
+    if( interval == std::chrono::steady_clock::duration::zero() ){
+        return;
+    }
+
+    if( std::chrono::steady_clock::now() - last_flush >= interval ){
+        flush();
+    }
+}
+
+// Append Field
+void CsvWriter::append( char value )
+{
+    reserve( 1 );
+    buffer[size++] = value;
+}
+
+void CsvWriter::append( const char* value )
+{
+    const std::size_t length = std::strlen( value );
+    reserve( length );
+    std::memcpy( buffer.data() + size, value, length );
+    size += length;
+}
+
+void CsvWriter::append( const std::string& value )
+{
+    append( value.c_str() );
+}
+
+void CsvWriter::append( double value )
+{
+    #if defined( __cpp_lib_to_chars )
+    reserve( 32 );
+    const std::to_chars_result result = std::to_chars( buffer.data() + size, buffer.data() + buffer.size(), value, std::chars_format::fixed, 6 );
+    if( result.ec == std::errc() ){
+        size = result.ptr - buffer.data();
+        return;
+    }
+    #endif
+
+    // Fallback (no floating point std::to_chars, or value too long)
+    const int32_t length = std::snprintf( nullptr, 0, "%.6f", value );
+    reserve( length + 1 );
+    std::snprintf( buffer.data() + size, length + 1, "%.6f", value );
+    size += length;
+}
+
+void CsvWriter::append( unsigned long long value )
+{
+    reserve( 24 );
+    const std::to_chars_result result = std::to_chars( buffer.data() + size, buffer.data() + buffer.size(), value );
+    size = result.ptr - buffer.data();
+}
+
+void CsvWriter::append( long long value )
+{
+    reserve( 24 );
+    const std::to_chars_result result = std::to_chars( buffer.data() + size, buffer.data() + buffer.size(), value );
+    size = result.ptr - buffer.data();
+}
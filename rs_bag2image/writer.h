@@ -0,0 +1,84 @@
+#ifndef __WRITER__
+#define __WRITER__
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "filesystem.h"
+
+// CSV Writer
+// Keeps the file open and formats rows into a large user-space buffer without iostreams.
+// The buffer is written out when it is full, when the flush interval has elapsed, and at destruction.
+class CsvWriter
+{
+private:
+    std::FILE* file = nullptr;
+    filesystem::path path;
+
+    // Buffer
+    std::vector<char> buffer;
+    std::size_t size = 0;
+
+    // Flush Interval (zero is flush at the end only)
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point last_flush;
+
+public:
+    // Constructor
+    // Open file in append mode, and write header if the file is empty.
+    CsvWriter( const filesystem::path& path, const std::string& header, std::chrono::steady_clock::duration interval = std::chrono::steady_clock::duration::zero(), std::size_t buffer_size = 1 << 20 );
+
+    // Destructor
+    ~CsvWriter();
+
+    CsvWriter( const CsvWriter& ) = delete;
+    CsvWriter& operator=( const CsvWriter& ) = delete;
+
+    // Write Row
+    template<typename First, typename... Rest>
+    void write( const First& first, const Rest&... rest )
+    {
+        append( first );
+        ( ( append( ',' ), append( rest ) ), ... );
+        append( '\n' );
+        commit();
+    }
+
+    // Flush Buffer to File
+    void flush();
+
+    // Retrieve File Path
+    const filesystem::path& getPath() const;
+
+private:
+    // Ensure Capacity for Next Row
+    void reserve( std::size_t length );
+
+    // Write Buffer if Full or Flush Interval Elapsed
+    void commit();
+
+    // Append Field
+    void append( char value );
+    void append( const char* value );
+    void append( const std::string& value );
+    void append( double value ); // fixed, 6 digits
+    void append( float value ){ append( static_cast<double>( value ) ); }
+    void append( unsigned long long value );
+    void append( long long value );
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    void append( T value )
+    {
+        if( std::is_signed<T>::value ){
+            append( static_cast<long long>( value ) );
+        }
+        else{
+            append( static_cast<unsigned long long>( value ) );
+        }
+    }
+};
+
+#endif // __WRITER__